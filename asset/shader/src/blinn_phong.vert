@@ -10,22 +10,38 @@ layout(push_constant) uniform VPCO
 {
 	mat4 m;
 	mat4 mvp;
+	vec4 positionScale;
+	vec4 positionOffset;
 } vpco;
 
 // dvec会使用2个slot
-layout(location = 0) in vec3 inPosition;
+// packed vertex: quantized position, half UV, octahedral normal
+layout(location = 0) in vec4 inPosition;
 layout(location = 1) in vec2 inTexCoord;
-layout(location = 2) in vec3 inNormal;
+layout(location = 2) in vec2 inNormal;
 
 layout(location = 0) out vec2 outTexCoord;
 layout(location = 1) out vec3 outNormal;
 layout(location = 2) out vec3 outPosition;
 
+// octahedral normal back to a unit vector
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
 void main()
 {
-	gl_Position = vpco.mvp * vec4(inPosition, 1.0);
+	vec3 position = vpco.positionOffset.xyz + inPosition.xyz * vpco.positionScale.xyz;
+	vec3 normal = decodeOctahedral(inNormal);
+
+	gl_Position = vpco.mvp * vec4(position, 1.0);
 	
 	outTexCoord = inTexCoord;
-	outNormal = (vpco.m * vec4(inNormal, 0.0)).xyz;
-	outPosition = (vpco.m * vec4(inPosition, 1.0)).xyz;
+	outNormal = (vpco.m * vec4(normal, 0.0)).xyz;
+	outPosition = (vpco.m * vec4(position, 1.0)).xyz;
 }
\ No newline at end of file
@@ -2,44 +2,124 @@
 #extension GL_ARB_separate_shader_objects : enable
 
 const int INVALID_BONE = -1;
-const int MAX_BONE_NUM = 100;
 const int BONE_NUM_PER_VERTEX = 4;
-layout(binding = 0) uniform UBO
+
+// palette layout set by the pipeline: 0 matrix columns, 1 affine rows, 2 dual quaternions
+const int PALETTE_MATRIX = 0;
+const int PALETTE_AFFINE = 1;
+const int PALETTE_DUAL_QUAT = 2;
+layout(constant_id = 0) const int PALETTE_FORMAT = PALETTE_AFFINE;
+
+// model matrices and bone palettes of all instances of the mesh, indexed by gl_InstanceIndex
+layout(std430, binding = 0) readonly buffer Instances
+{
+	mat4 gModels[];
+} instances;
+
+layout(std430, binding = 2) readonly buffer Palettes
 {
-	mat4 gBones[MAX_BONE_NUM];
-} ubo;
+	vec4 gBones[];
+} palettes;
 
 layout(push_constant) uniform VPCO
 {
-	mat4 m;
-	mat4 mvp;
+	mat4 viewProjection;
+	vec4 positionScale;
+	vec4 positionOffset;
+	uint paletteStride;
 } vpco;
 
 // dvec会使用2个slot
-layout(location = 0) in vec3 inPosition;
+// packed vertex: quantized position, half UV, octahedral normal
+layout(location = 0) in vec4 inPosition;
 layout(location = 1) in vec2 inTexCoord;
-layout(location = 2) in vec3 inNormal;
-layout(location = 3) in ivec4 inBones;
+layout(location = 2) in vec2 inNormal;
+layout(location = 3) in uvec4 inBones;
 layout(location = 4) in vec4 inWeights;
 
 layout(location = 0) out vec2 outTexCoord;
 layout(location = 1) out vec3 outNormal;
 layout(location = 2) out vec3 outPosition;
 
+// octahedral normal back to a unit vector
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+// rotation of v by the unit quaternion q
+vec3 rotate(vec4 q, vec3 v)
+{
+	return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
 void main()
 {
-	mat4 boneTransform = mat4(0.0);
-	for (int i = 0; i < BONE_NUM_PER_VERTEX; ++i)
+	vec3 position = vpco.positionOffset.xyz + inPosition.xyz * vpco.positionScale.xyz;
+	vec3 normal = decodeOctahedral(inNormal);
+	int base = gl_InstanceIndex * int(vpco.paletteStride);
+
+	vec4 localPosition;
+	vec4 localNormal;
+	if (PALETTE_FORMAT == PALETTE_DUAL_QUAT)
 	{
-		boneTransform += ubo.gBones[inBones[i]] * inWeights[i];
+		// quaternions opposite to the first bone's are flipped, so the blend takes the short way
+		vec4 firstReal = palettes.gBones[base + int(inBones[0]) * 2];
+		vec4 real = vec4(0.0);
+		vec4 dual = vec4(0.0);
+		for (int i = 0; i < BONE_NUM_PER_VERTEX; ++i)
+		{
+			int bone = int(inBones[i]) * 2;
+			vec4 boneReal = palettes.gBones[base + bone];
+			float weight = dot(firstReal, boneReal) < 0.0 ? -inWeights[i] : inWeights[i];
+			real += boneReal * weight;
+			dual += palettes.gBones[base + bone + 1] * weight;
+		}
+
+		float inverseLength = 1.0 / length(real);
+		real *= inverseLength;
+		dual *= inverseLength;
+		vec3 translation = 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+		localPosition = vec4(rotate(real, position) + translation, 1.0);
+		localNormal = vec4(rotate(real, normal), 0.0);
 	}
+	else if (PALETTE_FORMAT == PALETTE_AFFINE)
+	{
+		vec4 rows[3] = vec4[3](vec4(0.0), vec4(0.0), vec4(0.0));
+		for (int i = 0; i < BONE_NUM_PER_VERTEX; ++i)
+		{
+			int bone = int(inBones[i]) * 3;
+			for (int j = 0; j < 3; ++j)
+			{
+				rows[j] += palettes.gBones[base + bone + j] * inWeights[i];
+			}
+		}
 
-	vec4 localPosition = boneTransform * vec4(inPosition, 1.0);
-	vec4 localNormal = boneTransform * vec4(inNormal, 0.0);
+		localPosition = vec4(dot(rows[0], vec4(position, 1.0)), dot(rows[1], vec4(position, 1.0)), dot(rows[2], vec4(position, 1.0)), 1.0);
+		localNormal = vec4(dot(rows[0].xyz, normal), dot(rows[1].xyz, normal), dot(rows[2].xyz, normal), 0.0);
+	}
+	else
+	{
+		mat4 boneTransform = mat4(0.0);
+		for (int i = 0; i < BONE_NUM_PER_VERTEX; ++i)
+		{
+			int bone = int(inBones[i]) * 4;
+			boneTransform += mat4(palettes.gBones[base + bone], palettes.gBones[base + bone + 1], palettes.gBones[base + bone + 2], palettes.gBones[base + bone + 3]) * inWeights[i];
+		}
+
+		localPosition = boneTransform * vec4(position, 1.0);
+		localNormal = boneTransform * vec4(normal, 0.0);
+	}
 
-	gl_Position = vpco.mvp * localPosition;
+	mat4 model = instances.gModels[gl_InstanceIndex];
+	vec4 worldPosition = model * localPosition;
+	gl_Position = vpco.viewProjection * worldPosition;
 	
 	outTexCoord = inTexCoord;
-	outNormal = (vpco.m * localNormal).xyz;
-	outPosition = (vpco.m * localPosition).xyz;
+	outNormal = (model * localNormal).xyz;
+	outPosition = worldPosition.xyz;
 }
\ No newline at end of file
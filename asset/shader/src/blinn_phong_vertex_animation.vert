@@ -0,0 +1,56 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// model matrices of all distant instances of the mesh, indexed by gl_InstanceIndex
+layout(std430, binding = 0) readonly buffer Instances
+{
+	mat4 gModels[];
+} instances;
+
+// the two frames an instance blends and the weight of the second
+layout(std430, binding = 2) readonly buffer Frames
+{
+	vec4 gFrames[];
+} frames;
+
+// each frame takes rowsPerFrame rows of positions followed by as many rows of normals, one texel per vertex
+layout(binding = 3) uniform sampler2D animationSampler;
+
+layout(push_constant) uniform VPCO
+{
+	mat4 viewProjection;
+	uint textureWidth;
+	uint rowsPerFrame;
+} vpco;
+
+layout(location = 0) in vec2 inTexCoord;
+
+layout(location = 0) out vec2 outTexCoord;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec3 outPosition;
+
+// position texel of this vertex in a frame, gl_VertexIndex already includes the section's base vertex
+ivec2 getTexel(float frame)
+{
+	int width = int(vpco.textureWidth);
+	return ivec2(gl_VertexIndex % width, int(frame) * int(vpco.rowsPerFrame) * 2 + gl_VertexIndex / width);
+}
+
+void main()
+{
+	vec4 frame = frames.gFrames[gl_InstanceIndex];
+	ivec2 texel0 = getTexel(frame.x);
+	ivec2 texel1 = getTexel(frame.y);
+	ivec2 normalOffset = ivec2(0, int(vpco.rowsPerFrame));
+
+	vec3 position = mix(texelFetch(animationSampler, texel0, 0).xyz, texelFetch(animationSampler, texel1, 0).xyz, frame.z);
+	vec3 normal = mix(texelFetch(animationSampler, texel0 + normalOffset, 0).xyz, texelFetch(animationSampler, texel1 + normalOffset, 0).xyz, frame.z);
+
+	mat4 model = instances.gModels[gl_InstanceIndex];
+	vec4 worldPosition = model * vec4(position, 1.0);
+	gl_Position = vpco.viewProjection * worldPosition;
+	
+	outTexCoord = inTexCoord;
+	outNormal = (model * vec4(normal, 0.0)).xyz;
+	outPosition = worldPosition.xyz;
+}
\ No newline at end of file
@@ -1,77 +1,348 @@
 #include "animation.h"
 
-void Bone::update()
+#include <boost/format.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+namespace
 {
-	glm::mat4 localMatrix = animatedTransform.matrix();
-	if (localMatrix == glm::mat4(1.0f))
+	const float SQRT2 = 1.41421356f;
+
+	// the key span around a time in 16 bit clip fractions, t blends from low to high
+	void searchKeys(const uint16_t* times, uint32_t keyCount, float time, uint32_t& low, uint32_t& high, float& t)
 	{
-		localMatrix = localBindPoseMatrix;
+		high = static_cast<uint32_t>(std::upper_bound(times, times + keyCount, time) - times);
+		if (high == 0 || high == keyCount)
+		{
+			low = high = high == 0 ? 0 : keyCount - 1;
+			t = 0.0f;
+			return;
+		}
+
+		low = high - 1;
+		t = (time - times[low]) / static_cast<float>(times[high] - times[low]);
 	}
 
-	if (parent)
+	// bind poses have no shear, so the scaled rotation columns split into scale and rotation
+	QuatTransform decompose(const glm::mat4& matrix)
 	{
-		globalBindPoseMatrix = parent->globalBindPoseMatrix * localMatrix;
+		QuatTransform transform;
+		transform.position = glm::vec3(matrix[3]);
+
+		glm::mat3 rotation(matrix);
+		transform.scale = glm::vec3(glm::length(rotation[0]), glm::length(rotation[1]), glm::length(rotation[2]));
+		if (glm::determinant(rotation) < 0.0f)
+		{
+			transform.scale.x = -transform.scale.x;
+		}
+
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			rotation[i] = transform.scale[i] != 0.0f ? rotation[i] / transform.scale[i] : glm::vec3(0.0f);
+		}
+		transform.rotation = glm::normalize(glm::quat_cast(rotation));
+		return transform;
 	}
-	else
+
+	glm::vec3 unpackVector(const PackedVector& packedVector, const AnimationTrack& track)
 	{
-		globalBindPoseMatrix = localMatrix;
+		glm::vec3 value(static_cast<float>(packedVector.data[0]), static_cast<float>(packedVector.data[1]), static_cast<float>(packedVector.data[2]));
+		return track.offset + value * (track.range / 65535.0f);
 	}
 
-	for (auto& iter : children)
+	// the key pairs of one track type in SoA order, blended in place and then scattered to their bones
+	struct KeyBatch
 	{
-		iter->update();
-	}
+		std::vector<float> data;
+		std::vector<uint32_t> bones;
+		uint32_t capacity = 0;
+		uint32_t count = 0;
+
+		void reset(uint32_t channelNum)
+		{
+			if (channelNum > capacity)
+			{
+				capacity = channelNum;
+				data.resize(capacity * 9);
+				bones.resize(capacity);
+			}
+			count = 0;
+		}
+
+		float* low(uint32_t component) { return data.data() + capacity * component; }
+		float* high(uint32_t component) { return data.data() + capacity * (4 + component); }
+		float* times() { return data.data() + capacity * 8; }
+
+		VectorStream lowVectors() { return VectorStream{ low(0), low(1), low(2) }; }
+		VectorStream highVectors() { return VectorStream{ high(0), high(1), high(2) }; }
+		QuatStream lowQuats() { return QuatStream{ low(0), low(1), low(2), low(3) }; }
+		QuatStream highQuats() { return QuatStream{ high(0), high(1), high(2), high(3) }; }
+
+		void add(uint32_t bone, const glm::vec3& lowValue, const glm::vec3& highValue, float t)
+		{
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				low(i)[count] = lowValue[i];
+				high(i)[count] = highValue[i];
+			}
+			times()[count] = t;
+			bones[count++] = bone;
+		}
+
+		void add(uint32_t bone, const glm::quat& lowValue, const glm::quat& highValue, float t)
+		{
+			low(0)[count] = lowValue.x;
+			low(1)[count] = lowValue.y;
+			low(2)[count] = lowValue.z;
+			low(3)[count] = lowValue.w;
+			high(0)[count] = highValue.x;
+			high(1)[count] = highValue.y;
+			high(2)[count] = highValue.z;
+			high(3)[count] = highValue.w;
+			times()[count] = t;
+			bones[count++] = bone;
+		}
+
+		void scatter(const VectorStream& out)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				out.x[bones[i]] = low(0)[i];
+				out.y[bones[i]] = low(1)[i];
+				out.z[bones[i]] = low(2)[i];
+			}
+		}
+
+		void scatter(const QuatStream& out)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				out.x[bones[i]] = low(0)[i];
+				out.y[bones[i]] = low(1)[i];
+				out.z[bones[i]] = low(2)[i];
+				out.w[bones[i]] = low(3)[i];
+			}
+		}
+	};
 }
 
-glm::mat4 Bone::matrix()
+PackedQuat packQuat(const glm::quat& quat)
 {
-	return globalBindPoseMatrix * globalInverseBindPoseMatrix;
+	glm::quat normalized = glm::normalize(quat);
+	float components[4] = { normalized.x, normalized.y, normalized.z, normalized.w };
+
+	uint32_t largest = 0;
+	for (uint32_t i = 1; i < 4; ++i)
+	{
+		largest = std::abs(components[i]) > std::abs(components[largest]) ? i : largest;
+	}
+
+	// q and -q are the same rotation, so the dropped component is always positive
+	float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+	PackedQuat packedQuat;
+	uint32_t j = 0;
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		if (i != largest)
+		{
+			float value = std::clamp(components[i] * sign * SQRT2 * 0.5f + 0.5f, 0.0f, 1.0f);
+			packedQuat.data[j++] = static_cast<uint16_t>(value * 32767.0f + 0.5f);
+		}
+	}
+
+	packedQuat.data[0] |= static_cast<uint16_t>((largest & 1) << 15);
+	packedQuat.data[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+	return packedQuat;
 }
 
-bool Animation::isCompatible(std::shared_ptr<Skeleton> skeleton)
+glm::quat unpackQuat(const PackedQuat& packedQuat)
 {
-	for (auto& iter : positionKeys)
+	uint32_t largest = (packedQuat.data[0] >> 15) | ((packedQuat.data[1] >> 15) << 1);
+
+	float components[4];
+	float sum = 0.0f;
+	uint32_t j = 0;
+	for (uint32_t i = 0; i < 4; ++i)
 	{
-		if (!skeleton->hasBone(iter.first))
+		if (i != largest)
 		{
-			return false;
+			float value = static_cast<float>(packedQuat.data[j++] & 0x7FFF) / 32767.0f;
+			components[i] = (value * 2.0f - 1.0f) / SQRT2;
+			sum += components[i] * components[i];
 		}
 	}
-	for (auto& iter : rotationKeys)
+	components[largest] = std::sqrt(std::max(1.0f - sum, 0.0f));
+
+	return glm::quat(components[3], components[0], components[1], components[2]);
+}
+
+bool Animation::isCompatible(std::shared_ptr<const Skeleton> skeleton)
+{
+	for (const std::string& channelName : channelNames)
 	{
-		if (!skeleton->hasBone(iter.first))
+		if (!skeleton->hasBone(channelName))
 		{
 			return false;
 		}
 	}
-	for (auto& iter : scaleKeys)
+	return true;
+}
+
+std::vector<int> Animation::bind(const Skeleton& skeleton) const
+{
+	std::vector<int> boneIndices;
+	for (const std::string& channelName : channelNames)
 	{
-		if (!skeleton->hasBone(iter.first))
+		boneIndices.push_back(skeleton.getBoneIndex(channelName));
+	}
+	return boneIndices;
+}
+
+void Animation::sample(float animTime, const std::vector<int>& boneIndices, const TransformStreams& localPoses) const
+{
+	thread_local KeyBatch positionBatch, rotationBatch, scaleBatch;
+	uint32_t channelNum = static_cast<uint32_t>(channels.size());
+	positionBatch.reset(channelNum);
+	rotationBatch.reset(channelNum);
+	scaleBatch.reset(channelNum);
+
+	float clipTime = duration > 0.0f ? std::clamp(animTime / duration, 0.0f, 1.0f) : 0.0f;
+	uint32_t low, high;
+	float t;
+	for (uint32_t i = 0; i < channelNum; ++i)
+	{
+		if (boneIndices[i] == INVALID_BONE)
 		{
-			return false;
+			continue;
+		}
+
+		const AnimationChannel& channel = channels[i];
+		uint32_t bone = static_cast<uint32_t>(boneIndices[i]);
+
+		if (channel.position.keyCount > 0)
+		{
+			findKeys(channel.position, positionTimes, clipTime, low, high, t);
+			positionBatch.add(bone, unpackVector(positions[channel.position.firstKey + low], channel.position),
+				unpackVector(positions[channel.position.firstKey + high], channel.position), t);
+		}
+
+		if (channel.rotation.keyCount > 0)
+		{
+			findKeys(channel.rotation, rotationTimes, clipTime, low, high, t);
+			rotationBatch.add(bone, unpackQuat(rotations[channel.rotation.firstKey + low]), unpackQuat(rotations[channel.rotation.firstKey + high]), t);
+		}
+
+		if (channel.scale.keyCount > 0)
+		{
+			findKeys(channel.scale, scaleTimes, clipTime, low, high, t);
+			scaleBatch.add(bone, unpackVector(scales[channel.scale.firstKey + low], channel.scale),
+				unpackVector(scales[channel.scale.firstKey + high], channel.scale), t);
 		}
 	}
-	return true;
+
+	AnimationKernels& kernels = AnimationKernels::getInstance();
+	kernels.lerp(positionBatch.lowVectors(), positionBatch.highVectors(), positionBatch.times(), positionBatch.lowVectors(), positionBatch.count);
+	kernels.blend(rotationBatch.lowQuats(), rotationBatch.highQuats(), rotationBatch.times(), rotationBatch.lowQuats(), rotationBatch.count);
+	kernels.lerp(scaleBatch.lowVectors(), scaleBatch.highVectors(), scaleBatch.times(), scaleBatch.lowVectors(), scaleBatch.count);
+
+	positionBatch.scatter(localPoses.position);
+	rotationBatch.scatter(localPoses.rotation);
+	scaleBatch.scatter(localPoses.scale);
 }
 
-bool Skeleton::hasBone(const std::string& name)
+void Animation::findKeys(const AnimationTrack& track, const std::vector<uint16_t>& times, float clipTime, uint32_t& low, uint32_t& high, float& t) const
+{
+	if (frameCount == 0)
+	{
+		searchKeys(times.data() + track.firstKey, track.keyCount, clipTime * 65535.0f, low, high, t);
+		return;
+	}
+
+	// a uniform track holds one key per frame unless it is constant
+	if (track.keyCount < 2)
+	{
+		low = high = 0;
+		t = 0.0f;
+		return;
+	}
+
+	float frame = clipTime * (track.keyCount - 1);
+	low = std::min(static_cast<uint32_t>(frame), track.keyCount - 2);
+	high = low + 1;
+	t = frame - low;
+}
+
+size_t Animation::getMemorySize() const
+{
+	size_t size = sizeof(Animation) + name.size() + channels.size() * sizeof(AnimationChannel);
+	for (const std::string& channelName : channelNames)
+	{
+		size += sizeof(std::string) + channelName.size();
+	}
+
+	size += (positionTimes.size() + rotationTimes.size() + scaleTimes.size()) * sizeof(uint16_t);
+	size += (positions.size() + scales.size()) * sizeof(PackedVector) + rotations.size() * sizeof(PackedQuat);
+	return size;
+}
+
+uint32_t Skeleton::getBoneNum() const
+{
+	return static_cast<uint32_t>(names.size());
+}
+
+bool Skeleton::hasBone(const std::string& name) const
 {
 	return nameIndexMap.find(name) != nameIndexMap.end();
 }
 
-Bone& Skeleton::getBone(const std::string& name)
+int Skeleton::getBoneIndex(const std::string& name) const
 {
-	if (!hasBone(name))
+	auto iter = nameIndexMap.find(name);
+	return iter != nameIndexMap.end() ? static_cast<int>(iter->second) : INVALID_BONE;
+}
+
+uint32_t Skeleton::getBoneDepth(uint32_t index) const
+{
+	uint32_t depth = 0;
+	for (int parent = parents[index]; parent != INVALID_BONE; parent = parents[parent])
+	{
+		depth++;
+	}
+	return depth;
+}
+
+uint32_t Skeleton::addBone(const std::string& name, int parent, const glm::mat4& localBindPose, const glm::mat4& inverseBindPose)
+{
+	uint32_t index = getBoneNum();
+	if (parent != INVALID_BONE && (parent < 0 || static_cast<uint32_t>(parent) >= index))
 	{
-		return invalidBone;
+		throw std::runtime_error((boost::format("bone %s is added before its parent %d") % name % parent).str());
 	}
-	return bones[nameIndexMap[name]];
+
+	names.push_back(name);
+	parents.push_back(parent);
+	localBindPoses.push_back(localBindPose);
+	inverseBindPoses.push_back(inverseBindPose);
+	bindPoses.push_back(decompose(localBindPose));
+	nameIndexMap[name] = index;
+	return index;
 }
 
-void Skeleton::update()
+void Skeleton::evaluate(const TransformStreams& localPoses, glm::mat4* palette) const
 {
-	if (!bones.empty())
+	// global transforms are only needed while their children are evaluated, so they stay out of the instances
+	thread_local std::vector<glm::mat4> globalPoses;
+	uint32_t boneNum = getBoneNum();
+	globalPoses.resize(std::max(static_cast<uint32_t>(globalPoses.size()), boneNum));
+
+	// all local matrices are composed in one batch, then turned into global ones in place
+	AnimationKernels::getInstance().compose(localPoses, globalPoses.data(), boneNum);
+	for (uint32_t i = 0; i < boneNum; ++i)
 	{
-		bones.front().update();
+		if (parents[i] != INVALID_BONE)
+		{
+			globalPoses[i] = globalPoses[parents[i]] * globalPoses[i];
+		}
+		palette[i] = globalPoses[i] * inverseBindPoses[i];
 	}
 }
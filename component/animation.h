@@ -5,36 +5,38 @@
 #include <map>
 #include <memory>
 #include "core/engine_type.h"
-
-struct Bone
+#include "component/animation_kernels.h"
+#include "component/material.h"
+
+/*
+ * Flat skeleton, bones are stored parent first with each of their transforms in its own array
+ * A pose is evaluated in one pass over the bones, the global transform of a bone only needs the already computed one of its parent.
+ * The skeleton holds topology and bind pose only and is shared by all its instances, which keep their poses in PoseBuffers.
+ */
+struct Skeleton
 {
-	std::string name;
-	glm::mat4 globalInverseBindPoseMatrix;
-	glm::mat4 localBindPoseMatrix;
-	QuatTransform animatedTransform;
+	std::vector<std::string> names;
+	std::vector<int> parents;
+	std::vector<glm::mat4> localBindPoses;
+	std::vector<glm::mat4> inverseBindPoses;
 
-	Bone* parent = nullptr;
-	std::vector<Bone*> children;
+	// local bind poses split into translation, rotation and scale, the start of every animated pose
+	std::vector<QuatTransform> bindPoses;
 
-	void update();
-	glm::mat4 matrix();
-
-private:
-	glm::mat4 globalBindPoseMatrix;
-};
+	std::map<std::string, uint32_t> nameIndexMap;
 
-struct Skeleton
-{
-	std::vector<Bone> bones;
-	std::map<std::string, uint8_t> nameIndexMap;
+	uint32_t getBoneNum() const;
+	bool hasBone(const std::string& name) const;
+	int getBoneIndex(const std::string& name) const;
 
-	bool hasBone(const std::string& name);
-	Bone& getBone(const std::string& name);
+	// parents between a bone and its root, 0 for a root bone
+	uint32_t getBoneDepth(uint32_t index) const;
 
-	void update();
+	// the parent is added first, INVALID_BONE for a root bone
+	uint32_t addBone(const std::string& name, int parent, const glm::mat4& localBindPose, const glm::mat4& inverseBindPose);
 
-private:
-	Bone invalidBone;
+	// skinning matrices of a pose, the streams and the palette hold one entry per bone
+	void evaluate(const TransformStreams& localPoses, glm::mat4* palette) const;
 };
 
 struct AnimKey
@@ -57,15 +59,99 @@ struct QuatKey : public AnimKey
 	glm::quat value;
 };
 
+// smallest three quaternion, the largest component is dropped and rebuilt from the unit length,
+// the other three are 15 bit values in [-1/sqrt(2), 1/sqrt(2)] and the top bits of the first two hold its index
+struct PackedQuat
+{
+	uint16_t data[3];
+};
+
+// position or scale, quantized to 16 bits per axis against the range of its track
+struct PackedVector
+{
+	uint16_t data[3];
+};
+
+PackedQuat packQuat(const glm::quat& quat);
+glm::quat unpackQuat(const PackedQuat& packedQuat);
+
+// the keys of one track, key times are 16 bit fractions of the clip duration,
+// uniform tracks have either a single key or one key per frame and no key times
+struct AnimationTrack
+{
+	uint32_t firstKey = 0;
+	uint32_t keyCount = 0;
+
+	// dequantization of position and scale keys, value = offset + packed / 65535 * range
+	glm::vec3 offset = glm::vec3(0.0f);
+	glm::vec3 range = glm::vec3(0.0f);
+};
+
+struct AnimationChannel
+{
+	AnimationTrack position;
+	AnimationTrack rotation;
+	AnimationTrack scale;
+};
+
+/*
+ * Compressed animation clip, written by the AnimationCompressor at import
+ * Each bone channel references runs of reduced keys, a missing track has no keys and leaves the bone untouched.
+ * Clips resampled at import are uniform, their keys are found by index instead of by searching the key times.
+ */
 struct Animation
 {
 	std::string name;
 	float duration;
 	float frameRate;
 
-	bool isCompatible(std::shared_ptr<Skeleton> skeleton);
+	// frames of a uniform clip, spread evenly over the duration, 0 for clips with keyed tracks
+	uint32_t frameCount = 0;
+
+	bool isCompatible(std::shared_ptr<const Skeleton> skeleton);
+
+	// the skeleton bone index of each channel, INVALID_BONE where the skeleton lacks the bone
+	std::vector<int> bind(const Skeleton& skeleton) const;
+
+	// writes the pose at animTime, in ticks, into the local poses of the bones the channels are bound to,
+	// the keys of all channels are gathered first and blended by the AnimationKernels in one batch per track type
+	void sample(float animTime, const std::vector<int>& boneIndices, const TransformStreams& localPoses) const;
+	size_t getMemorySize() const;
+
+	std::vector<std::string> channelNames;
+	std::vector<AnimationChannel> channels;
+
+	std::vector<uint16_t> positionTimes;
+	std::vector<PackedVector> positions;
+	std::vector<uint16_t> rotationTimes;
+	std::vector<PackedQuat> rotations;
+	std::vector<uint16_t> scaleTimes;
+	std::vector<PackedVector> scales;
 
-	std::map<std::string, std::vector<VectorKey>> positionKeys;
-	std::map<std::string, std::vector<QuatKey>> rotationKeys;
-	std::map<std::string, std::vector<VectorKey>> scaleKeys;
-};
\ No newline at end of file
+private:
+	// the two keys around the sample time, a clip fraction in [0, 1], and the blend between them
+	void findKeys(const AnimationTrack& track, const std::vector<uint16_t>& times, float clipTime, uint32_t& low, uint32_t& high, float& t) const;
+};
+
+// a clip baked by the VertexAnimationBaker, its frames follow each other in the texture and evenly cover the duration
+struct BakedClip
+{
+	uint32_t firstFrame = 0;
+	uint32_t frameCount = 0;
+
+	// in ticks, like Animation::duration
+	float duration = 0.0f;
+};
+
+/*
+ * Skinned positions and normals of every baked clip of a skeletal mesh, a half float RGBA texture
+ * A frame takes rowsPerFrame rows of positions followed by as many rows of normals, vertex i sits at column i % width
+ * and row i / width of each. Distant instances play the frames without a skeleton.
+ */
+struct VertexAnimation
+{
+	uint32_t width = 0;
+	uint32_t rowsPerFrame = 0;
+	std::map<std::string, BakedClip> clips;
+	std::shared_ptr<Texture> texture;
+};
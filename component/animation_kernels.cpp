@@ -0,0 +1,466 @@
+#include "animation_kernels.h"
+#include "config/config_manager.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ANIMATION_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// msvc compiles any intrinsic, gcc and clang need the instruction set enabled per function
+#if defined(ANIMATION_KERNELS_X86) && !defined(_MSC_VER)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+namespace
+{
+	// the streams from element offset on, so a narrower kernel can continue where a wider one stopped
+	VectorStream shift(const VectorStream& stream, uint32_t offset)
+	{
+		return VectorStream{ stream.x + offset, stream.y + offset, stream.z + offset };
+	}
+
+	QuatStream shift(const QuatStream& stream, uint32_t offset)
+	{
+		return QuatStream{ stream.x + offset, stream.y + offset, stream.z + offset, stream.w + offset };
+	}
+
+	TransformStreams shift(const TransformStreams& streams, uint32_t offset)
+	{
+		return TransformStreams{ shift(streams.position, offset), shift(streams.rotation, offset), shift(streams.scale, offset) };
+	}
+
+	// polynomial fit that moves t so an nlerp follows the constant angular speed of a slerp, d is |dot(a, b)|
+	float correctSlerpTime(float t, float d)
+	{
+		float a = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+		float b = 0.848013f + d * (-1.06021f + d * 0.215638f);
+		float k = a * (t - 0.5f) * (t - 0.5f) + b;
+		return t + t * (t - 0.5f) * (t - 1.0f) * k;
+	}
+
+	void lerpScalar(const VectorStream& a, const VectorStream& b, const float* t, const VectorStream& out, uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			out.x[i] = a.x[i] + (b.x[i] - a.x[i]) * t[i];
+			out.y[i] = a.y[i] + (b.y[i] - a.y[i]) * t[i];
+			out.z[i] = a.z[i] + (b.z[i] - a.z[i]) * t[i];
+		}
+	}
+
+	void blendScalar(const QuatStream& a, const QuatStream& b, const float* t, const QuatStream& out, uint32_t begin, uint32_t end, bool slerp)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			float dot = a.x[i] * b.x[i] + a.y[i] * b.y[i] + a.z[i] * b.z[i] + a.w[i] * b.w[i];
+			float sign = std::signbit(dot) ? -1.0f : 1.0f;
+			float time = slerp ? correctSlerpTime(t[i], std::abs(dot)) : t[i];
+
+			float x = a.x[i] + (b.x[i] * sign - a.x[i]) * time;
+			float y = a.y[i] + (b.y[i] * sign - a.y[i]) * time;
+			float z = a.z[i] + (b.z[i] * sign - a.z[i]) * time;
+			float w = a.w[i] + (b.w[i] * sign - a.w[i]) * time;
+			float inverseLength = 1.0f / std::sqrt(x * x + y * y + z * z + w * w);
+
+			out.x[i] = x * inverseLength;
+			out.y[i] = y * inverseLength;
+			out.z[i] = z * inverseLength;
+			out.w[i] = w * inverseLength;
+		}
+	}
+
+	void composeScalar(const TransformStreams& transforms, glm::mat4* out, uint32_t begin, uint32_t end)
+	{
+		const QuatStream& rotation = transforms.rotation;
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			float x = rotation.x[i], y = rotation.y[i], z = rotation.z[i], w = rotation.w[i];
+			float sx = transforms.scale.x[i], sy = transforms.scale.y[i], sz = transforms.scale.z[i];
+
+			glm::mat4& matrix = out[i];
+			matrix[0] = glm::vec4((1.0f - 2.0f * (y * y + z * z)) * sx, 2.0f * (x * y + w * z) * sx, 2.0f * (x * z - w * y) * sx, 0.0f);
+			matrix[1] = glm::vec4(2.0f * (x * y - w * z) * sy, (1.0f - 2.0f * (x * x + z * z)) * sy, 2.0f * (y * z + w * x) * sy, 0.0f);
+			matrix[2] = glm::vec4(2.0f * (x * z + w * y) * sz, 2.0f * (y * z - w * x) * sz, (1.0f - 2.0f * (x * x + y * y)) * sz, 0.0f);
+			matrix[3] = glm::vec4(transforms.position.x[i], transforms.position.y[i], transforms.position.z[i], 1.0f);
+		}
+	}
+
+#ifdef ANIMATION_KERNELS_X86
+	// the same column of 4 bones, transposed from one register per component into one column per matrix
+	inline void storeColumn(__m128 x, __m128 y, __m128 z, __m128 w, glm::mat4* out, uint32_t column)
+	{
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(&out[0][column][0], x);
+		_mm_storeu_ps(&out[1][column][0], y);
+		_mm_storeu_ps(&out[2][column][0], z);
+		_mm_storeu_ps(&out[3][column][0], w);
+	}
+
+	uint32_t lerpSSE(const float* a, const float* b, const float* t, float* out, uint32_t count)
+	{
+		uint32_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 value = _mm_loadu_ps(a + i);
+			_mm_storeu_ps(out + i, _mm_add_ps(value, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b + i), value), _mm_loadu_ps(t + i))));
+		}
+		return i;
+	}
+
+	uint32_t blendSSE(const QuatStream& a, const QuatStream& b, const float* t, const QuatStream& out, uint32_t count, bool slerp)
+	{
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+
+		uint32_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 ax = _mm_loadu_ps(a.x + i), ay = _mm_loadu_ps(a.y + i), az = _mm_loadu_ps(a.z + i), aw = _mm_loadu_ps(a.w + i);
+			__m128 bx = _mm_loadu_ps(b.x + i), by = _mm_loadu_ps(b.y + i), bz = _mm_loadu_ps(b.z + i), bw = _mm_loadu_ps(b.w + i);
+
+			// b is negated where the quaternions lie in opposite hemispheres
+			__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+			__m128 flip = _mm_and_ps(dot, signMask);
+			bx = _mm_xor_ps(bx, flip);
+			by = _mm_xor_ps(by, flip);
+			bz = _mm_xor_ps(bz, flip);
+			bw = _mm_xor_ps(bw, flip);
+
+			__m128 time = _mm_loadu_ps(t + i);
+			if (slerp)
+			{
+				__m128 d = _mm_andnot_ps(signMask, dot);
+				__m128 ka = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(-3.2452f),
+					_mm_mul_ps(d, _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(1.43519f)))))));
+				__m128 kb = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(d, _mm_set1_ps(0.215638f)))));
+				__m128 centered = _mm_sub_ps(time, half);
+				__m128 k = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ka, centered), centered), kb);
+				time = _mm_add_ps(time, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(time, centered), _mm_sub_ps(time, one)), k));
+			}
+
+			__m128 x = _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(bx, ax), time));
+			__m128 y = _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(by, ay), time));
+			__m128 z = _mm_add_ps(az, _mm_mul_ps(_mm_sub_ps(bz, az), time));
+			__m128 w = _mm_add_ps(aw, _mm_mul_ps(_mm_sub_ps(bw, aw), time));
+			__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+			__m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+
+			_mm_storeu_ps(out.x + i, _mm_mul_ps(x, inverseLength));
+			_mm_storeu_ps(out.y + i, _mm_mul_ps(y, inverseLength));
+			_mm_storeu_ps(out.z + i, _mm_mul_ps(z, inverseLength));
+			_mm_storeu_ps(out.w + i, _mm_mul_ps(w, inverseLength));
+		}
+		return i;
+	}
+
+	uint32_t composeSSE(const TransformStreams& transforms, glm::mat4* out, uint32_t count)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+
+		uint32_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(transforms.rotation.x + i), y = _mm_loadu_ps(transforms.rotation.y + i);
+			__m128 z = _mm_loadu_ps(transforms.rotation.z + i), w = _mm_loadu_ps(transforms.rotation.w + i);
+			__m128 sx = _mm_loadu_ps(transforms.scale.x + i), sy = _mm_loadu_ps(transforms.scale.y + i), sz = _mm_loadu_ps(transforms.scale.z + i);
+
+			__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+			__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+			__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+			storeColumn(
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+				zero, out + i, 0);
+			storeColumn(
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+				zero, out + i, 1);
+			storeColumn(
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+				zero, out + i, 2);
+			storeColumn(_mm_loadu_ps(transforms.position.x + i), _mm_loadu_ps(transforms.position.y + i), _mm_loadu_ps(transforms.position.z + i),
+				one, out + i, 3);
+		}
+		return i;
+	}
+
+	AVX2_TARGET uint32_t lerpAVX2(const float* a, const float* b, const float* t, float* out, uint32_t count)
+	{
+		uint32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 value = _mm256_loadu_ps(a + i);
+			_mm256_storeu_ps(out + i, _mm256_add_ps(value, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(b + i), value), _mm256_loadu_ps(t + i))));
+		}
+		return i;
+	}
+
+	AVX2_TARGET uint32_t blendAVX2(const QuatStream& a, const QuatStream& b, const float* t, const QuatStream& out, uint32_t count, bool slerp)
+	{
+		const __m256 signMask = _mm256_set1_ps(-0.0f);
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 half = _mm256_set1_ps(0.5f);
+
+		uint32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 ax = _mm256_loadu_ps(a.x + i), ay = _mm256_loadu_ps(a.y + i), az = _mm256_loadu_ps(a.z + i), aw = _mm256_loadu_ps(a.w + i);
+			__m256 bx = _mm256_loadu_ps(b.x + i), by = _mm256_loadu_ps(b.y + i), bz = _mm256_loadu_ps(b.z + i), bw = _mm256_loadu_ps(b.w + i);
+
+			__m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, bx), _mm256_mul_ps(ay, by)), _mm256_add_ps(_mm256_mul_ps(az, bz), _mm256_mul_ps(aw, bw)));
+			__m256 flip = _mm256_and_ps(dot, signMask);
+			bx = _mm256_xor_ps(bx, flip);
+			by = _mm256_xor_ps(by, flip);
+			bz = _mm256_xor_ps(bz, flip);
+			bw = _mm256_xor_ps(bw, flip);
+
+			__m256 time = _mm256_loadu_ps(t + i);
+			if (slerp)
+			{
+				__m256 d = _mm256_andnot_ps(signMask, dot);
+				__m256 ka = _mm256_add_ps(_mm256_set1_ps(1.0904f), _mm256_mul_ps(d, _mm256_add_ps(_mm256_set1_ps(-3.2452f),
+					_mm256_mul_ps(d, _mm256_sub_ps(_mm256_set1_ps(3.55645f), _mm256_mul_ps(d, _mm256_set1_ps(1.43519f)))))));
+				__m256 kb = _mm256_add_ps(_mm256_set1_ps(0.848013f), _mm256_mul_ps(d, _mm256_add_ps(_mm256_set1_ps(-1.06021f), _mm256_mul_ps(d, _mm256_set1_ps(0.215638f)))));
+				__m256 centered = _mm256_sub_ps(time, half);
+				__m256 k = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(ka, centered), centered), kb);
+				time = _mm256_add_ps(time, _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(time, centered), _mm256_sub_ps(time, one)), k));
+			}
+
+			__m256 x = _mm256_add_ps(ax, _mm256_mul_ps(_mm256_sub_ps(bx, ax), time));
+			__m256 y = _mm256_add_ps(ay, _mm256_mul_ps(_mm256_sub_ps(by, ay), time));
+			__m256 z = _mm256_add_ps(az, _mm256_mul_ps(_mm256_sub_ps(bz, az), time));
+			__m256 w = _mm256_add_ps(aw, _mm256_mul_ps(_mm256_sub_ps(bw, aw), time));
+			__m256 lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_add_ps(_mm256_mul_ps(z, z), _mm256_mul_ps(w, w)));
+			__m256 inverseLength = _mm256_div_ps(one, _mm256_sqrt_ps(lengthSquared));
+
+			_mm256_storeu_ps(out.x + i, _mm256_mul_ps(x, inverseLength));
+			_mm256_storeu_ps(out.y + i, _mm256_mul_ps(y, inverseLength));
+			_mm256_storeu_ps(out.z + i, _mm256_mul_ps(z, inverseLength));
+			_mm256_storeu_ps(out.w + i, _mm256_mul_ps(w, inverseLength));
+		}
+		return i;
+	}
+
+	// the columns of 8 bones, the lower and upper halves are transposed into matrices 4 at a time
+	AVX2_TARGET inline void storeColumn8(__m256 x, __m256 y, __m256 z, __m256 w, glm::mat4* out, uint32_t column)
+	{
+		storeColumn(_mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z), _mm256_castps256_ps128(w), out, column);
+		storeColumn(_mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1), _mm256_extractf128_ps(w, 1), out + 4, column);
+	}
+
+	AVX2_TARGET uint32_t composeAVX2(const TransformStreams& transforms, glm::mat4* out, uint32_t count)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 two = _mm256_set1_ps(2.0f);
+
+		uint32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(transforms.rotation.x + i), y = _mm256_loadu_ps(transforms.rotation.y + i);
+			__m256 z = _mm256_loadu_ps(transforms.rotation.z + i), w = _mm256_loadu_ps(transforms.rotation.w + i);
+			__m256 sx = _mm256_loadu_ps(transforms.scale.x + i), sy = _mm256_loadu_ps(transforms.scale.y + i), sz = _mm256_loadu_ps(transforms.scale.z + i);
+
+			__m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+			__m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+			__m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+			storeColumn8(
+				_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx),
+				zero, out + i, 0);
+			storeColumn8(
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy),
+				_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy),
+				zero, out + i, 1);
+			storeColumn8(
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz),
+				_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz),
+				zero, out + i, 2);
+			storeColumn8(_mm256_loadu_ps(transforms.position.x + i), _mm256_loadu_ps(transforms.position.y + i), _mm256_loadu_ps(transforms.position.z + i),
+				one, out + i, 3);
+		}
+		return i;
+	}
+#endif
+}
+
+QuatTransform TransformStreams::get(uint32_t index) const
+{
+	QuatTransform transform;
+	transform.position = glm::vec3(position.x[index], position.y[index], position.z[index]);
+	transform.rotation = glm::quat(rotation.w[index], rotation.x[index], rotation.y[index], rotation.z[index]);
+	transform.scale = glm::vec3(scale.x[index], scale.y[index], scale.z[index]);
+	return transform;
+}
+
+void TransformStreams::set(uint32_t index, const QuatTransform& transform) const
+{
+	position.x[index] = transform.position.x;
+	position.y[index] = transform.position.y;
+	position.z[index] = transform.position.z;
+	rotation.x[index] = transform.rotation.x;
+	rotation.y[index] = transform.rotation.y;
+	rotation.z[index] = transform.rotation.z;
+	rotation.w[index] = transform.rotation.w;
+	scale.x[index] = transform.scale.x;
+	scale.y[index] = transform.scale.y;
+	scale.z[index] = transform.scale.z;
+}
+
+AnimationKernels& AnimationKernels::getInstance()
+{
+	static AnimationKernels kernels;
+	return kernels;
+}
+
+void AnimationKernels::init()
+{
+	std::string simdLevel = ConfigManager::getInstance().getAnimationSimd();
+	setSimdLevel(simdLevel == "scalar" ? ESimdLevel::Scalar : simdLevel == "sse" ? ESimdLevel::SSE : ESimdLevel::AVX2);
+	m_slerp = ConfigManager::getInstance().getAnimationSlerp();
+
+	std::string paletteFormat = ConfigManager::getInstance().getAnimationPaletteFormat();
+	m_paletteFormat = paletteFormat == "matrix" ? EPaletteFormat::Matrix : paletteFormat == "dual_quat" ? EPaletteFormat::DualQuat : EPaletteFormat::Affine;
+}
+
+void AnimationKernels::destroy()
+{
+
+}
+
+ESimdLevel AnimationKernels::getSupportedSimdLevel()
+{
+#ifdef ANIMATION_KERNELS_X86
+	// sse2 is part of every x64 cpu, avx2 also needs the os to save the ymm registers
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return ESimdLevel::SSE;
+	}
+
+	__cpuid(info, 1);
+	bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	return osAvx && (info[1] & (1 << 5)) ? ESimdLevel::AVX2 : ESimdLevel::SSE;
+#else
+	return __builtin_cpu_supports("avx2") ? ESimdLevel::AVX2 : ESimdLevel::SSE;
+#endif
+#else
+	return ESimdLevel::Scalar;
+#endif
+}
+
+void AnimationKernels::setSimdLevel(ESimdLevel simdLevel)
+{
+	m_simdLevel = std::min(simdLevel, getSupportedSimdLevel());
+}
+
+void AnimationKernels::lerp(const VectorStream& a, const VectorStream& b, const float* t, const VectorStream& out, uint32_t count)
+{
+	uint32_t i = 0;
+#ifdef ANIMATION_KERNELS_X86
+	if (m_simdLevel == ESimdLevel::AVX2)
+	{
+		i = lerpAVX2(a.x, b.x, t, out.x, count);
+		lerpAVX2(a.y, b.y, t, out.y, count);
+		lerpAVX2(a.z, b.z, t, out.z, count);
+	}
+	if (m_simdLevel != ESimdLevel::Scalar)
+	{
+		uint32_t end = i + lerpSSE(a.x + i, b.x + i, t + i, out.x + i, count - i);
+		lerpSSE(a.y + i, b.y + i, t + i, out.y + i, count - i);
+		lerpSSE(a.z + i, b.z + i, t + i, out.z + i, count - i);
+		i = end;
+	}
+#endif
+	lerpScalar(a, b, t, out, i, count);
+}
+
+void AnimationKernels::blend(const QuatStream& a, const QuatStream& b, const float* t, const QuatStream& out, uint32_t count)
+{
+	uint32_t i = 0;
+#ifdef ANIMATION_KERNELS_X86
+	i = m_simdLevel == ESimdLevel::AVX2 ? blendAVX2(a, b, t, out, count, m_slerp) : 0;
+	i += m_simdLevel != ESimdLevel::Scalar ? blendSSE(shift(a, i), shift(b, i), t + i, shift(out, i), count - i, m_slerp) : 0;
+#endif
+	blendScalar(a, b, t, out, i, count, m_slerp);
+}
+
+void AnimationKernels::compose(const TransformStreams& transforms, glm::mat4* out, uint32_t count)
+{
+	uint32_t i = 0;
+#ifdef ANIMATION_KERNELS_X86
+	i = m_simdLevel == ESimdLevel::AVX2 ? composeAVX2(transforms, out, count) : 0;
+	i += m_simdLevel != ESimdLevel::Scalar ? composeSSE(shift(transforms, i), out + i, count - i) : 0;
+#endif
+	composeScalar(transforms, out, i, count);
+}
+
+uint32_t AnimationKernels::getPaletteVectorNum(EPaletteFormat paletteFormat)
+{
+	switch (paletteFormat)
+	{
+	case EPaletteFormat::Affine: return 3;
+	case EPaletteFormat::DualQuat: return 2;
+	default: return 4;
+	}
+}
+
+void AnimationKernels::encodePalette(const glm::mat4* palette, glm::vec4* out, uint32_t count)
+{
+	// every bone is copied out before it is overwritten, its encoding starts at or before its matrix
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		glm::mat4 matrix = palette[i];
+		switch (m_paletteFormat)
+		{
+		case EPaletteFormat::Matrix:
+			for (uint32_t j = 0; j < 4; ++j)
+			{
+				out[i * 4 + j] = matrix[j];
+			}
+			break;
+		case EPaletteFormat::Affine:
+			for (uint32_t j = 0; j < 3; ++j)
+			{
+				out[i * 3 + j] = glm::vec4(matrix[0][j], matrix[1][j], matrix[2][j], matrix[3][j]);
+			}
+			break;
+		case EPaletteFormat::DualQuat:
+		{
+			glm::mat3 rotation(glm::normalize(glm::vec3(matrix[0])), glm::normalize(glm::vec3(matrix[1])), glm::normalize(glm::vec3(matrix[2])));
+			glm::quat real = glm::normalize(glm::quat_cast(rotation));
+			glm::vec3 translation(matrix[3]);
+
+			// dual = 0.5 * (0, translation) * real
+			glm::vec3 realVector(real.x, real.y, real.z);
+			glm::vec3 dualVector = 0.5f * (translation * real.w + glm::cross(translation, realVector));
+			out[i * 2] = glm::vec4(realVector, real.w);
+			out[i * 2 + 1] = glm::vec4(dualVector, -0.5f * glm::dot(translation, realVector));
+			break;
+		}
+		}
+	}
+}
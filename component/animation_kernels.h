@@ -0,0 +1,86 @@
+#pragma once
+
+#include "core/engine_type.h"
+
+enum class ESimdLevel
+{
+	Scalar, SSE, AVX2
+};
+
+// skinning palette layout in the bone uniform buffer: matrix columns, the 3 rows of an affine matrix,
+// or a rotation and a translation dual quaternion, which drops scale
+enum class EPaletteFormat
+{
+	Matrix, Affine, DualQuat
+};
+
+// one array per component, so a kernel loads the same component of several bones at once
+struct VectorStream
+{
+	float* x;
+	float* y;
+	float* z;
+};
+
+struct QuatStream
+{
+	float* x;
+	float* y;
+	float* z;
+	float* w;
+};
+
+struct TransformStreams
+{
+	VectorStream position;
+	QuatStream rotation;
+	VectorStream scale;
+
+	QuatTransform get(uint32_t index) const;
+	void set(uint32_t index, const QuatTransform& transform) const;
+};
+
+/*
+ * Batch kernels of animation sampling and pose evaluation over SoA streams
+ * The SSE and AVX2 paths process 4 and 8 bones per instruction, the scalar path computes the same formulas one bone at a time.
+ * The widest level the CPU supports is picked at init, animation_simd in the config can lower it.
+ * Rotations blend with nlerp on the shortest path, slerp is approximated by correcting t before the nlerp,
+ * so it stays vectorizable without acos and sin.
+ */
+class AnimationKernels
+{
+public:
+	static AnimationKernels& getInstance();
+	void init();
+	void destroy();
+
+	ESimdLevel getSimdLevel() { return m_simdLevel; }
+	static ESimdLevel getSupportedSimdLevel();
+	void setSimdLevel(ESimdLevel simdLevel);
+
+	bool isSlerpEnabled() { return m_slerp; }
+	void setSlerpEnabled(bool slerp) { m_slerp = slerp; }
+
+	// out = a + (b - a) * t, out may alias a or b
+	void lerp(const VectorStream& a, const VectorStream& b, const float* t, const VectorStream& out, uint32_t count);
+
+	// nlerp, or approximated slerp when enabled, out may alias a or b
+	void blend(const QuatStream& a, const QuatStream& b, const float* t, const QuatStream& out, uint32_t count);
+
+	// translation * rotation * scale of every bone as a column major matrix
+	void compose(const TransformStreams& transforms, glm::mat4* out, uint32_t count);
+
+	EPaletteFormat getPaletteFormat() { return m_paletteFormat; }
+	void setPaletteFormat(EPaletteFormat paletteFormat) { m_paletteFormat = paletteFormat; }
+
+	// vec4s per bone in a palette format
+	static uint32_t getPaletteVectorNum(EPaletteFormat paletteFormat);
+
+	// skinning matrices in the palette format, out may alias the matrices since no format is larger
+	void encodePalette(const glm::mat4* palette, glm::vec4* out, uint32_t count);
+
+private:
+	ESimdLevel m_simdLevel = ESimdLevel::Scalar;
+	bool m_slerp = false;
+	EPaletteFormat m_paletteFormat = EPaletteFormat::Matrix;
+};
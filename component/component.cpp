@@ -1,9 +1,11 @@
 #include "component/component.h"
 #include "rendering/resource_factory.h"
 #include "rendering/renderer.h"
+#include "rendering/streaming_service.h"
+#include "utility/thread_pool.h"
 #include <algorithm>
 
-void MeshComponent::updateUniformBuffer(std::shared_ptr<class Renderer> renderer, size_t bufferSize, void* bufferData)
+void MeshComponent::updateUniformBuffer(std::shared_ptr<class Renderer> renderer, size_t bufferSize, const void* bufferData)
 {
 	void* data;
 	VmaAllocation uniformBufferAllocation = batchResource->uniformBuffers[renderer->getImageIndex()].allocation;
@@ -12,17 +14,204 @@ void MeshComponent::updateUniformBuffer(std::shared_ptr<class Renderer> renderer
 	vmaUnmapMemory(renderer->getBackend()->getAllocator(), uniformBufferAllocation);
 }
 
-void StaticMeshComponent::initBatchResource(std::shared_ptr<class Renderer> renderer)
+void MeshComponent::setQuantization(std::shared_ptr<BasicBatchResource> basicBatchResource, const VertexQuantization& quantization)
+{
+	basicBatchResource->vpco.positionScale = glm::vec4(quantization.scale, 0.0f);
+	basicBatchResource->vpco.positionOffset = glm::vec4(quantization.offset, 0.0f);
+}
+
+void MeshComponent::setLods(std::shared_ptr<BasicBatchResource> basicBatchResource)
+{
+	basicBatchResource->lodIndexCounts.clear();
+	for (const MeshLod& lod : lods)
+	{
+		basicBatchResource->lodIndexCounts.push_back(lod.indexCounts);
+	}
+}
+
+void MeshComponent::selectLod(const glm::mat4& worldMatrix, const glm::vec3& cameraPosition, float lodScale, float hysteresis)
+{
+	if (!batchResource)
+	{
+		return;
+	}
+
+	float scale = glm::max(glm::length(glm::vec3(worldMatrix[0])), glm::max(glm::length(glm::vec3(worldMatrix[1])), glm::length(glm::vec3(worldMatrix[2]))));
+	glm::vec3 center = glm::vec3(worldMatrix * glm::vec4(bounds.center, 1.0f));
+	float radius = bounds.radius * scale;
+	float distance = glm::length(center - cameraPosition);
+
+	// the camera inside the bounds always sees full detail
+	lod = std::min(lod, static_cast<uint32_t>(lods.size()));
+	if (distance <= radius)
+	{
+		lod = 0;
+		batchResource->lod = lod;
+		return;
+	}
+
+	float errorScale = radius * lodScale / distance;
+	while (lod > 0 && lods[lod - 1].error * errorScale > 1.0f)
+	{
+		lod--;
+	}
+	while (lod < lods.size() && lods[lod].error * errorScale <= 1.0f - hysteresis)
+	{
+		lod++;
+	}
+	batchResource->lod = lod;
+}
+
+namespace
+{
+	// clip planes in object space, a sphere is outside when it lies fully behind one of them
+	void extractPlanes(const glm::mat4& mvp, glm::vec4* planes)
+	{
+		glm::vec4 rows[4];
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			rows[i] = glm::vec4(mvp[0][i], mvp[1][i], mvp[2][i], mvp[3][i]);
+		}
+		planes[0] = rows[3] + rows[0];
+		planes[1] = rows[3] - rows[0];
+		planes[2] = rows[3] + rows[1];
+		planes[3] = rows[3] - rows[1];
+		planes[4] = rows[2];
+		planes[5] = rows[3] - rows[2];
+		for (uint32_t i = 0; i < 6; ++i)
+		{
+			planes[i] /= glm::length(glm::vec3(planes[i]));
+		}
+	}
+}
+
+bool MeshComponent::isVisible(const glm::mat4& mvp) const
+{
+	glm::vec4 planes[6];
+	extractPlanes(mvp, planes);
+	for (const glm::vec4& plane : planes)
+	{
+		if (glm::dot(glm::vec3(plane), bounds.center) + plane.w < -bounds.radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void MeshComponent::cullMeshlets(const glm::mat4& worldMatrix, const glm::mat4& mvp, const glm::vec3& cameraPosition, ClusterCullStats& stats)
+{
+	if (!batchResource)
+	{
+		return;
+	}
+
+	std::vector<std::vector<IndexRange>>& visibleRanges = batchResource->visibleRanges;
+	visibleRanges.clear();
+	if (meshlets.empty() || batchResource->lod != 0)
+	{
+		return;
+	}
+
+	glm::vec4 planes[6];
+	extractPlanes(mvp, planes);
+
+	glm::vec3 localCameraPosition = glm::vec3(glm::inverse(worldMatrix) * glm::vec4(cameraPosition, 1.0f));
+
+	visibleRanges.resize(sections.size());
+	uint32_t meshletIndex = 0;
+	for (size_t i = 0; i < sections.size(); ++i)
+	{
+		for (; meshletIndex < sections[i].meshletCount; ++meshletIndex)
+		{
+			const Meshlet& meshlet = meshlets[meshletIndex];
+			stats.meshletCount++;
+
+			bool outside = false;
+			for (const glm::vec4& plane : planes)
+			{
+				outside |= glm::dot(glm::vec3(plane), meshlet.bounds.center) + plane.w < -meshlet.bounds.radius;
+			}
+			if (outside)
+			{
+				stats.frustumCulled++;
+				continue;
+			}
+
+			glm::vec3 direction = meshlet.bounds.center - localCameraPosition;
+			float distance = glm::length(direction);
+			if (distance > meshlet.bounds.radius && glm::dot(direction, meshlet.coneAxis) >= meshlet.coneCutoff * distance + meshlet.bounds.radius)
+			{
+				stats.backfaceCulled++;
+				continue;
+			}
+
+			std::vector<IndexRange>& ranges = visibleRanges[i];
+			if (!ranges.empty() && ranges.back().firstIndex + ranges.back().indexCount == meshlet.firstIndex)
+			{
+				ranges.back().indexCount += meshlet.indexCount;
+			}
+			else
+			{
+				ranges.push_back({ meshlet.firstIndex, meshlet.indexCount });
+			}
+		}
+	}
+}
+
+void MeshComponent::createUniformBuffers(std::shared_ptr<BasicBatchResource> basicBatchResource, size_t bufferSize)
+{
+	basicBatchResource->uniformBuffers.resize(SWAPCHAIN_IMAGE_NUM);
+	for (size_t i = 0; i < SWAPCHAIN_IMAGE_NUM; ++i)
+	{
+		ResourceFactory::getInstance().createBuffer(bufferSize,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VMA_MEMORY_USAGE_CPU_ONLY,
+			basicBatchResource->uniformBuffers[i]);
+	}
+}
+
+void MeshComponent::streamTextures(std::shared_ptr<BasicBatchResource> basicBatchResource)
+{
+	// the sections keep their materials alive until the worker has recorded the copies
+	std::vector<std::shared_ptr<Material>> materials;
+	VkDeviceSize size = 0;
+	for (const Section& section : sections)
+	{
+		materials.push_back(section.material);
+		size += section.material->baseTex->levelData.size();
+	}
+
+	StreamingService::getInstance().request(basicBatchResource, EStreamStage::Textures, size, [basicBatchResource, materials](UploadBatch& uploadBatch) {
+		auto& factory = ResourceFactory::getInstance();
+		for (size_t i = 0; i < materials.size(); ++i)
+		{
+			VmaImageViewSampler& baseIVS = basicBatchResource->baseIVSs[i];
+			VmaImage& vmaImage = baseIVS.vmaImage;
+
+			std::shared_ptr<Texture> baseTex = materials[i]->baseTex;
+			factory.createTextureImage(uploadBatch, baseTex, vmaImage);
+			baseIVS.view = factory.createImageView(vmaImage.image, vmaImage.format, VK_IMAGE_ASPECT_COLOR_BIT, vmaImage.mipLevels);
+			baseIVS.sampler = factory.createSampler(VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, vmaImage.mipLevels);
+		}
+	});
+}
+
+void StaticMeshComponent::initBatchResource(std::shared_ptr<class Renderer> renderer, UploadBatch& uploadBatch)
 {
 	// BasicBatchResource
 	auto& factory = ResourceFactory::getInstance();
 	auto basicBatchResource = std::make_shared<BasicBatchResource>();
 
-	uint32_t bufferSize = static_cast<uint32_t>(sizeof(mesh->vertices[0]) * mesh->vertices.size());
-	factory.createVertexBuffer(bufferSize, mesh->vertices.data(), basicBatchResource->vertexBuffer);
-	factory.createIndexBuffer(mesh->indices, basicBatchResource->indexBuffer);
+	uint32_t bufferSize = static_cast<uint32_t>(sizeof(mesh->packedVertices[0]) * mesh->packedVertices.size());
+	factory.createVertexBuffer(uploadBatch, bufferSize, mesh->packedVertices.data(), basicBatchResource->vertexBuffer);
+	factory.createIndexBuffer(uploadBatch, mesh->indices, mesh->indexType, basicBatchResource->indexBuffer);
+	basicBatchResource->indexType = factory.getIndexType(mesh->indexType);
+	setQuantization(basicBatchResource, mesh->quantization);
+	setLods(basicBatchResource);
 
 	basicBatchResource->indexCounts.resize(sections.size());
+	basicBatchResource->baseVertices.resize(sections.size());
 	basicBatchResource->baseIVSs.resize(sections.size());
 
 	for (size_t i = 0; i < sections.size(); ++i)
@@ -31,10 +220,11 @@ void StaticMeshComponent::initBatchResource(std::shared_ptr<class Renderer> rend
 		VmaImageViewSampler& baseIVS = basicBatchResource->baseIVSs[i];
 
 		basicBatchResource->indexCounts[i] = section.indexCount;
+		basicBatchResource->baseVertices[i] = section.baseVertex;
 
 		VmaImage& vmaImage = baseIVS.vmaImage;
-		factory.createTextureImage(section.material->baseTex, vmaImage);
-		baseIVS.view = factory.createImageView(vmaImage.image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, vmaImage.mipLevels);
+		factory.createTextureImage(uploadBatch, section.material->baseTex, vmaImage);
+		baseIVS.view = factory.createImageView(vmaImage.image, vmaImage.format, VK_IMAGE_ASPECT_COLOR_BIT, vmaImage.mipLevels);
 		baseIVS.sampler = factory.createSampler(VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, vmaImage.mipLevels);
 	}
 
@@ -52,6 +242,38 @@ void StaticMeshComponent::initBatchResource(std::shared_ptr<class Renderer> rend
 	renderer->getPipeline(EPipelineType::StaticMesh)->registerBatchResource(batchResource);
 }
 
+void StaticMeshComponent::streamBatchResource(std::shared_ptr<class Renderer> renderer)
+{
+	auto basicBatchResource = std::make_shared<BasicBatchResource>();
+	basicBatchResource->indexCounts.resize(sections.size());
+	basicBatchResource->baseVertices.resize(sections.size());
+	basicBatchResource->baseIVSs.resize(sections.size());
+	for (size_t i = 0; i < sections.size(); ++i)
+	{
+		basicBatchResource->indexCounts[i] = sections[i].indexCount;
+		basicBatchResource->baseVertices[i] = sections[i].baseVertex;
+	}
+	createUniformBuffers(basicBatchResource, sizeof(StaticMeshUBO));
+
+	setQuantization(basicBatchResource, mesh->quantization);
+	setLods(basicBatchResource);
+
+	std::shared_ptr<StaticMesh> streamedMesh = mesh;
+	VkDeviceSize indexSize = streamedMesh->indexType == EIndexType::Uint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	VkDeviceSize size = sizeof(streamedMesh->packedVertices[0]) * streamedMesh->packedVertices.size() + indexSize * streamedMesh->indices.size();
+	basicBatchResource->indexType = ResourceFactory::getInstance().getIndexType(streamedMesh->indexType);
+	StreamingService::getInstance().request(basicBatchResource, EStreamStage::Geometry, size, [basicBatchResource, streamedMesh](UploadBatch& uploadBatch) {
+		auto& factory = ResourceFactory::getInstance();
+		uint32_t bufferSize = static_cast<uint32_t>(sizeof(streamedMesh->packedVertices[0]) * streamedMesh->packedVertices.size());
+		factory.createVertexBuffer(uploadBatch, bufferSize, streamedMesh->packedVertices.data(), basicBatchResource->vertexBuffer);
+		factory.createIndexBuffer(uploadBatch, streamedMesh->indices, streamedMesh->indexType, basicBatchResource->indexBuffer);
+	});
+	streamTextures(basicBatchResource);
+
+	batchResource = basicBatchResource;
+	renderer->getPipeline(EPipelineType::StaticMesh)->registerBatchResource(batchResource);
+}
+
 void StaticMeshComponent::destroyBatchResource(std::shared_ptr<class Renderer> renderer)
 {
 	batchResource->destroy(renderer->getBackend()->getDevice(), renderer->getBackend()->getAllocator());
@@ -59,17 +281,102 @@ void StaticMeshComponent::destroyBatchResource(std::shared_ptr<class Renderer> r
 }
 
 
-void SkeletalMeshComponent::initBatchResource(std::shared_ptr<class Renderer> renderer)
+bool SkeletalMeshComponent::shareBatchResource(std::shared_ptr<class Renderer> renderer)
 {
-	// BasicBatchResource
+	auto pipeline = std::static_pointer_cast<SkeletalMeshPipeline>(renderer->getPipeline(EPipelineType::SkeletalMesh));
+	std::shared_ptr<SkeletalBatchResource> skeletalBatchResource = pipeline->findBatchResource(mesh.get());
+	if (!skeletalBatchResource)
+	{
+		return false;
+	}
+	skeletalBatchResource->userCount++;
+	batchResource = skeletalBatchResource;
+	return true;
+}
+
+void SkeletalMeshComponent::initInstances(std::shared_ptr<class Renderer> renderer, std::shared_ptr<SkeletalBatchResource> skeletalBatchResource)
+{
+	auto& kernels = AnimationKernels::getInstance();
+	uint32_t boneNum = skeleton->getBoneNum();
+	skeletalBatchResource->mesh = mesh.get();
+	skeletalBatchResource->userCount = 1;
+	skeletalBatchResource->paletteStride = boneNum * AnimationKernels::getPaletteVectorNum(kernels.getPaletteFormat());
+
+	// identity skinning matrices leave the vertices in the bind pose
+	std::vector<glm::mat4> bindMatrices(boneNum, glm::mat4(1.0f));
+	skeletalBatchResource->bindPalette.resize(skeletalBatchResource->paletteStride);
+	kernels.encodePalette(bindMatrices.data(), skeletalBatchResource->bindPalette.data(), boneNum);
+
+	auto pipeline = std::static_pointer_cast<SkeletalMeshPipeline>(renderer->getPipeline(EPipelineType::SkeletalMesh));
+	for (uint32_t i = 0; i < SWAPCHAIN_IMAGE_NUM; ++i)
+	{
+		pipeline->reserveInstances(*skeletalBatchResource, i, 1);
+	}
+}
+
+void SkeletalMeshComponent::initBakedBatchResource(std::shared_ptr<class Renderer> renderer, UploadBatch& uploadBatch)
+{
+	auto pipeline = std::static_pointer_cast<VertexAnimationPipeline>(renderer->getPipeline(EPipelineType::VertexAnimation));
+	bakedBatchResource = std::static_pointer_cast<VertexAnimationBatchResource>(pipeline->findBatchResource(mesh.get()));
+	if (bakedBatchResource)
+	{
+		bakedBatchResource->userCount++;
+		return;
+	}
+
+	// the geometry and base textures are borrowed from the skinned batch, only the baked frames are uploaded
 	auto& factory = ResourceFactory::getInstance();
-	auto basicBatchResource = std::make_shared<BasicBatchResource>();
+	bakedBatchResource = std::make_shared<VertexAnimationBatchResource>();
+	bakedBatchResource->vertexBuffer = batchResource->vertexBuffer;
+	bakedBatchResource->indexBuffer = batchResource->indexBuffer;
+	bakedBatchResource->indexType = batchResource->indexType;
+	bakedBatchResource->indexCounts = batchResource->indexCounts;
+	bakedBatchResource->baseVertices = batchResource->baseVertices;
+	bakedBatchResource->lodIndexCounts = batchResource->lodIndexCounts;
+	bakedBatchResource->baseIVSs = batchResource->baseIVSs;
+	bakedBatchResource->textureWidth = vertexAnimation->width;
+	bakedBatchResource->rowsPerFrame = vertexAnimation->rowsPerFrame;
+
+	VmaImageViewSampler& animationIVS = bakedBatchResource->animationIVS;
+	factory.createTextureImage(uploadBatch, vertexAnimation->texture, animationIVS.vmaImage);
+	animationIVS.view = factory.createImageView(animationIVS.vmaImage.image, animationIVS.vmaImage.format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+	animationIVS.sampler = factory.createSampler(VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, 1);
+
+	// an instance's palette is the vec4 of its frames
+	bakedBatchResource->mesh = mesh.get();
+	bakedBatchResource->userCount = 1;
+	bakedBatchResource->paletteStride = 1;
+	for (uint32_t i = 0; i < SWAPCHAIN_IMAGE_NUM; ++i)
+	{
+		pipeline->reserveInstances(*bakedBatchResource, i, 1);
+	}
+	pipeline->registerBatchResource(bakedBatchResource);
+}
 
-	uint32_t bufferSize = static_cast<uint32_t>(sizeof(mesh->vertices[0]) * mesh->vertices.size());
-	factory.createVertexBuffer(bufferSize, mesh->vertices.data(), basicBatchResource->vertexBuffer);
-	factory.createIndexBuffer(mesh->indices, basicBatchResource->indexBuffer);
+void SkeletalMeshComponent::initBatchResource(std::shared_ptr<class Renderer> renderer, UploadBatch& uploadBatch)
+{
+	if (shareBatchResource(renderer))
+	{
+		if (vertexAnimation)
+		{
+			initBakedBatchResource(renderer, uploadBatch);
+		}
+		return;
+	}
+
+	// SkeletalBatchResource
+	auto& factory = ResourceFactory::getInstance();
+	auto basicBatchResource = std::make_shared<SkeletalBatchResource>();
+
+	uint32_t bufferSize = static_cast<uint32_t>(sizeof(mesh->packedVertices[0]) * mesh->packedVertices.size());
+	factory.createVertexBuffer(uploadBatch, bufferSize, mesh->packedVertices.data(), basicBatchResource->vertexBuffer);
+	factory.createIndexBuffer(uploadBatch, mesh->indices, mesh->indexType, basicBatchResource->indexBuffer);
+	basicBatchResource->indexType = factory.getIndexType(mesh->indexType);
+	setQuantization(basicBatchResource, mesh->quantization);
+	setLods(basicBatchResource);
 
 	basicBatchResource->indexCounts.resize(sections.size());
+	basicBatchResource->baseVertices.resize(sections.size());
 	basicBatchResource->baseIVSs.resize(sections.size());
 
 	for (size_t i = 0; i < sections.size(); ++i)
@@ -78,33 +385,114 @@ void SkeletalMeshComponent::initBatchResource(std::shared_ptr<class Renderer> re
 		VmaImageViewSampler& baseIVS = basicBatchResource->baseIVSs[i];
 
 		basicBatchResource->indexCounts[i] = section.indexCount;
+		basicBatchResource->baseVertices[i] = section.baseVertex;
 
 		VmaImage& vmaImage = baseIVS.vmaImage;
-		factory.createTextureImage(section.material->baseTex, vmaImage);
-		baseIVS.view = factory.createImageView(vmaImage.image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, vmaImage.mipLevels);
+		factory.createTextureImage(uploadBatch, section.material->baseTex, vmaImage);
+		baseIVS.view = factory.createImageView(vmaImage.image, vmaImage.format, VK_IMAGE_ASPECT_COLOR_BIT, vmaImage.mipLevels);
 		baseIVS.sampler = factory.createSampler(VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, vmaImage.mipLevels);
 	}
 
-	basicBatchResource->uniformBuffers.resize(SWAPCHAIN_IMAGE_NUM);
-	for (size_t i = 0; i < SWAPCHAIN_IMAGE_NUM; ++i)
+	initInstances(renderer, basicBatchResource);
+
+	// עᵽStaticMeshPipeline
+	batchResource = basicBatchResource;
+	renderer->getPipeline(EPipelineType::SkeletalMesh)->registerBatchResource(batchResource);
+
+	if (vertexAnimation)
 	{
-		factory.createBuffer(sizeof(SkeletalMeshUBO),
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VMA_MEMORY_USAGE_CPU_ONLY,
-			basicBatchResource->uniformBuffers[i]);
+		initBakedBatchResource(renderer, uploadBatch);
 	}
+}
+
+void SkeletalMeshComponent::streamBatchResource(std::shared_ptr<class Renderer> renderer)
+{
+	if (shareBatchResource(renderer))
+	{
+		return;
+	}
+
+	auto basicBatchResource = std::make_shared<SkeletalBatchResource>();
+	basicBatchResource->indexCounts.resize(sections.size());
+	basicBatchResource->baseVertices.resize(sections.size());
+	basicBatchResource->baseIVSs.resize(sections.size());
+	for (size_t i = 0; i < sections.size(); ++i)
+	{
+		basicBatchResource->indexCounts[i] = sections[i].indexCount;
+		basicBatchResource->baseVertices[i] = sections[i].baseVertex;
+	}
+	initInstances(renderer, basicBatchResource);
+
+	setQuantization(basicBatchResource, mesh->quantization);
+	setLods(basicBatchResource);
+
+	std::shared_ptr<SkeletalMesh> streamedMesh = mesh;
+	VkDeviceSize indexSize = streamedMesh->indexType == EIndexType::Uint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	VkDeviceSize size = sizeof(streamedMesh->packedVertices[0]) * streamedMesh->packedVertices.size() + indexSize * streamedMesh->indices.size();
+	basicBatchResource->indexType = ResourceFactory::getInstance().getIndexType(streamedMesh->indexType);
+	StreamingService::getInstance().request(basicBatchResource, EStreamStage::Geometry, size, [basicBatchResource, streamedMesh](UploadBatch& uploadBatch) {
+		auto& factory = ResourceFactory::getInstance();
+		uint32_t bufferSize = static_cast<uint32_t>(sizeof(streamedMesh->packedVertices[0]) * streamedMesh->packedVertices.size());
+		factory.createVertexBuffer(uploadBatch, bufferSize, streamedMesh->packedVertices.data(), basicBatchResource->vertexBuffer);
+		factory.createIndexBuffer(uploadBatch, streamedMesh->indices, streamedMesh->indexType, basicBatchResource->indexBuffer);
+	});
+	streamTextures(basicBatchResource);
 
-	// עᵽStaticMeshPipeline
 	batchResource = basicBatchResource;
 	renderer->getPipeline(EPipelineType::SkeletalMesh)->registerBatchResource(batchResource);
 }
 
 void SkeletalMeshComponent::destroyBatchResource(std::shared_ptr<class Renderer> renderer)
 {
+	// the batches stay until the last component drawing their mesh is gone
+	if (bakedBatchResource && --bakedBatchResource->userCount == 0)
+	{
+		bakedBatchResource->destroy(renderer->getBackend()->getDevice(), renderer->getBackend()->getAllocator());
+		renderer->getPipeline(EPipelineType::VertexAnimation)->unregisterBatchResource(bakedBatchResource);
+	}
+
+	SkeletalBatchResource& skeletalBatchResource = static_cast<SkeletalBatchResource&>(*batchResource);
+	if (--skeletalBatchResource.userCount > 0)
+	{
+		return;
+	}
 	batchResource->destroy(renderer->getBackend()->getDevice(), renderer->getBackend()->getAllocator());
 	renderer->getPipeline(EPipelineType::SkeletalMesh)->unregisterBatchResource(batchResource);
 }
 
+void SkeletalMeshComponent::addInstance(const glm::mat4& worldMatrix, const glm::vec4* palette)
+{
+	SkeletalBatchResource& skeletalBatchResource = static_cast<SkeletalBatchResource&>(*batchResource);
+	if (!palette)
+	{
+		palette = skeletalBatchResource.bindPalette.data();
+	}
+	skeletalBatchResource.instanceMatrices.push_back(worldMatrix);
+	skeletalBatchResource.instancePalettes.insert(skeletalBatchResource.instancePalettes.end(), palette, palette + skeletalBatchResource.paletteStride);
+
+	// the batch is drawn at the finest level any of its instances needs
+	skeletalBatchResource.lod = std::min(skeletalBatchResource.lod, lod);
+}
+
+bool SkeletalMeshComponent::hasBakedClip(const std::string& name) const
+{
+	return bakedBatchResource && vertexAnimation->clips.find(name) != vertexAnimation->clips.end();
+}
+
+void SkeletalMeshComponent::addBakedInstance(const glm::mat4& worldMatrix, const std::string& name, float animTime, bool loop)
+{
+	// the last frame of a looping clip blends back into its first, a clip played once holds its last frame
+	const BakedClip& clip = vertexAnimation->clips.at(name);
+	float frame = clip.duration > 0.0f ? animTime / clip.duration * static_cast<float>(clip.frameCount) : 0.0f;
+	uint32_t frame0 = std::min(static_cast<uint32_t>(frame), clip.frameCount - 1);
+	uint32_t frame1 = loop ? (frame0 + 1) % clip.frameCount : std::min(frame0 + 1, clip.frameCount - 1);
+
+	bakedBatchResource->instanceMatrices.push_back(worldMatrix);
+	bakedBatchResource->instancePalettes.push_back(glm::vec4(static_cast<float>(clip.firstFrame + frame0), static_cast<float>(clip.firstFrame + frame1),
+		glm::clamp(frame - static_cast<float>(frame0), 0.0f, 1.0f), 0.0f));
+	bakedBatchResource->lod = std::min(bakedBatchResource->lod, lod);
+}
+
 
 AnimatorComponent::AnimatorComponent()
 {
@@ -113,9 +501,13 @@ AnimatorComponent::AnimatorComponent()
 	m_playing = false;
 	m_paused = false;
 	m_name.clear();
+	m_lod = EAnimationLod::Full;
+	m_maxBoneDepth = UINT32_MAX;
+	m_ticksSinceUpdate = UINT32_MAX;
+	m_phaseSnapped = false;
 }
 
-bool AnimatorComponent::isCompatible(std::shared_ptr<Skeleton> skeleton)
+bool AnimatorComponent::isCompatible(std::shared_ptr<const Skeleton> skeleton)
 {
 	for (auto& iter : animations)
 	{
@@ -129,14 +521,67 @@ bool AnimatorComponent::isCompatible(std::shared_ptr<Skeleton> skeleton)
 
 void AnimatorComponent::merge(const AnimatorComponent& other)
 {
+	// the bindings are shared, a merged clip may live at the address of a destroyed one
+	for (const auto& iter : other.animations)
+	{
+		BoneBindingCache::getInstance().invalidate(iter.second.get());
+	}
 	animations.insert(other.animations.begin(), other.animations.end());
 }
 
 void AnimatorComponent::tick(float deltaTime)
 {
-	if (m_playing && !m_paused && animations.find(m_name) != animations.end())
+	// a new skeleton or a copied component starts from the bind pose in a pose block of its own
+	if (m_boundSkeleton != skeleton || !m_pose.isValid())
+	{
+		m_boundSkeleton = skeleton;
+		m_pose.reset(*skeleton);
+		m_sharedPose.reset();
+		m_ticksSinceUpdate = UINT32_MAX;
+	}
+
+	// every tick advances the clock, so an animator that was skipped, baked or culled resumes in step with the others,
+	// a stale pose is evaluated on the first tick it is visible again
+	const uint32_t updateIntervals[] = { 1, 2, 4 };
+	m_ticksSinceUpdate = m_ticksSinceUpdate < UINT32_MAX ? m_ticksSinceUpdate + 1 : m_ticksSinceUpdate;
+	if (m_lod == EAnimationLod::Culled || m_lod == EAnimationLod::Baked || m_ticksSinceUpdate < updateIntervals[static_cast<uint32_t>(m_lod)])
+	{
+		if (m_playing && !m_paused && m_animation)
+		{
+			m_time += deltaTime;
+		}
+		return;
+	}
+	m_ticksSinceUpdate = 0;
+
+	PoseCache& poseCache = PoseCache::getInstance();
+	bool sharing = poseCache.getShareRate() > 0.0f;
+	bool advancing = m_playing && !m_paused && m_animation;
+
+	// shared poses sample every bone, an animator with a reduced bone set samples its own so its deeper bones keep their last pose
+	bool sharingPose = sharing && m_maxBoneDepth == UINT32_MAX;
+
+	// a paused or stopped animator, or one that stops sharing, goes on from the last shared pose instead of its stale own one
+	if (m_sharedPose && (!sharingPose || !advancing))
+	{
+		const TransformStreams& sharedLocalPoses = m_sharedPose->pose.getLocalPoses();
+		for (uint32_t i = 0; i < m_pose.getBoneNum(); ++i)
+		{
+			m_pose.getLocalPoses().set(i, sharedLocalPoses.get(i));
+		}
+		m_sharedPose.reset();
+	}
+
+	if (advancing)
 	{
-		auto& animation = animations[m_name];
+		// snapped once, animators on the same phase stay there since they all advance by the same delta time
+		if (sharing && !m_phaseSnapped && poseCache.getPhaseSnap() > 0.0f)
+		{
+			m_time = poseCache.snap(m_time);
+			m_phaseSnapped = true;
+		}
+
+		const std::shared_ptr<Animation>& animation = m_animation;
 		float animTime = m_time * animation->frameRate;
 		if (animTime > animation->duration)
 		{
@@ -150,66 +595,51 @@ void AnimatorComponent::tick(float deltaTime)
 				return;
 			}
 		}
-		for (auto& iter : animation->positionKeys)
-		{
-			const std::string& name = iter.first;
-			const std::vector<VectorKey>& positions = iter.second;
-
-			VectorKey val{ animTime };
-			auto low = std::lower_bound(positions.begin(), positions.end(), val);
-			auto up = std::upper_bound(positions.begin(), positions.end(), val);
 
-			const VectorKey& lowKey = low == positions.begin() ? *low : *(low - 1);
-			const VectorKey& upKey = up == positions.end() ? *(up - 1) : *up;
-
-			float t = lowKey.time != upKey.time ? (animTime - lowKey.time) / (upKey.time - lowKey.time) : 0.0f;
-			Bone& bone = skeleton->getBone(name);
-			bone.animatedTransform.position = glm::mix(lowKey.value, upKey.value, t);
+		if (sharingPose)
+		{
+			m_sharedPose = poseCache.acquire(skeleton, animation, *BoneBindingCache::getInstance().get(skeleton, animation, UINT32_MAX), animTime / animation->frameRate);
+			m_time += deltaTime;
+			return;
 		}
 
-		for (auto& iter : animation->rotationKeys)
-		{
-			const std::string& name = iter.first;
-			const std::vector<QuatKey>& rotations = iter.second;
+		animation->sample(animTime, *BoneBindingCache::getInstance().get(skeleton, animation, m_maxBoneDepth), m_pose.getLocalPoses());
 
-			QuatKey val{ animTime };
-			auto low = std::lower_bound(rotations.begin(), rotations.end(), val);
-			auto up = std::upper_bound(rotations.begin(), rotations.end(), val);
+		m_time += deltaTime;
+	}
 
-			const QuatKey& lowKey = low == rotations.begin() ? *low : *(low - 1);
-			const QuatKey& upKey = up == rotations.end() ? *(up - 1) : *up;
+	// the pose block keeps a full matrix per bone, the encoded palette is written over it
+	skeleton->evaluate(m_pose.getLocalPoses(), m_pose.getPalette());
+	AnimationKernels::getInstance().encodePalette(m_pose.getPalette(), reinterpret_cast<glm::vec4*>(m_pose.getPalette()), m_pose.getBoneNum());
+}
 
-			float t = lowKey.time != upKey.time ? (animTime - lowKey.time) / (upKey.time - lowKey.time) : 0.0f;
-			Bone& bone = skeleton->getBone(name);
-			bone.animatedTransform.rotation = glm::slerp(lowKey.value, upKey.value, t);
+void AnimatorComponent::tickAll(const std::vector<AnimatorComponent*>& animators, float deltaTime, bool parallel)
+{
+	// a batch amortizes the cost of claiming work, animators are small
+	const uint32_t batchSize = 8;
+	uint32_t animatorNum = static_cast<uint32_t>(animators.size());
+	if (!parallel || animatorNum <= batchSize)
+	{
+		for (AnimatorComponent* animator : animators)
+		{
+			animator->tick(deltaTime);
 		}
+		return;
+	}
 
-		for (auto& iter : animation->scaleKeys)
+	ThreadPool::getInstance().parallelFor((animatorNum + batchSize - 1) / batchSize, [&animators, animatorNum, deltaTime](uint32_t batch) {
+		uint32_t end = std::min((batch + 1) * batchSize, animatorNum);
+		for (uint32_t i = batch * batchSize; i < end; ++i)
 		{
-			const std::string& name = iter.first;
-			const std::vector<VectorKey>& scales = iter.second;
-
-			VectorKey val{ animTime };
-			auto low = std::lower_bound(scales.begin(), scales.end(), val);
-			auto up = std::upper_bound(scales.begin(), scales.end(), val);
-
-			const VectorKey& lowKey = low == scales.begin() ? *low : *(low - 1);
-			const VectorKey& upKey = up == scales.end() ? *(up - 1) : *up;
-
-			float t = lowKey.time != upKey.time ? (animTime - lowKey.time) / (upKey.time - lowKey.time) : 0.0f;
-			Bone& bone = skeleton->getBone(name);
-			bone.animatedTransform.scale = glm::mix(lowKey.value, upKey.value, t);
+			animators[i]->tick(deltaTime);
 		}
+	});
+}
 
-		m_time += deltaTime;
-	}
-
-	skeleton->update();
-	uint32_t boneNum = std::min(static_cast<uint32_t>(skeleton->bones.size()), static_cast<uint32_t>(MAX_BONE_NUM));
-	for (size_t i = 0; i < boneNum; ++i)
-	{
-		gBones[i] = skeleton->bones[i].matrix();
-	}
+void AnimatorComponent::setLod(EAnimationLod lod, uint32_t maxBoneDepth)
+{
+	m_lod = lod;
+	m_maxBoneDepth = maxBoneDepth;
 }
 
 void AnimatorComponent::play(const std::string& name, bool loop)
@@ -225,9 +655,24 @@ void AnimatorComponent::play(const std::string& name, bool loop)
 		m_name = animations.begin()->first;
 	}
 
+	auto iter = animations.find(m_name);
+	m_animation = iter != animations.end() ? iter->second : nullptr;
+
 	m_loop = loop;
 	m_playing = true;
 	m_time = 0.0f;
+	m_phaseSnapped = false;
+}
+
+float AnimatorComponent::getAnimationTime() const
+{
+	if (!m_animation)
+	{
+		return 0.0f;
+	}
+
+	float animTime = m_time * m_animation->frameRate;
+	return m_loop ? fmod(animTime, m_animation->duration) : std::min(animTime, m_animation->duration);
 }
 
 void AnimatorComponent::replay()
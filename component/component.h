@@ -3,8 +3,12 @@
 #include "material.h"
 #include "mesh.h"
 #include "animation.h"
+#include "pose_pool.h"
+#include "pose_cache.h"
 #include "rendering/batch_resource.h"
 
+#include <entt/entt.hpp>
+
 /* Base */
 struct Component
 {
@@ -28,6 +32,11 @@ struct TransformComponent : public Transform, public Component
 	glm::mat4 localMatrix = glm::mat4(1.0f);
 	glm::mat4 worldMatrix = glm::mat4(1.0f);
 
+	// the TransformHierarchy keeps the storage sorted by depth, parentIndex is the position of the parent in it, UINT32_MAX for a root
+	entt::entity parent = entt::null;
+	uint32_t depth = 0;
+	uint32_t parentIndex = UINT32_MAX;
+
 	virtual bool isValid() override
 	{
 		return true;
@@ -39,6 +48,45 @@ struct Section
 {
 	std::shared_ptr<Material> material;
 	uint32_t indexCount;
+
+	// first vertex of the section, its indices are relative to it
+	uint32_t baseVertex = 0;
+
+	// cumulative count of the section's full detail meshlets
+	uint32_t meshletCount = 0;
+};
+
+struct ClusterCullStats
+{
+	uint32_t meshletCount = 0;
+	uint32_t frustumCulled = 0;
+	uint32_t backfaceCulled = 0;
+
+	float getCullRate() const { return meshletCount > 0 ? static_cast<float>(frustumCulled + backfaceCulled) / meshletCount : 0.0f; }
+};
+
+// animators per update policy in the last animation tick, and the bone palettes uploaded and skipped in the last frame
+struct AnimationLodStats
+{
+	uint32_t full = 0;
+	uint32_t half = 0;
+	uint32_t quarter = 0;
+	uint32_t baked = 0;
+	uint32_t culled = 0;
+	uint32_t paletteUploads = 0;
+	uint32_t paletteSkips = 0;
+	uint32_t sharedPoses = 0;
+	uint32_t evaluatedPoses = 0;
+};
+
+// a simplified level of detail of all sections, its indices follow the previous level's in the mesh index buffer
+struct MeshLod
+{
+	// geometric error relative to the bounding sphere radius
+	float error = 0.0f;
+
+	// cumulative index count of each section, counted from the start of the index buffer like Section::indexCount
+	std::vector<uint32_t> indexCounts;
 };
 
 struct MeshComponent : public Component
@@ -48,18 +96,43 @@ struct MeshComponent : public Component
 		return !sections.empty();
 	}
 
-	virtual void initBatchResource(std::shared_ptr<class Renderer> renderer) = 0;
+	virtual void initBatchResource(std::shared_ptr<class Renderer> renderer, class UploadBatch& uploadBatch) = 0;
+
+	// uploads in the background through the StreamingService, the mesh is drawn once its geometry is resident
+	virtual void streamBatchResource(std::shared_ptr<class Renderer> renderer) = 0;
 	virtual void destroyBatchResource(std::shared_ptr<class Renderer> renderer) = 0;
-	virtual void updateUniformBuffer(std::shared_ptr<class Renderer> renderer, size_t bufferSize, void* bufferData);
+	virtual void updateUniformBuffer(std::shared_ptr<class Renderer> renderer, size_t bufferSize, const void* bufferData);
+
+	void setQuantization(std::shared_ptr<BasicBatchResource> basicBatchResource, const VertexQuantization& quantization);
+	void createUniformBuffers(std::shared_ptr<BasicBatchResource> basicBatchResource, size_t bufferSize);
+	void streamTextures(std::shared_ptr<BasicBatchResource> basicBatchResource);
+	void setLods(std::shared_ptr<BasicBatchResource> basicBatchResource);
+
+	// picks the coarsest level whose error projects below one unit of lodScale, which is pixels per world unit at
+	// distance one divided by the allowed pixel error, a finer level is only left once the error has shrunk by the hysteresis
+	void selectLod(const glm::mat4& worldMatrix, const glm::vec3& cameraPosition, float lodScale, float hysteresis);
+
+	// false when the bounding sphere lies fully outside one of the clip planes of mvp
+	bool isVisible(const glm::mat4& mvp) const;
+
+	// drops off screen and back facing meshlets of the full detail level, the test runs in object space against the planes of mvp
+	void cullMeshlets(const glm::mat4& worldMatrix, const glm::mat4& mvp, const glm::vec3& cameraPosition, ClusterCullStats& stats);
 
 	std::vector<Section> sections;
+	std::vector<MeshLod> lods;
+	std::vector<Meshlet> meshlets;
+	BoundingSphere bounds;
 	std::shared_ptr<BasicBatchResource> batchResource;
+
+	// level of detail picked for this component, instances sharing a batch may pick different ones
+	uint32_t lod = 0;
 };
 
 /* Static Mesh */
 struct StaticMeshComponent : public MeshComponent
 {
-	virtual void initBatchResource(std::shared_ptr<class Renderer> renderer) override;
+	virtual void initBatchResource(std::shared_ptr<class Renderer> renderer, class UploadBatch& uploadBatch) override;
+	virtual void streamBatchResource(std::shared_ptr<class Renderer> renderer) override;
 	virtual void destroyBatchResource(std::shared_ptr<class Renderer> renderer) override;
 
 	std::shared_ptr<StaticMesh> mesh;
@@ -68,14 +141,45 @@ struct StaticMeshComponent : public MeshComponent
 /* Skeletal Mesh */
 struct SkeletalMeshComponent : public MeshComponent
 {
-	virtual void initBatchResource(std::shared_ptr<class Renderer> renderer) override;
+	virtual void initBatchResource(std::shared_ptr<class Renderer> renderer, class UploadBatch& uploadBatch) override;
+	virtual void streamBatchResource(std::shared_ptr<class Renderer> renderer) override;
 	virtual void destroyBatchResource(std::shared_ptr<class Renderer> renderer) override;
 
-	std::shared_ptr<Skeleton> skeleton;
+	// adds this component to the instances its batch draws this frame, the bind pose is drawn without a palette
+	void addInstance(const glm::mat4& worldMatrix, const glm::vec4* palette);
+
+	// true when the clip can be played from the vertex animation texture
+	bool hasBakedClip(const std::string& name) const;
+
+	// adds this component to the instances of its baked batch, playing the clip at animTime in ticks
+	void addBakedInstance(const glm::mat4& worldMatrix, const std::string& name, float animTime, bool loop);
+
+	std::shared_ptr<const Skeleton> skeleton;
 	std::shared_ptr<SkeletalMesh> mesh;
+
+	// the clips baked for distant instances, shared by the components drawing the mesh, null when not baked
+	std::shared_ptr<VertexAnimation> vertexAnimation;
+	std::shared_ptr<VertexAnimationBatchResource> bakedBatchResource;
+
+private:
+	// joins the batch of another component drawing the same mesh, false when this is the first one
+	bool shareBatchResource(std::shared_ptr<class Renderer> renderer);
+
+	// instance buffers and the bind palette of a new batch, before it is registered
+	void initInstances(std::shared_ptr<class Renderer> renderer, std::shared_ptr<SkeletalBatchResource> skeletalBatchResource);
+
+	// the batch of the vertex animation pipeline, drawing the geometry and textures of the skinned batch
+	void initBakedBatchResource(std::shared_ptr<class Renderer> renderer, class UploadBatch& uploadBatch);
 };
 
 /* Animator */
+// update policy of an animator, picked from the screen size of its mesh, Quarter also stops sampling the bones below the reduced depth,
+// a Baked animator only keeps time while its mesh plays the clip from the vertex animation texture
+enum class EAnimationLod
+{
+	Full, Half, Quarter, Baked, Culled
+};
+
 struct AnimatorComponent : public Component
 {
 public:
@@ -86,23 +190,53 @@ public:
 		return !animations.empty();
 	}
 
-	bool isCompatible(std::shared_ptr<Skeleton> skeleton);
+	bool isCompatible(std::shared_ptr<const Skeleton> skeleton);
 	void merge(const AnimatorComponent& other);
 	void tick(float deltaTime);
 
+	// ticks every animator, in batches over the thread pool when parallel, an animator only writes its own pose
+	static void tickAll(const std::vector<AnimatorComponent*>& animators, float deltaTime, bool parallel);
+
+	// ticks between two evaluations follow the lod, skipped ticks only advance the clip time and a culled animator is not evaluated,
+	// maxBoneDepth limits the sampled channels to the bones at most that many parents below a root,
+	// such an animator bypasses the PoseCache since shared poses sample every bone
+	void setLod(EAnimationLod lod, uint32_t maxBoneDepth = UINT32_MAX);
+	EAnimationLod getLod() const { return m_lod; }
+
 	void play(const std::string& name = "", bool loop = true);
 	void replay();
 	void pause();
 	void stop();
 
-	std::shared_ptr<Skeleton> skeleton;
+	bool isPlaying() const { return m_playing; }
+	bool isLooping() const { return m_loop; }
+	const std::string& getAnimationName() const { return m_name; }
+
+	// time of the playing clip in ticks, wrapped for looping clips
+	float getAnimationTime() const;
+
+	std::shared_ptr<const Skeleton> skeleton;
 	std::map<std::string, std::shared_ptr<Animation>> animations;
-	glm::mat4 gBones[MAX_BONE_NUM];
+
+	// skinning palette of this instance in the palette format of the AnimationKernels, empty before the first tick,
+	// the size is in bones, each taking getPaletteVectorNum vec4s, a playing clip reads it from the PoseCache when sharing is enabled
+	const glm::vec4* getPalette() const { return reinterpret_cast<const glm::vec4*>(getPose().getPalette()); }
+	uint32_t getPaletteSize() const { return getPose().getBoneNum(); }
 
 private:
+	const PoseBuffer& getPose() const { return m_sharedPose ? m_sharedPose->pose : m_pose; }
+
 	float m_time;
 	bool m_loop;
 	bool m_playing;
 	bool m_paused;
 	std::string m_name;
+	std::shared_ptr<Animation> m_animation;
+	std::shared_ptr<const Skeleton> m_boundSkeleton;
+	EAnimationLod m_lod;
+	uint32_t m_maxBoneDepth;
+	uint32_t m_ticksSinceUpdate;
+	bool m_phaseSnapped;
+	PoseBuffer m_pose;
+	std::shared_ptr<const SharedPose> m_sharedPose;
 };
\ No newline at end of file
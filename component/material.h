@@ -3,16 +3,41 @@
 #include <glm/glm.hpp>
 #include <memory>
 #include <string>
+#include <vector>
+
+enum class ETextureFormat
+{
+	RGBA8, BC1, BC3, BC5, BC7,
+
+	// baked data rather than images, never compressed
+	RGBA16F
+};
+
+struct TextureLevel
+{
+	uint32_t width;
+	uint32_t height;
+	size_t offset;
+	size_t size;
+};
 
 struct Texture
 {
 	std::string name;
+	std::string filename;
 	int width;
 	int height;
 	int channels;
 
+	// decoded RGBA8 pixels of the top level, freed once the texture has been cooked into levels
 	uint8_t* data = nullptr;
 
+	// mip levels precomputed at cook time and packed in levelData, uploaded to the GPU as they are
+	ETextureFormat format = ETextureFormat::RGBA8;
+	bool srgb = true;
+	std::vector<TextureLevel> levels;
+	std::vector<uint8_t> levelData;
+
 	~Texture()
 	{
 		if (data)
@@ -3,6 +3,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
+#include <type_traits>
 
 struct StaticVertex
 {
@@ -17,14 +18,117 @@ struct SkeletalVertex : public StaticVertex
 	glm::vec4 weights;
 };
 
+enum class EIndexType
+{
+	Uint16, Uint32
+};
+
+enum class EVertexPositionFormat
+{
+	Unorm16, Half
+};
+
+// GPU vertices, positions are quantized against the mesh bounds and normals are octahedral
+struct PackedStaticVertex
+{
+	uint16_t position[4]; // unorm16 or half, w is padding
+	uint16_t texCoord[2]; // half, so tiled UVs outside [0, 1] survive
+	int16_t normal[2]; // snorm16
+};
+
+// the static attributes are repeated instead of inherited, so the struct stays standard layout for offsetof
+struct PackedSkeletalVertex
+{
+	uint16_t position[4];
+	uint16_t texCoord[2];
+	int16_t normal[2];
+	uint16_t bones[4]; // skeletons may have more than 255 bones
+	uint8_t weights[4]; // unorm8, summing to 255
+};
+
+static_assert(std::is_standard_layout<PackedStaticVertex>::value && sizeof(PackedStaticVertex) == 16, "the packed static vertex layout is read by the static mesh pipeline");
+static_assert(std::is_standard_layout<PackedSkeletalVertex>::value && sizeof(PackedSkeletalVertex) == 28, "the packed skeletal vertex layout is read by the skeletal mesh pipelines");
+
+// the vertex shader decodes position = offset + quantized position * scale
+struct VertexQuantization
+{
+	glm::vec3 scale = glm::vec3(1.0f);
+	glm::vec3 offset = glm::vec3(0.0f);
+};
+
+// section relative indices fit in 16 bits unless a single section references more than 65536 vertices
+inline EIndexType getIndexType(const std::vector<uint32_t>& indices)
+{
+	for (uint32_t index : indices)
+	{
+		if (index > UINT16_MAX)
+		{
+			return EIndexType::Uint32;
+		}
+	}
+	return EIndexType::Uint16;
+}
+
+struct BoundingSphere
+{
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+};
+
+// centered on the bounding box, skinned meshes are bounded in their bind pose
+template<typename VertexType>
+BoundingSphere computeBoundingSphere(const std::vector<VertexType>& vertices)
+{
+	BoundingSphere bounds;
+	if (vertices.empty())
+	{
+		return bounds;
+	}
+
+	glm::vec3 boundsMin = vertices[0].position;
+	glm::vec3 boundsMax = vertices[0].position;
+	for (const VertexType& vertex : vertices)
+	{
+		boundsMin = glm::min(boundsMin, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+	}
+
+	bounds.center = (boundsMin + boundsMax) * 0.5f;
+	for (const VertexType& vertex : vertices)
+	{
+		bounds.radius = glm::max(bounds.radius, glm::length(vertex.position - bounds.center));
+	}
+	return bounds;
+}
+
+// a small cluster of a section's triangles, contiguous in the index buffer so it can be drawn on its own
+struct Meshlet
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	BoundingSphere bounds;
+
+	// every triangle faces away from cameras where dot(normalize(center - camera), coneAxis) >= coneCutoff + radius / distance
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
 struct StaticMesh
 {
 	std::vector<StaticVertex> vertices;
 	std::vector<uint32_t> indices;
+	EIndexType indexType = EIndexType::Uint32;
+
+	std::vector<PackedStaticVertex> packedVertices;
+	VertexQuantization quantization;
 };
 
 struct SkeletalMesh
 {
 	std::vector<SkeletalVertex> vertices;
 	std::vector<uint32_t> indices;
+	EIndexType indexType = EIndexType::Uint32;
+
+	std::vector<PackedSkeletalVertex> packedVertices;
+	VertexQuantization quantization;
 };
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "pose_cache.h"
+#include "config/config_manager.h"
+
+PoseCache& PoseCache::getInstance()
+{
+	static PoseCache cache;
+	return cache;
+}
+
+void PoseCache::init()
+{
+	m_shareRate = ConfigManager::getInstance().getAnimationPoseShareRate();
+	m_phaseSnap = ConfigManager::getInstance().getAnimationPhaseSnap();
+}
+
+void PoseCache::destroy()
+{
+	// the pose blocks go back to the pool
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_poses.clear();
+}
+
+void PoseCache::setShareRate(float shareRate)
+{
+	// the quantized times of the cached poses are stale with another rate
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_shareRate = std::max(shareRate, 0.0f);
+	m_poses.clear();
+}
+
+float PoseCache::snap(float time) const
+{
+	return m_phaseSnap > 0.0f ? std::round(time / m_phaseSnap) * m_phaseSnap : time;
+}
+
+void PoseCache::beginTick()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_tick++;
+	for (auto iter = m_poses.begin(); iter != m_poses.end();)
+	{
+		iter = iter->second->lastTick + 1 < m_tick ? m_poses.erase(iter) : std::next(iter);
+	}
+
+	m_hits = 0;
+	m_misses = 0;
+}
+
+std::shared_ptr<const SharedPose> PoseCache::acquire(std::shared_ptr<const Skeleton> skeleton, std::shared_ptr<const Animation> animation,
+	const std::vector<int>& boneIndices, float clipTime)
+{
+	uint32_t frame = static_cast<uint32_t>(std::max(clipTime, 0.0f) * m_shareRate + 0.5f);
+	EPaletteFormat paletteFormat = AnimationKernels::getInstance().getPaletteFormat();
+
+	std::shared_ptr<SharedPose> sharedPose;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::shared_ptr<SharedPose>& entry = m_poses[std::make_tuple(skeleton.get(), animation.get(), frame, paletteFormat)];
+		if (!entry)
+		{
+			entry = std::make_shared<SharedPose>();
+			entry->skeleton = skeleton;
+			entry->animation = animation;
+		}
+		entry->lastTick = m_tick;
+		sharedPose = entry;
+	}
+
+	// the first animator at this time evaluates the pose, the others wait for it
+	std::lock_guard<std::mutex> lock(sharedPose->mutex);
+	if (sharedPose->evaluated)
+	{
+		m_hits++;
+		return sharedPose;
+	}
+	m_misses++;
+
+	// the quantized time of the last frame may lie past the end of the clip
+	float animTime = std::min(static_cast<float>(frame) / m_shareRate * animation->frameRate, animation->duration);
+	PoseBuffer& pose = sharedPose->pose;
+	pose.reset(*skeleton);
+	animation->sample(animTime, boneIndices, pose.getLocalPoses());
+	skeleton->evaluate(pose.getLocalPoses(), pose.getPalette());
+	AnimationKernels::getInstance().encodePalette(pose.getPalette(), reinterpret_cast<glm::vec4*>(pose.getPalette()), pose.getBoneNum());
+	sharedPose->evaluated = true;
+	return sharedPose;
+}
+
+PoseCacheStats PoseCache::getStats()
+{
+	PoseCacheStats stats;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	stats.poses = static_cast<uint32_t>(m_poses.size());
+	return stats;
+}
+
+BoneBindingCache& BoneBindingCache::getInstance()
+{
+	static BoneBindingCache cache;
+	return cache;
+}
+
+void BoneBindingCache::destroy()
+{
+	std::unique_lock<std::shared_mutex> lock(m_mutex);
+	m_bindings.clear();
+}
+
+std::shared_ptr<const std::vector<int>> BoneBindingCache::get(const std::shared_ptr<const Skeleton>& skeleton, const std::shared_ptr<const Animation>& animation,
+	uint32_t maxBoneDepth)
+{
+	auto key = std::make_tuple(skeleton.get(), animation.get(), maxBoneDepth);
+	auto isBound = [&skeleton, &animation](const Binding& binding)
+	{
+		return binding.skeleton.lock() == skeleton && binding.animation.lock() == animation;
+	};
+
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+		auto iter = m_bindings.find(key);
+		if (iter != m_bindings.end() && isBound(iter->second))
+		{
+			return iter->second.boneIndices;
+		}
+	}
+
+	// deeper bones are left unbound and keep their last pose
+	std::shared_ptr<std::vector<int>> boneIndices = std::make_shared<std::vector<int>>(animation->bind(*skeleton));
+	for (int& boneIndex : *boneIndices)
+	{
+		boneIndex = boneIndex != INVALID_BONE && skeleton->getBoneDepth(static_cast<uint32_t>(boneIndex)) > maxBoneDepth ? INVALID_BONE : boneIndex;
+	}
+
+	// another animator may have bound the same table meanwhile, the first one is kept
+	std::unique_lock<std::shared_mutex> lock(m_mutex);
+	Binding& binding = m_bindings[key];
+	if (!isBound(binding))
+	{
+		binding.skeleton = skeleton;
+		binding.animation = animation;
+		binding.boneIndices = boneIndices;
+	}
+	return binding.boneIndices;
+}
+
+void BoneBindingCache::invalidate(const Animation* animation)
+{
+	std::unique_lock<std::shared_mutex> lock(m_mutex);
+	for (auto iter = m_bindings.begin(); iter != m_bindings.end();)
+	{
+		bool stale = std::get<1>(iter->first) == animation || iter->second.skeleton.expired() || iter->second.animation.expired();
+		iter = stale ? m_bindings.erase(iter) : std::next(iter);
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "component/pose_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <shared_mutex>
+#include <tuple>
+
+// the pose of one clip at one quantized time, evaluated by the first animator asking for it and read only after that,
+// it keeps its skeleton and clip alive so their addresses can't be reused by another key
+struct SharedPose
+{
+	std::shared_ptr<const Skeleton> skeleton;
+	std::shared_ptr<const Animation> animation;
+	PoseBuffer pose;
+
+	std::mutex mutex;
+	bool evaluated = false;
+	uint32_t lastTick = 0;
+};
+
+struct PoseCacheStats
+{
+	uint32_t hits = 0;
+	uint32_t misses = 0;
+	uint32_t poses = 0;
+};
+
+/*
+ * Skinning palettes shared by the animators playing the same clip at the same time
+ * Poses are keyed by skeleton, clip, clip time quantized to the share rate and palette format, each is sampled and evaluated once
+ * and stays cached while an animator used it in the last tick. Animators a fraction of a quantization step apart still split over two poses,
+ * with phase snapping an animator starting a clip rounds its clock to the snap interval, so animators started within half an interval
+ * of each other advance in lockstep and share every pose from then on.
+ * Animators sampling a reduced bone set for their level of detail evaluate their own pose and don't use the cache.
+ */
+class PoseCache
+{
+public:
+	static PoseCache& getInstance();
+	void init();
+	void destroy();
+
+	// quantized poses per second of clip time, 0 disables sharing
+	float getShareRate() { return m_shareRate; }
+	void setShareRate(float shareRate);
+
+	// interval in seconds the clocks of starting animators are rounded to, 0 disables snapping
+	float getPhaseSnap() { return m_phaseSnap; }
+	void setPhaseSnap(float phaseSnap) { m_phaseSnap = std::max(phaseSnap, 0.0f); }
+
+	// a clock in seconds rounded to the snap interval
+	float snap(float time) const;
+
+	// evicts the poses no animator used in the last tick and resets the counters, called before the animators tick
+	void beginTick();
+
+	// the pose of the clip at the quantized clipTime, in seconds, thread safe, all bones are sampled
+	std::shared_ptr<const SharedPose> acquire(std::shared_ptr<const Skeleton> skeleton, std::shared_ptr<const Animation> animation,
+		const std::vector<int>& boneIndices, float clipTime);
+
+	// hits and misses since the last beginTick
+	PoseCacheStats getStats();
+
+private:
+	float m_shareRate = 0.0f;
+	float m_phaseSnap = 0.0f;
+
+	std::mutex m_mutex;
+	uint32_t m_tick = 0;
+	std::map<std::tuple<const Skeleton*, const Animation*, uint32_t, EPaletteFormat>, std::shared_ptr<SharedPose>> m_poses;
+
+	std::atomic<uint32_t> m_hits = { 0 };
+	std::atomic<uint32_t> m_misses = { 0 };
+};
+
+/*
+ * Channel to bone index tables shared by the animators of a rig
+ * A table is bound on first use per skeleton, clip and bone depth, clones of a rig playing the same clip all read the same one.
+ * Entries only hold weak references, a table whose skeleton or clip was destroyed is bound again, so a reused address never hits a stale table.
+ */
+class BoneBindingCache
+{
+public:
+	static BoneBindingCache& getInstance();
+	void destroy();
+
+	// the skeleton bone index of each channel, INVALID_BONE for bones missing from the skeleton or deeper than maxBoneDepth, thread safe
+	std::shared_ptr<const std::vector<int>> get(const std::shared_ptr<const Skeleton>& skeleton, const std::shared_ptr<const Animation>& animation, uint32_t maxBoneDepth);
+
+	// drops the tables of the clip and the ones whose skeleton or clip is gone, called when clips are merged into an animator
+	void invalidate(const Animation* animation);
+
+private:
+	struct Binding
+	{
+		std::weak_ptr<const Skeleton> skeleton;
+		std::weak_ptr<const Animation> animation;
+		std::shared_ptr<const std::vector<int>> boneIndices;
+	};
+
+	std::shared_mutex m_mutex;
+	std::map<std::tuple<const Skeleton*, const Animation*, uint32_t>, Binding> m_bindings;
+};
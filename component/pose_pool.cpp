@@ -0,0 +1,122 @@
+#include "pose_pool.h"
+
+#include <algorithm>
+
+#define POSE_BLOCKS_PER_SLAB 16
+
+PoseBuffer::PoseBuffer(const PoseBuffer&)
+{
+
+}
+
+PoseBuffer::PoseBuffer(PoseBuffer&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+PoseBuffer& PoseBuffer::operator=(const PoseBuffer& other)
+{
+	if (this != &other)
+	{
+		release();
+	}
+	return *this;
+}
+
+PoseBuffer& PoseBuffer::operator=(PoseBuffer&& other) noexcept
+{
+	if (this != &other)
+	{
+		release();
+		std::swap(m_block, other.m_block);
+		std::swap(m_boneNum, other.m_boneNum);
+		std::swap(m_localPoses, other.m_localPoses);
+		std::swap(m_palette, other.m_palette);
+	}
+	return *this;
+}
+
+PoseBuffer::~PoseBuffer()
+{
+	release();
+}
+
+void PoseBuffer::reset(const Skeleton& skeleton)
+{
+	uint32_t boneNum = skeleton.getBoneNum();
+	if (!m_block || m_boneNum != boneNum)
+	{
+		release();
+		m_block = PosePool::getInstance().allocate(boneNum);
+		m_boneNum = boneNum;
+
+		// matrices first, they have the strictest alignment
+		m_palette = reinterpret_cast<glm::mat4*>(m_block);
+		float* streams = reinterpret_cast<float*>(m_palette + boneNum);
+		m_localPoses.position = VectorStream{ streams, streams + boneNum, streams + 2 * boneNum };
+		m_localPoses.rotation = QuatStream{ streams + 3 * boneNum, streams + 4 * boneNum, streams + 5 * boneNum, streams + 6 * boneNum };
+		m_localPoses.scale = VectorStream{ streams + 7 * boneNum, streams + 8 * boneNum, streams + 9 * boneNum };
+	}
+
+	for (uint32_t i = 0; i < boneNum; ++i)
+	{
+		m_localPoses.set(i, skeleton.bindPoses[i]);
+	}
+}
+
+void PoseBuffer::release()
+{
+	if (m_block)
+	{
+		PosePool::getInstance().free(m_block, m_boneNum);
+	}
+
+	m_block = nullptr;
+	m_boneNum = 0;
+	m_localPoses = {};
+	m_palette = nullptr;
+}
+
+PosePool& PosePool::getInstance()
+{
+	static PosePool pool;
+	return pool;
+}
+
+void PosePool::destroy()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_freeBlocks.clear();
+	m_slabs.clear();
+}
+
+size_t PosePool::getBlockSize(uint32_t boneNum)
+{
+	// the palette and 10 float streams of translation, rotation and scale
+	return boneNum * (sizeof(glm::mat4) + 10 * sizeof(float));
+}
+
+uint8_t* PosePool::allocate(uint32_t boneNum)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::vector<uint8_t*>& freeBlocks = m_freeBlocks[boneNum];
+	if (freeBlocks.empty())
+	{
+		size_t blockSize = std::max(getBlockSize(boneNum), sizeof(glm::mat4));
+		m_slabs.push_back(std::make_unique<uint8_t[]>(blockSize * POSE_BLOCKS_PER_SLAB));
+		for (uint32_t i = 0; i < POSE_BLOCKS_PER_SLAB; ++i)
+		{
+			freeBlocks.push_back(m_slabs.back().get() + blockSize * (POSE_BLOCKS_PER_SLAB - 1 - i));
+		}
+	}
+
+	uint8_t* block = freeBlocks.back();
+	freeBlocks.pop_back();
+	return block;
+}
+
+void PosePool::free(uint8_t* block, uint32_t boneNum)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_freeBlocks[boneNum].push_back(block);
+}
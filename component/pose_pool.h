@@ -0,0 +1,56 @@
+#pragma once
+
+#include "component/animation.h"
+#include "component/animation_kernels.h"
+
+#include <mutex>
+
+/*
+ * Per instance pose of a shared skeleton: the animated local transforms and the skinning palette
+ * The arrays live in one block from the PosePool, local transforms are stored as SoA streams for the animation kernels. A copy starts without a block, so copied components never share a pose.
+ */
+class PoseBuffer
+{
+public:
+	PoseBuffer() = default;
+	PoseBuffer(const PoseBuffer& other);
+	PoseBuffer(PoseBuffer&& other) noexcept;
+	PoseBuffer& operator=(const PoseBuffer& other);
+	PoseBuffer& operator=(PoseBuffer&& other) noexcept;
+	~PoseBuffer();
+
+	// takes a block sized for the skeleton and sets its bind pose
+	void reset(const Skeleton& skeleton);
+	void release();
+
+	bool isValid() const { return m_block != nullptr; }
+	uint32_t getBoneNum() const { return m_boneNum; }
+
+	const TransformStreams& getLocalPoses() const { return m_localPoses; }
+	glm::mat4* getPalette() const { return m_palette; }
+
+private:
+	uint8_t* m_block = nullptr;
+	uint32_t m_boneNum = 0;
+
+	TransformStreams m_localPoses = {};
+	glm::mat4* m_palette = nullptr;
+};
+
+// blocks of one size are carved from shared slabs and recycled, so instances of the same rig reuse each other's memory
+class PosePool
+{
+public:
+	static PosePool& getInstance();
+	void destroy();
+
+	static size_t getBlockSize(uint32_t boneNum);
+
+	uint8_t* allocate(uint32_t boneNum);
+	void free(uint8_t* block, uint32_t boneNum);
+
+private:
+	std::mutex m_mutex;
+	std::vector<std::unique_ptr<uint8_t[]>> m_slabs;
+	std::map<uint32_t, std::vector<uint8_t*>> m_freeBlocks;
+};
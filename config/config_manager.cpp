@@ -33,3 +33,98 @@ void ConfigManager::getResolution(uint32_t& width, uint32_t& height)
 	width = engineConfigNode["res_x"].as<uint32_t>();
 	height = engineConfigNode["res_y"].as<uint32_t>();
 }
+
+std::string ConfigManager::getTextureCompression()
+{
+	return engineConfigNode["texture_compression"].as<std::string>("none");
+}
+
+std::string ConfigManager::getMipmapFilter()
+{
+	return engineConfigNode["mipmap_filter"].as<std::string>("kaiser");
+}
+
+std::string ConfigManager::getVertexPositionFormat()
+{
+	return engineConfigNode["vertex_position_format"].as<std::string>("unorm16");
+}
+
+float ConfigManager::getLodErrorPixels()
+{
+	return engineConfigNode["lod_error_pixels"].as<float>(1.0f);
+}
+
+float ConfigManager::getLodHysteresis()
+{
+	return engineConfigNode["lod_hysteresis"].as<float>(0.25f);
+}
+
+float ConfigManager::getAnimationError()
+{
+	return engineConfigNode["animation_error"].as<float>(0.0001f);
+}
+
+float ConfigManager::getAnimationSampleRate()
+{
+	return engineConfigNode["animation_sample_rate"].as<float>(0.0f);
+}
+
+bool ConfigManager::getAnimationParallel()
+{
+	return engineConfigNode["animation_parallel"].as<bool>(true);
+}
+
+std::string ConfigManager::getAnimationSimd()
+{
+	return engineConfigNode["animation_simd"].as<std::string>("avx2");
+}
+
+bool ConfigManager::getAnimationSlerp()
+{
+	return engineConfigNode["animation_slerp"].as<bool>(false);
+}
+
+std::string ConfigManager::getAnimationPaletteFormat()
+{
+	return engineConfigNode["animation_palette_format"].as<std::string>("affine");
+}
+
+float ConfigManager::getAnimationLodHalfPixels()
+{
+	return engineConfigNode["animation_lod_half_pixels"].as<float>(100.0f);
+}
+
+float ConfigManager::getAnimationLodQuarterPixels()
+{
+	return engineConfigNode["animation_lod_quarter_pixels"].as<float>(40.0f);
+}
+
+uint32_t ConfigManager::getAnimationLodBoneDepth()
+{
+	return engineConfigNode["animation_lod_bone_depth"].as<uint32_t>(8);
+}
+
+float ConfigManager::getAnimationBakeRate()
+{
+	return engineConfigNode["animation_bake_rate"].as<float>(15.0f);
+}
+
+float ConfigManager::getAnimationBakeDistance()
+{
+	return engineConfigNode["animation_bake_distance"].as<float>(20.0f);
+}
+
+float ConfigManager::getAnimationPoseShareRate()
+{
+	return engineConfigNode["animation_pose_share_rate"].as<float>(60.0f);
+}
+
+float ConfigManager::getAnimationPhaseSnap()
+{
+	return engineConfigNode["animation_phase_snap"].as<float>(0.0f);
+}
+
+std::vector<std::string> ConfigManager::getStreamedModels()
+{
+	return engineConfigNode["streamed_models"].as<std::vector<std::string>>(std::vector<std::string>());
+}
@@ -11,6 +11,25 @@ public:
 
 	std::string getShaderCompilerPath();
 	void getResolution(uint32_t& width, uint32_t& height);
+	std::string getTextureCompression();
+	std::string getMipmapFilter();
+	std::string getVertexPositionFormat();
+	float getLodErrorPixels();
+	float getLodHysteresis();
+	float getAnimationError();
+	float getAnimationSampleRate();
+	bool getAnimationParallel();
+	std::string getAnimationSimd();
+	bool getAnimationSlerp();
+	std::string getAnimationPaletteFormat();
+	float getAnimationLodHalfPixels();
+	float getAnimationLodQuarterPixels();
+	uint32_t getAnimationLodBoneDepth();
+	float getAnimationBakeRate();
+	float getAnimationBakeDistance();
+	float getAnimationPoseShareRate();
+	float getAnimationPhaseSnap();
+	std::vector<std::string> getStreamedModels();
 
 private:
 	YAML::Node engineConfigNode;
@@ -0,0 +1,953 @@
+#include "benchmark.h"
+#include "component/component.h"
+#include "component/animation_kernels.h"
+#include "component/pose_cache.h"
+#include "config/config_manager.h"
+#include "core/transform_hierarchy.h"
+#include "io/animation_compressor.h"
+#include "io/model_cooker.h"
+#include "io/mesh_optimizer.h"
+#include "io/vertex_animation_baker.h"
+#include "utility/thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <set>
+#include <fstream>
+#include <glm/gtc/packing.hpp>
+#include <boost/filesystem.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+namespace
+{
+	// local transforms up to a small rotation, offset and scale away from identity
+	QuatTransform randomTransform(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+		QuatTransform transform;
+		transform.position = glm::vec3(distribution(random), distribution(random), distribution(random));
+		transform.rotation = glm::normalize(glm::quat(1.0f, distribution(random) * 0.2f, distribution(random) * 0.2f, distribution(random) * 0.2f));
+		transform.scale = glm::vec3(1.0f + distribution(random) * 0.01f);
+		return transform;
+	}
+
+	// a rig of boneNum bones, each bone hangs below a random earlier one so chains and fan outs both appear
+	Skeleton buildRig(uint32_t boneNum, std::mt19937& random)
+	{
+		Skeleton skeleton;
+		for (uint32_t i = 0; i < boneNum; ++i)
+		{
+			int parent = i == 0 ? INVALID_BONE : static_cast<int>(std::uniform_int_distribution<uint32_t>(i > 8 ? i - 8 : 0, i - 1)(random));
+			skeleton.addBone("bone_" + std::to_string(i), parent, randomTransform(random).matrix(), glm::inverse(randomTransform(random).matrix()));
+		}
+		return skeleton;
+	}
+
+	// a one second clip swinging every bone of the skeleton, through the import compression
+	std::shared_ptr<Animation> buildSwingClip(const Skeleton& skeleton)
+	{
+		std::map<std::string, RawAnimationChannel> rawChannels;
+		for (uint32_t i = 0; i < skeleton.getBoneNum(); ++i)
+		{
+			RawAnimationChannel& rawChannel = rawChannels[skeleton.names[i]];
+			rawChannel.chainLength = 1.0f;
+			for (uint32_t j = 0; j <= 30; ++j)
+			{
+				float time = static_cast<float>(j);
+				float angle = std::sin(time * 0.2f + static_cast<float>(i)) * 0.5f;
+				rawChannel.positionKeys.push_back({ time, skeleton.bindPoses[i].position });
+				rawChannel.rotationKeys.push_back({ time, skeleton.bindPoses[i].rotation * glm::angleAxis(angle, glm::vec3(1.0f, 0.0f, 0.0f)) });
+				rawChannel.scaleKeys.push_back({ time, glm::vec3(1.0f) });
+			}
+		}
+		return AnimationCompressor::getInstance().compress("swing", 30.0f, 30.0f, rawChannels, 1.0f);
+	}
+
+	// the previous pointer based evaluation, a recursion over child lists with generic matrix products
+	struct ReferenceBone
+	{
+		glm::mat4 globalPose;
+		std::vector<ReferenceBone*> children;
+	};
+
+	void updateReference(ReferenceBone& bone, const glm::mat4& parentPose, const TransformStreams& localPoses, std::vector<ReferenceBone>& bones)
+	{
+		uint32_t index = static_cast<uint32_t>(&bone - bones.data());
+		bone.globalPose = parentPose * localPoses.get(index).matrix();
+		for (ReferenceBone* child : bone.children)
+		{
+			updateReference(*child, bone.globalPose, localPoses, bones);
+		}
+	}
+
+	// the previous entity tree, a recursion over child sets with a registry lookup and three rotations per node
+	struct ReferenceNode
+	{
+		entt::entity handle;
+		std::set<ReferenceNode*> children;
+	};
+
+	void updateReference(ReferenceNode& node, const glm::mat4& parentMatrix, entt::registry& registry)
+	{
+		TransformComponent& transformComp = registry.get<TransformComponent>(node.handle);
+		glm::mat4 localMatrix = glm::translate(glm::mat4(1.0f), transformComp.position);
+		localMatrix = glm::rotate(localMatrix, glm::radians(transformComp.rotation.x), ForwardVector);
+		localMatrix = glm::rotate(localMatrix, glm::radians(transformComp.rotation.y), RightVector);
+		localMatrix = glm::rotate(localMatrix, glm::radians(transformComp.rotation.z), UpVector);
+		transformComp.localMatrix = glm::scale(localMatrix, transformComp.scale);
+		transformComp.worldMatrix = parentMatrix * transformComp.localMatrix;
+
+		for (ReferenceNode* child : node.children)
+		{
+			updateReference(*child, transformComp.worldMatrix, registry);
+		}
+	}
+
+	// the vertex shader blend of one palette format, bones and weights of a vertex as in PackedSkeletalVertex
+	glm::vec3 skinPosition(EPaletteFormat paletteFormat, const glm::vec4* palette, const uint32_t* bones, const float* weights, const glm::vec3& position)
+	{
+		if (paletteFormat == EPaletteFormat::DualQuat)
+		{
+			glm::vec4 real(0.0f), dual(0.0f);
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				float weight = glm::dot(palette[bones[0] * 2], palette[bones[i] * 2]) < 0.0f ? -weights[i] : weights[i];
+				real += palette[bones[i] * 2] * weight;
+				dual += palette[bones[i] * 2 + 1] * weight;
+			}
+			float inverseLength = 1.0f / glm::length(real);
+			real *= inverseLength;
+			dual *= inverseLength;
+
+			glm::vec3 axis(real);
+			glm::vec3 rotated = position + 2.0f * glm::cross(axis, glm::cross(axis, position) + real.w * position);
+			return rotated + 2.0f * (real.w * glm::vec3(dual) - dual.w * axis + glm::cross(axis, glm::vec3(dual)));
+		}
+
+		if (paletteFormat == EPaletteFormat::Affine)
+		{
+			glm::vec4 rows[3] = { glm::vec4(0.0f), glm::vec4(0.0f), glm::vec4(0.0f) };
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				for (uint32_t j = 0; j < 3; ++j)
+				{
+					rows[j] += palette[bones[i] * 3 + j] * weights[i];
+				}
+			}
+			glm::vec4 homogeneous(position, 1.0f);
+			return glm::vec3(glm::dot(rows[0], homogeneous), glm::dot(rows[1], homogeneous), glm::dot(rows[2], homogeneous));
+		}
+
+		glm::mat4 boneTransform(0.0f);
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			boneTransform += glm::mat4(palette[bones[i] * 4], palette[bones[i] * 4 + 1], palette[bones[i] * 4 + 2], palette[bones[i] * 4 + 3]) * weights[i];
+		}
+		return glm::vec3(boneTransform * glm::vec4(position, 1.0f));
+	}
+
+	// cooked clips are copies of the imported keys, compared byte by byte
+	template<typename T>
+	bool isSameArray(const std::vector<T>& a, const std::vector<T>& b)
+	{
+		return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), sizeof(T) * a.size()) == 0);
+	}
+
+	bool isSameClip(const Animation& a, const Animation& b)
+	{
+		return a.name == b.name && a.duration == b.duration && a.frameRate == b.frameRate && a.frameCount == b.frameCount &&
+			a.channelNames == b.channelNames && isSameArray(a.channels, b.channels) &&
+			isSameArray(a.positionTimes, b.positionTimes) && isSameArray(a.positions, b.positions) &&
+			isSameArray(a.rotationTimes, b.rotationTimes) && isSameArray(a.rotations, b.rotations) &&
+			isSameArray(a.scaleTimes, b.scaleTimes) && isSameArray(a.scales, b.scales);
+	}
+
+	// a failed check is printed on its own line, the benchmark goes on so all of its timings are still printed
+	bool expect(bool condition, const char* benchmark, const char* message)
+	{
+		if (!condition)
+		{
+			printf("%s benchmark: FAILED, %s\n", benchmark, message);
+		}
+		return condition;
+	}
+
+	template<typename Function>
+	double measureMicroseconds(uint32_t iterations, Function function)
+	{
+		auto begin = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < iterations; ++i)
+		{
+			function();
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::micro>(end - begin).count() / iterations;
+	}
+}
+
+EBenchmarkResult Benchmark::run(const std::string& name, uint32_t count)
+{
+	if (name == "skeleton")
+	{
+		return runSkeleton() ? EBenchmarkResult::Passed : EBenchmarkResult::Failed;
+	}
+	if (name == "animation")
+	{
+		return runAnimation(count > 0 ? count : 1000) ? EBenchmarkResult::Passed : EBenchmarkResult::Failed;
+	}
+	if (name == "kernels")
+	{
+		return runKernels(count > 0 ? count : 4096) ? EBenchmarkResult::Passed : EBenchmarkResult::Failed;
+	}
+	if (name == "palette")
+	{
+		return runPalette(count > 0 ? count : 100) ? EBenchmarkResult::Passed : EBenchmarkResult::Failed;
+	}
+	if (name == "bake")
+	{
+		return runBake(count > 0 ? count : 10000) ? EBenchmarkResult::Passed : EBenchmarkResult::Failed;
+	}
+	if (name == "pose")
+	{
+		return runPoseShare(count > 0 ? count : 1000) ? EBenchmarkResult::Passed : EBenchmarkResult::Failed;
+	}
+	if (name == "hierarchy")
+	{
+		return runHierarchy(count > 0 ? count : 100000) ? EBenchmarkResult::Passed : EBenchmarkResult::Failed;
+	}
+	if (name == "cooker")
+	{
+		return runCooker(count > 0 ? count : 64) ? EBenchmarkResult::Passed : EBenchmarkResult::Failed;
+	}
+	if (name == "optimizer")
+	{
+		return runOptimizer() ? EBenchmarkResult::Passed : EBenchmarkResult::Failed;
+	}
+	return EBenchmarkResult::Unknown;
+}
+
+bool Benchmark::runSkeleton()
+{
+	AnimationKernels::getInstance().setSimdLevel(AnimationKernels::getSupportedSimdLevel());
+
+	bool passed = true;
+	std::mt19937 random(0);
+	for (uint32_t boneNum : { 100u, 1024u, 4096u })
+	{
+		Skeleton skeleton = buildRig(boneNum, random);
+		PoseBuffer pose;
+		pose.reset(skeleton);
+		const TransformStreams& localPoses = pose.getLocalPoses();
+		for (uint32_t i = 0; i < boneNum; ++i)
+		{
+			localPoses.set(i, randomTransform(random));
+		}
+
+		std::vector<ReferenceBone> referenceBones(boneNum);
+		for (uint32_t i = 1; i < boneNum; ++i)
+		{
+			referenceBones[skeleton.parents[i]].children.push_back(&referenceBones[i]);
+		}
+
+		uint32_t iterations = 1000000 / boneNum;
+		double flatTime = measureMicroseconds(iterations, [&]() { skeleton.evaluate(localPoses, pose.getPalette()); });
+		double referenceTime = measureMicroseconds(iterations, [&]() { updateReference(referenceBones[0], glm::mat4(1.0f), localPoses, referenceBones); });
+
+		// relative to the largest entry, rigs this deep reach large translations
+		float maxError = 0.0f;
+		for (uint32_t i = 0; i < boneNum; ++i)
+		{
+			glm::mat4 expected = referenceBones[i].globalPose * skeleton.inverseBindPoses[i];
+			for (uint32_t j = 0; j < 4; ++j)
+			{
+				glm::vec4 difference = glm::abs(pose.getPalette()[i][j] - expected[j]);
+				float magnitude = glm::max(glm::length(expected[3]), 1.0f);
+				maxError = glm::max(maxError, glm::max(glm::max(difference.x, difference.y), glm::max(difference.z, difference.w)) / magnitude);
+			}
+		}
+
+		printf("skeleton benchmark: %d bones, flat %.2f us (%.1f ns/bone), recursive %.2f us, max relative error %g\n",
+			boneNum, flatTime, flatTime * 1000.0 / boneNum, referenceTime, maxError);
+		passed = expect(maxError < 1e-4f, "skeleton", "flat evaluation differs from the recursive one") && passed;
+	}
+
+	// instances of one rig only add their pose blocks
+	const uint32_t instanceNum = 1000;
+	Skeleton skeleton = buildRig(100, random);
+	std::vector<PoseBuffer> poses(instanceNum);
+	for (PoseBuffer& pose : poses)
+	{
+		pose.reset(skeleton);
+	}
+
+	size_t skeletonSize = skeleton.getBoneNum() * (sizeof(int) + 2 * sizeof(glm::mat4) + sizeof(QuatTransform));
+	for (const std::string& name : skeleton.names)
+	{
+		skeletonSize += sizeof(std::string) + name.size();
+	}
+	printf("skeleton benchmark: %d instances of a %d bone rig, %.1f KB shared skeleton, %.1f KB pose per instance\n",
+		instanceNum, skeleton.getBoneNum(), skeletonSize / 1024.0f, PosePool::getBlockSize(skeleton.getBoneNum()) / 1024.0f);
+	return passed;
+}
+
+bool Benchmark::runAnimation(uint32_t animatorNum)
+{
+	// the clip goes through the import compression, so sampling runs on the configured track layout
+	ConfigManager::getInstance().init();
+	AnimationCompressor::getInstance().init();
+	AnimationKernels::getInstance().init();
+
+	// a mannequin sized rig with a one second clip swinging every bone
+	std::mt19937 random(0);
+	std::shared_ptr<const Skeleton> skeleton = std::make_shared<Skeleton>(buildRig(68, random));
+
+	AnimatorComponent prototype;
+	prototype.skeleton = skeleton;
+	prototype.animations["swing"] = buildSwingClip(*skeleton);
+	std::vector<AnimatorComponent> animatorComps(animatorNum, prototype);
+	std::vector<AnimatorComponent*> animators;
+	for (AnimatorComponent& animatorComp : animatorComps)
+	{
+		animators.push_back(&animatorComp);
+	}
+
+	uint32_t hardwareThreadNum = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<uint32_t> threadNums;
+	for (uint32_t threadNum = 1; threadNum < hardwareThreadNum; threadNum *= 2)
+	{
+		threadNums.push_back(threadNum);
+	}
+	threadNums.push_back(hardwareThreadNum);
+
+	const uint32_t frameNum = 60;
+	const float deltaTime = 1.0f / 60.0f;
+	uint32_t paletteVectorNum = AnimationKernels::getPaletteVectorNum(AnimationKernels::getInstance().getPaletteFormat());
+	std::vector<glm::vec4> referencePalettes;
+	double serialTime = 0.0;
+	bool passed = true;
+	for (uint32_t threadNum : threadNums)
+	{
+		// the calling thread takes part in parallelFor, so one thread means no workers
+		ThreadPool::getInstance().destroy();
+		if (threadNum > 1)
+		{
+			ThreadPool::getInstance().init(threadNum - 1);
+		}
+
+		// every run replays the same frames from the same desynchronized start
+		for (uint32_t i = 0; i < animatorNum; ++i)
+		{
+			animatorComps[i].play("swing");
+			animatorComps[i].tick(static_cast<float>(i) * 0.013f);
+		}
+		double frameTime = measureMicroseconds(frameNum, [&]() { AnimatorComponent::tickAll(animators, deltaTime, true); });
+
+		std::vector<glm::vec4> palettes;
+		for (const AnimatorComponent& animatorComp : animatorComps)
+		{
+			palettes.insert(palettes.end(), animatorComp.getPalette(), animatorComp.getPalette() + animatorComp.getPaletteSize() * paletteVectorNum);
+		}
+		if (threadNum == 1)
+		{
+			referencePalettes = palettes;
+			serialTime = frameTime;
+		}
+		bool identical = std::memcmp(palettes.data(), referencePalettes.data(), palettes.size() * sizeof(glm::vec4)) == 0;
+
+		printf("animation benchmark: %d animators, %d threads, %.3f ms per frame, speedup %.2f, %s\n", animatorNum, threadNum,
+			frameTime / 1000.0, serialTime / frameTime, identical ? "identical to serial" : "DIFFERS from serial");
+		passed = expect(identical, "animation", "parallel palettes differ from the serial ones") && passed;
+	}
+
+	// the pose blocks go back to the pool before it is destroyed
+	animators.clear();
+	animatorComps.clear();
+
+	ThreadPool::getInstance().destroy();
+	PosePool::getInstance().destroy();
+	ConfigManager::getInstance().destroy();
+	return passed;
+}
+
+bool Benchmark::runKernels(uint32_t boneNum)
+{
+	// boneNum key pairs, half of the rotation pairs lie in opposite hemispheres and need the shortest path correction
+	std::mt19937 random(0);
+	std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+	std::vector<QuatTransform> lowKeys(boneNum), highKeys(boneNum);
+	std::vector<float> times(boneNum);
+	for (uint32_t i = 0; i < boneNum; ++i)
+	{
+		lowKeys[i] = randomTransform(random);
+		highKeys[i] = randomTransform(random);
+		highKeys[i].rotation = i % 2 == 0 ? -highKeys[i].rotation : highKeys[i].rotation;
+		times[i] = distribution(random);
+	}
+
+	// the per bone glm path the kernels replace
+	std::vector<QuatTransform> glmPoses(boneNum);
+	std::vector<glm::mat4> glmMatrices(boneNum);
+	uint32_t iterations = std::max(10000000 / boneNum, 1u);
+	double glmTime = measureMicroseconds(iterations, [&]()
+	{
+		for (uint32_t i = 0; i < boneNum; ++i)
+		{
+			glmPoses[i].position = glm::mix(lowKeys[i].position, highKeys[i].position, times[i]);
+			glmPoses[i].rotation = glm::slerp(lowKeys[i].rotation, highKeys[i].rotation, times[i]);
+			glmPoses[i].scale = glm::mix(lowKeys[i].scale, highKeys[i].scale, times[i]);
+			glmMatrices[i] = glmPoses[i].matrix();
+		}
+	});
+	printf("kernels benchmark: %d bones, glm %.2f us (%.2f ns/bone)\n", boneNum, glmTime, glmTime * 1000.0 / boneNum);
+
+	// the key streams are refilled before every run, the kernels blend in place like Animation::sample does
+	std::vector<float> data(boneNum * 20);
+	auto stream = [&](uint32_t index) { return data.data() + boneNum * index; };
+	TransformStreams lowStreams{ { stream(0), stream(1), stream(2) }, { stream(3), stream(4), stream(5), stream(6) }, { stream(7), stream(8), stream(9) } };
+	TransformStreams highStreams{ { stream(10), stream(11), stream(12) }, { stream(13), stream(14), stream(15), stream(16) }, { stream(17), stream(18), stream(19) } };
+	for (uint32_t i = 0; i < boneNum; ++i)
+	{
+		lowStreams.set(i, lowKeys[i]);
+		highStreams.set(i, highKeys[i]);
+	}
+	std::vector<float> keyData = data;
+
+	AnimationKernels& kernels = AnimationKernels::getInstance();
+	std::vector<glm::mat4> matrices(boneNum);
+	bool passed = true;
+	for (ESimdLevel simdLevel : { ESimdLevel::Scalar, ESimdLevel::SSE, ESimdLevel::AVX2 })
+	{
+		if (simdLevel > AnimationKernels::getSupportedSimdLevel())
+		{
+			continue;
+		}
+
+		for (bool slerp : { false, true })
+		{
+			kernels.setSimdLevel(simdLevel);
+			kernels.setSlerpEnabled(slerp);
+			double kernelTime = measureMicroseconds(iterations, [&]()
+			{
+				kernels.lerp(lowStreams.position, highStreams.position, times.data(), lowStreams.position, boneNum);
+				kernels.blend(lowStreams.rotation, highStreams.rotation, times.data(), lowStreams.rotation, boneNum);
+				kernels.lerp(lowStreams.scale, highStreams.scale, times.data(), lowStreams.scale, boneNum);
+				kernels.compose(lowStreams, matrices.data(), boneNum);
+			});
+
+			// the timed runs blended the keys repeatedly, the error is taken from one run on fresh keys
+			data = keyData;
+			kernels.lerp(lowStreams.position, highStreams.position, times.data(), lowStreams.position, boneNum);
+			kernels.blend(lowStreams.rotation, highStreams.rotation, times.data(), lowStreams.rotation, boneNum);
+			kernels.lerp(lowStreams.scale, highStreams.scale, times.data(), lowStreams.scale, boneNum);
+			kernels.compose(lowStreams, matrices.data(), boneNum);
+
+			float maxAngle = 0.0f;
+			float maxMatrixError = 0.0f;
+			for (uint32_t i = 0; i < boneNum; ++i)
+			{
+				float dot = std::min(std::abs(glm::dot(lowStreams.get(i).rotation, glmPoses[i].rotation)), 1.0f);
+				maxAngle = std::max(maxAngle, glm::degrees(2.0f * std::acos(dot)));
+				for (uint32_t j = 0; j < 4; ++j)
+				{
+					glm::vec4 difference = glm::abs(matrices[i][j] - glmMatrices[i][j]);
+					maxMatrixError = std::max(maxMatrixError, std::max(std::max(difference.x, difference.y), std::max(difference.z, difference.w)));
+				}
+			}
+			data = keyData;
+
+			const char* simdNames[] = { "scalar", "sse", "avx2" };
+			printf("kernels benchmark: %d bones, %s %s %.2f us (%.2f ns/bone), speedup %.2f, max rotation error %.4f deg, max matrix error %g\n",
+				boneNum, simdNames[static_cast<uint32_t>(simdLevel)], slerp ? "slerp" : "nlerp", kernelTime, kernelTime * 1000.0 / boneNum,
+				glmTime / kernelTime, maxAngle, maxMatrixError);
+
+			// nlerp drifts from slerp by design, the corrected t brings it back within a tenth of a degree
+			passed = expect(maxAngle < (slerp ? 0.1f : 1.0f) && maxMatrixError < 1e-2f, "kernels", "blended poses are too far from glm") && passed;
+		}
+	}
+	return passed;
+}
+
+bool Benchmark::runPalette(uint32_t boneNum)
+{
+	// one evaluated pose of a rig with slight bone scales, which the dual quaternion format drops
+	std::mt19937 random(0);
+	Skeleton skeleton = buildRig(boneNum, random);
+	PoseBuffer pose;
+	pose.reset(skeleton);
+	for (uint32_t i = 0; i < boneNum; ++i)
+	{
+		pose.getLocalPoses().set(i, randomTransform(random));
+	}
+	skeleton.evaluate(pose.getLocalPoses(), pose.getPalette());
+	std::vector<glm::mat4> matrices(pose.getPalette(), pose.getPalette() + boneNum);
+
+	// rigidly bound vertices, so the error is the one of the encoding, linear and dual quaternion blends of different bones differ by design
+	const uint32_t vertexNum = 10000;
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::uniform_int_distribution<uint32_t> boneDistribution(0, boneNum - 1);
+	std::vector<glm::vec3> positions(vertexNum);
+	std::vector<uint32_t> bones(vertexNum * 4);
+	std::vector<float> weights(vertexNum * 4);
+	for (uint32_t i = 0; i < vertexNum; ++i)
+	{
+		positions[i] = glm::vec3(distribution(random), distribution(random), distribution(random));
+		for (uint32_t j = 0; j < 4; ++j)
+		{
+			bones[i * 4 + j] = boneDistribution(random);
+			weights[i * 4 + j] = j == 0 ? 1.0f : 0.0f;
+		}
+	}
+
+	AnimationKernels& kernels = AnimationKernels::getInstance();
+	std::vector<glm::vec4> palette(boneNum * 4);
+	std::vector<glm::vec3> references(vertexNum);
+	size_t matrixSize = boneNum * sizeof(glm::mat4);
+	bool passed = true;
+	for (EPaletteFormat paletteFormat : { EPaletteFormat::Matrix, EPaletteFormat::Affine, EPaletteFormat::DualQuat })
+	{
+		kernels.setPaletteFormat(paletteFormat);
+		double encodeTime = measureMicroseconds(10000, [&]() { kernels.encodePalette(matrices.data(), palette.data(), boneNum); });
+
+		// the same blend as the vertex shader, relative to the matrix palette
+		float maxError = 0.0f;
+		for (uint32_t i = 0; i < vertexNum; ++i)
+		{
+			glm::vec3 position = skinPosition(paletteFormat, palette.data(), &bones[i * 4], &weights[i * 4], positions[i]);
+			if (paletteFormat == EPaletteFormat::Matrix)
+			{
+				references[i] = position;
+			}
+			maxError = std::max(maxError, glm::length(position - references[i]) / std::max(glm::length(references[i]), 1.0f));
+		}
+
+		const char* formatNames[] = { "matrix", "affine", "dual_quat" };
+		size_t uploadSize = boneNum * AnimationKernels::getPaletteVectorNum(paletteFormat) * sizeof(glm::vec4);
+		printf("palette benchmark: %d bones, %s %zu bytes per upload (%.0f%% of matrix), encode %.3f us, max relative skinning error %g\n",
+			boneNum, formatNames[static_cast<uint32_t>(paletteFormat)], uploadSize, uploadSize * 100.0 / matrixSize, encodeTime, maxError);
+
+		// the dual quaternion format loses the bone scales of about one percent
+		passed = expect(maxError < (paletteFormat == EPaletteFormat::DualQuat ? 0.05f : 1e-5f), "palette", "skinning differs from the matrix palette") && passed;
+	}
+	return passed;
+}
+
+bool Benchmark::runBake(uint32_t vertexNum)
+{
+	ConfigManager::getInstance().init();
+	AnimationCompressor::getInstance().init();
+	AnimationKernels::getInstance().init();
+	VertexAnimationBaker::getInstance().init();
+
+	// the rig and clip of the animation benchmark, skinning a cloud of vertices bound to 4 random bones each
+	std::mt19937 random(0);
+	std::shared_ptr<const Skeleton> skeleton = std::make_shared<Skeleton>(buildRig(68, random));
+	std::map<std::string, std::shared_ptr<Animation>> animations;
+	animations["swing"] = buildSwingClip(*skeleton);
+
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::uniform_int_distribution<int> boneDistribution(0, static_cast<int>(skeleton->getBoneNum()) - 1);
+	SkeletalMesh mesh;
+	mesh.vertices.resize(vertexNum);
+	for (SkeletalVertex& vertex : mesh.vertices)
+	{
+		vertex.position = glm::vec3(distribution(random), distribution(random), distribution(random));
+		vertex.normal = glm::normalize(glm::vec3(distribution(random), distribution(random), distribution(random)) + glm::vec3(0.0f, 0.0f, 2.0f));
+		glm::vec4 weights(distribution(random), distribution(random), distribution(random), distribution(random));
+		vertex.weights = glm::abs(weights) / (glm::abs(weights.x) + glm::abs(weights.y) + glm::abs(weights.z) + glm::abs(weights.w));
+		vertex.bones = glm::ivec4(boneDistribution(random), boneDistribution(random), boneDistribution(random), boneDistribution(random));
+	}
+
+	std::shared_ptr<VertexAnimation> vertexAnimation;
+	double bakeTime = measureMicroseconds(1, [&]() { vertexAnimation = VertexAnimationBaker::getInstance().bake(mesh, *skeleton, animations); });
+	if (!vertexAnimation)
+	{
+		printf("bake benchmark: nothing baked, animation_bake_rate is 0 or the frames don't fit in a texture\n");
+		ConfigManager::getInstance().destroy();
+		return true;
+	}
+
+	// baked playback against skinning the exact pose, on the baked frames and halfway between them,
+	// the swing clip doesn't loop seamlessly so the segment from the last frame back to the first is left out
+	const BakedClip& clip = vertexAnimation->clips.at("swing");
+	const uint64_t* texels = reinterpret_cast<const uint64_t*>(vertexAnimation->texture->levelData.data());
+	uint32_t frameSize = vertexAnimation->width * vertexAnimation->rowsPerFrame;
+	std::vector<int> boneIndices = animations["swing"]->bind(*skeleton);
+	PoseBuffer pose;
+	float maxErrors[2] = { 0.0f, 0.0f };
+	for (uint32_t i = 0; i < clip.frameCount; ++i)
+	{
+		for (uint32_t half = 0; half < (i + 1 < clip.frameCount ? 2u : 1u); ++half)
+		{
+			float blend = half * 0.5f;
+			pose.reset(*skeleton);
+			animations["swing"]->sample(clip.duration * (static_cast<float>(i) + blend) / static_cast<float>(clip.frameCount), boneIndices, pose.getLocalPoses());
+			skeleton->evaluate(pose.getLocalPoses(), pose.getPalette());
+
+			const uint64_t* positions0 = texels + static_cast<size_t>(clip.firstFrame + i) * frameSize * 2;
+			const uint64_t* positions1 = texels + static_cast<size_t>(clip.firstFrame + (i + 1) % clip.frameCount) * frameSize * 2;
+			for (uint32_t j = 0; j < vertexNum; ++j)
+			{
+				const SkeletalVertex& vertex = mesh.vertices[j];
+				uint32_t bones[4] = { static_cast<uint32_t>(vertex.bones.x), static_cast<uint32_t>(vertex.bones.y), static_cast<uint32_t>(vertex.bones.z), static_cast<uint32_t>(vertex.bones.w) };
+				glm::vec3 exact = skinPosition(EPaletteFormat::Matrix, reinterpret_cast<const glm::vec4*>(pose.getPalette()), bones, &vertex.weights.x, vertex.position);
+				glm::vec3 baked = glm::mix(glm::vec3(glm::unpackHalf4x16(positions0[j])), glm::vec3(glm::unpackHalf4x16(positions1[j])), blend);
+				maxErrors[half] = std::max(maxErrors[half], glm::length(baked - exact) / std::max(glm::length(exact), 1.0f));
+			}
+		}
+	}
+
+	// per instance CPU work of one frame: an animator evaluating its pose, against looking up the frames of a baked instance
+	AnimatorComponent animatorComp;
+	animatorComp.skeleton = skeleton;
+	animatorComp.animations = animations;
+	animatorComp.play("swing");
+	double skinnedTime = measureMicroseconds(1000, [&]() { animatorComp.tick(1.0f / 60.0f); });
+
+	SkeletalMeshComponent skeletalMeshComp;
+	skeletalMeshComp.vertexAnimation = vertexAnimation;
+	skeletalMeshComp.bakedBatchResource = std::make_shared<VertexAnimationBatchResource>();
+	float animTime = 0.0f;
+	double bakedTime = measureMicroseconds(1000, [&]() {
+		skeletalMeshComp.addBakedInstance(glm::mat4(1.0f), "swing", animTime, true);
+		animTime = fmod(animTime + 0.5f, clip.duration);
+	});
+
+	size_t paletteSize = skeleton->getBoneNum() * AnimationKernels::getPaletteVectorNum(AnimationKernels::getInstance().getPaletteFormat()) * sizeof(glm::vec4);
+	printf("bake benchmark: %u vertices, %u frames baked in %.1f ms, texture %.2f MB\n", vertexNum, clip.frameCount, bakeTime / 1000.0,
+		vertexAnimation->texture->levelData.size() / (1024.0f * 1024.0f));
+	printf("bake benchmark: max relative position error %g on frames, %g between frames\n", maxErrors[0], maxErrors[1]);
+	bool passed = expect(maxErrors[0] < 1e-2f, "bake", "baked frames differ from the skinned poses");
+	printf("bake benchmark: per instance %.3f us and %zu palette bytes skinned, %.3f us and %zu bytes baked\n", skinnedTime, paletteSize, bakedTime, sizeof(glm::vec4));
+
+	pose.release();
+	animatorComp = AnimatorComponent();
+	PosePool::getInstance().destroy();
+	ConfigManager::getInstance().destroy();
+	return passed;
+}
+
+bool Benchmark::runPoseShare(uint32_t animatorNum)
+{
+	ConfigManager::getInstance().init();
+	AnimationCompressor::getInstance().init();
+	AnimationKernels::getInstance().init();
+
+	// a crowd started in 8 waves a tenth of a second apart, the animators of a wave start up to 40 ms from each other
+	std::mt19937 random(0);
+	std::shared_ptr<const Skeleton> skeleton = std::make_shared<Skeleton>(buildRig(68, random));
+
+	AnimatorComponent prototype;
+	prototype.skeleton = skeleton;
+	prototype.animations["swing"] = buildSwingClip(*skeleton);
+	std::vector<AnimatorComponent> animatorComps(animatorNum, prototype);
+	std::vector<AnimatorComponent*> animators;
+	std::vector<float> startTimes;
+	std::uniform_real_distribution<float> jitter(0.0f, 0.04f);
+	for (uint32_t i = 0; i < animatorNum; ++i)
+	{
+		animators.push_back(&animatorComps[i]);
+		startTimes.push_back(static_cast<float>(i % 8) * 0.1f + jitter(random));
+	}
+
+	const uint32_t frameNum = 60;
+	const float deltaTime = 1.0f / 60.0f;
+	uint32_t paletteFloatNum = skeleton->getBoneNum() * AnimationKernels::getPaletteVectorNum(AnimationKernels::getInstance().getPaletteFormat()) * 4;
+	std::vector<float> referencePalettes;
+	double referenceTime = 0.0;
+	PoseCache& poseCache = PoseCache::getInstance();
+	auto getPalettes = [&]()
+	{
+		std::vector<float> palettes;
+		for (const AnimatorComponent& animatorComp : animatorComps)
+		{
+			const float* palette = reinterpret_cast<const float*>(animatorComp.getPalette());
+			palettes.insert(palettes.end(), palette, palette + paletteFloatNum);
+		}
+		return palettes;
+	};
+
+	bool passed = true;
+	for (const auto& setting : { std::make_pair(0.0f, 0.0f), std::make_pair(60.0f, 0.0f), std::make_pair(30.0f, 0.0f), std::make_pair(60.0f, 0.1f), std::make_pair(30.0f, 0.1f) })
+	{
+		// every run replays the same frames from the same start, the first run evaluates every animator and is the reference
+		poseCache.setShareRate(0.0f);
+		for (uint32_t i = 0; i < animatorNum; ++i)
+		{
+			animatorComps[i].play("swing");
+			animatorComps[i].tick(startTimes[i]);
+		}
+		poseCache.setShareRate(setting.first);
+		poseCache.setPhaseSnap(setting.second);
+
+		uint32_t hits = 0, misses = 0;
+		double frameTime = measureMicroseconds(frameNum, [&]() {
+			poseCache.beginTick();
+			AnimatorComponent::tickAll(animators, deltaTime, false);
+			PoseCacheStats stats = poseCache.getStats();
+			hits += stats.hits;
+			misses += stats.misses;
+		});
+
+		std::vector<float> palettes = getPalettes();
+		if (setting.first == 0.0f)
+		{
+			referencePalettes = palettes;
+			referenceTime = frameTime;
+		}
+		// against the exact pose of the unsnapped clock, relative to its magnitude since translations grow along long chains
+		float maxError = 0.0f;
+		for (size_t i = 0; i < palettes.size(); ++i)
+		{
+			maxError = std::max(maxError, std::abs(palettes[i] - referencePalettes[i]) / std::max(std::abs(referencePalettes[i]), 1.0f));
+		}
+
+		printf("pose benchmark: %u animators, share rate %.0f, phase snap %.2f s, %.3f ms per frame, speedup %.2f, %.1f%% hits, %.1f poses evaluated per frame, max relative palette error %g\n",
+			animatorNum, setting.first, setting.second, frameTime / 1000.0, referenceTime / frameTime,
+			hits + misses > 0 ? hits * 100.0f / (hits + misses) : 0.0f, static_cast<float>(misses) / frameNum, maxError);
+
+		// every animator asks the cache once per frame while sharing
+		passed = expect(hits + misses == (setting.first > 0.0f ? animatorNum * frameNum : 0), "pose", "animators bypassed the pose cache") && passed;
+	}
+
+	// paused animators hold the shared pose they were paused on
+	std::vector<float> playingPalettes = getPalettes();
+	for (AnimatorComponent& animatorComp : animatorComps)
+	{
+		animatorComp.pause();
+	}
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		poseCache.beginTick();
+		AnimatorComponent::tickAll(animators, deltaTime, false);
+	}
+	passed = expect(getPalettes() == playingPalettes, "pose", "paused animators lost their shared pose") && passed;
+
+	// animators with a reduced bone set evaluate their own pose, only the others ask the cache
+	for (uint32_t i = 0; i < animatorNum; ++i)
+	{
+		animatorComps[i].replay();
+		animatorComps[i].setLod(EAnimationLod::Full, i % 2 == 0 ? 4 : UINT32_MAX);
+	}
+	poseCache.beginTick();
+	AnimatorComponent::tickAll(animators, deltaTime, false);
+	PoseCacheStats reducedStats = poseCache.getStats();
+	passed = expect(reducedStats.hits + reducedStats.misses == animatorNum / 2, "pose", "animators with a reduced bone set used shared poses") && passed;
+
+	// the pose blocks go back to the pool before it is destroyed
+	animators.clear();
+	animatorComps.clear();
+	poseCache.destroy();
+
+	PosePool::getInstance().destroy();
+	ConfigManager::getInstance().destroy();
+	return passed;
+}
+
+bool Benchmark::runHierarchy(uint32_t nodeNum)
+{
+	AnimationKernels::getInstance().setSimdLevel(AnimationKernels::getSupportedSimdLevel());
+
+	// a scene graph below one root, each node hangs below a random earlier one and is created in shuffled order,
+	// so the storage starts out of depth order
+	std::mt19937 random(0);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::vector<uint32_t> parents(nodeNum, UINT32_MAX);
+	for (uint32_t i = 1; i < nodeNum; ++i)
+	{
+		parents[i] = std::uniform_int_distribution<uint32_t>(0, i - 1)(random);
+	}
+	std::vector<uint32_t> creationOrder(nodeNum);
+	for (uint32_t i = 0; i < nodeNum; ++i)
+	{
+		creationOrder[i] = i;
+	}
+	std::shuffle(creationOrder.begin(), creationOrder.end(), random);
+
+	entt::registry registry;
+	TransformHierarchy transformHierarchy;
+	transformHierarchy.init(registry);
+	std::vector<entt::entity> handles(nodeNum);
+	for (uint32_t i : creationOrder)
+	{
+		handles[i] = registry.create();
+		TransformComponent& transformComp = registry.emplace<TransformComponent>(handles[i]);
+		transformComp.position = glm::vec3(distribution(random), distribution(random), distribution(random));
+		transformComp.rotation = glm::vec3(distribution(random), distribution(random), distribution(random)) * 30.0f;
+		transformComp.scale = glm::vec3(1.0f + distribution(random) * 0.01f);
+	}
+
+	std::vector<ReferenceNode> referenceNodes(nodeNum);
+	for (uint32_t i = 0; i < nodeNum; ++i)
+	{
+		referenceNodes[i].handle = handles[i];
+		if (parents[i] != UINT32_MAX)
+		{
+			referenceNodes[parents[i]].children.insert(&referenceNodes[i]);
+			registry.get<TransformComponent>(handles[i]).parent = handles[parents[i]];
+		}
+	}
+
+	const uint32_t iterations = 20;
+	double recursiveTime = measureMicroseconds(iterations, [&]() { updateReference(referenceNodes[0], glm::mat4(1.0f), registry); });
+	std::vector<glm::mat4> referenceMatrices(nodeNum);
+	for (uint32_t i = 0; i < nodeNum; ++i)
+	{
+		referenceMatrices[i] = registry.get<TransformComponent>(handles[i]).worldMatrix;
+	}
+
+	// the first update sorts the storage, the others only propagate
+	auto begin = std::chrono::high_resolution_clock::now();
+	transformHierarchy.update();
+	double sortTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - begin).count();
+	double flatTime = measureMicroseconds(iterations, [&]() { transformHierarchy.update(); });
+
+	uint32_t maxDepth = 0;
+	float maxError = 0.0f;
+	for (uint32_t i = 0; i < nodeNum; ++i)
+	{
+		const TransformComponent& transformComp = registry.get<TransformComponent>(handles[i]);
+		maxDepth = std::max(maxDepth, transformComp.depth);
+		for (uint32_t j = 0; j < 4; ++j)
+		{
+			for (uint32_t k = 0; k < 4; ++k)
+			{
+				float expected = referenceMatrices[i][j][k];
+				maxError = std::max(maxError, std::abs(transformComp.worldMatrix[j][k] - expected) / std::max(std::abs(expected), 1.0f));
+			}
+		}
+	}
+
+	printf("hierarchy benchmark: %u nodes, depth %u, recursive %.3f ms, flat %.3f ms, speedup %.2f, first update with sort %.3f ms, max relative error %g\n",
+		nodeNum, maxDepth, recursiveTime / 1000.0, flatTime / 1000.0, recursiveTime / flatTime, sortTime / 1000.0, maxError);
+	bool passed = expect(maxError < 1e-4f, "hierarchy", "world matrices differ from the recursive update");
+
+	transformHierarchy.destroy();
+	return passed;
+}
+
+bool Benchmark::runCooker(uint32_t clipNum)
+{
+	ConfigManager::getInstance().init();
+	AnimationCompressor::getInstance().init();
+
+	// an animation only model like the mannequin clips, its source file is a stand in the cooked file is hashed against
+	boost::filesystem::path directory = boost::filesystem::temp_directory_path() / "bamboo_benchmark";
+	std::string filename = (directory / "asset" / "cooker.fbx").generic_string();
+	boost::filesystem::create_directories(directory / "asset");
+	{
+		std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+		file << "cooker benchmark " << clipNum;
+	}
+
+	std::mt19937 random(0);
+	Skeleton skeleton = buildRig(68, random);
+	AnimatorComponent animatorComp;
+	for (uint32_t i = 0; i < clipNum; ++i)
+	{
+		std::shared_ptr<Animation> animation = buildSwingClip(skeleton);
+		animation->name = "swing_" + std::to_string(i);
+		animatorComp.animations[animation->name] = animation;
+	}
+
+	ModelCooker& cooker = ModelCooker::getInstance();
+	StaticMeshComponent staticMeshComp;
+	SkeletalMeshComponent skeletalMeshComp;
+	double saveTime = measureMicroseconds(1, [&]() { cooker.save(filename, 0, staticMeshComp, skeletalMeshComp, animatorComp); });
+
+	const uint32_t iterations = 20;
+	bool loaded = true;
+	AnimatorComponent loadedAnimatorComp;
+	double loadTime = measureMicroseconds(iterations, [&]() {
+		loadedAnimatorComp.animations.clear();
+		loaded = cooker.load(filename, 0, staticMeshComp, skeletalMeshComp, loadedAnimatorComp) && loaded;
+	});
+
+	bool identical = loaded && loadedAnimatorComp.animations.size() == animatorComp.animations.size() && !staticMeshComp.mesh && !skeletalMeshComp.mesh;
+	for (const auto& iter : animatorComp.animations)
+	{
+		auto loadedIter = loadedAnimatorComp.animations.find(iter.first);
+		identical = identical && loadedIter != loadedAnimatorComp.animations.end() && isSameClip(*iter.second, *loadedIter->second);
+	}
+
+	boost::system::error_code ec;
+	uintmax_t cookedSize = boost::filesystem::file_size(cooker.getCookedFilename(filename), ec);
+	printf("cooker benchmark: %u clips, cooked file %.2f MB, saved in %.3f ms, loaded in %.3f ms, %s\n", clipNum, (ec ? 0 : cookedSize) / (1024.0f * 1024.0f),
+		saveTime / 1000.0, loadTime / 1000.0, !loaded ? "NOT loaded from the cache" : identical ? "identical to the saved clips" : "DIFFERS from the saved clips");
+	bool passed = expect(loaded, "cooker", "the animation only file wasn't loaded from the cache");
+	passed = expect(identical, "cooker", "loaded clips differ from the saved ones") && passed;
+
+	boost::filesystem::remove_all(directory, ec);
+	ConfigManager::getInstance().destroy();
+	return passed;
+}
+
+bool Benchmark::runOptimizer()
+{
+	// the sample meshes as assimp hands them over, one section per mesh, positions are all the optimizer reads
+	const std::vector<std::string> filenames = {
+		"asset/model/ground/ground.fbx",
+		"asset/model/exclamation/exclamation.fbx",
+		"asset/model/dinosaur/dinosaur.fbx",
+		"asset/model/mannequin/mannequin.fbx",
+		"asset/model/dragon/dragon.fbx",
+		"asset/model/armadillo/armadillo.fbx",
+		"asset/model/sponza/sponza.fbx",
+	};
+
+	bool passed = true;
+	uint32_t meshNum = 0;
+	for (const std::string& filename : filenames)
+	{
+		Assimp::Importer importer;
+		importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+		const aiScene* assScene = importer.ReadFile(filename.c_str(), aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_JoinIdenticalVertices);
+		if (!assScene || assScene->mNumMeshes == 0)
+		{
+			continue;
+		}
+
+		StaticMeshComponent staticMeshComp;
+		staticMeshComp.mesh = std::make_shared<StaticMesh>();
+		std::vector<StaticVertex>& vertices = staticMeshComp.mesh->vertices;
+		std::vector<uint32_t>& indices = staticMeshComp.mesh->indices;
+		for (uint32_t i = 0; i < assScene->mNumMeshes; ++i)
+		{
+			const aiMesh* assMesh = assScene->mMeshes[i];
+			Section section;
+			section.baseVertex = static_cast<uint32_t>(vertices.size());
+			for (uint32_t j = 0; j < assMesh->mNumFaces; ++j)
+			{
+				const aiFace& face = assMesh->mFaces[j];
+				if (face.mNumIndices == 3)
+				{
+					indices.insert(indices.end(), face.mIndices, face.mIndices + 3);
+				}
+			}
+			section.indexCount = static_cast<uint32_t>(indices.size());
+			staticMeshComp.sections.push_back(section);
+
+			for (uint32_t j = 0; j < assMesh->mNumVertices; ++j)
+			{
+				StaticVertex vertex{};
+				vertex.position = glm::vec3(assMesh->mVertices[j].x, assMesh->mVertices[j].y, assMesh->mVertices[j].z);
+				vertices.push_back(vertex);
+			}
+		}
+
+		MeshOptimizationStats stats;
+		double optimizeTime = measureMicroseconds(1, [&]() { stats = MeshOptimizer::optimize(staticMeshComp); });
+		printf("optimizer benchmark: %s, %zu triangles, %.1f ms, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", filename.c_str(), indices.size() / 3,
+			optimizeTime / 1000.0, stats.before.acmr, stats.after.acmr, stats.before.atvr, stats.after.atvr);
+		passed = expect(stats.after.acmr <= stats.before.acmr, "optimizer", "the vertex cache miss ratio got worse") && passed;
+		meshNum++;
+	}
+
+	// run from the engine directory, where the sample meshes are
+	return expect(meshNum > 0, "optimizer", "no sample mesh found under asset/model") && passed;
+}
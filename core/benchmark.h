@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+/*
+ * Synthetic benchmarks of the engine's hot loops, run with "-benchmark <name>" instead of starting the engine
+ * They need no window or device and print their timings to stdout. A benchmark also checks its results against a reference
+ * and fails when they differ, every timing is still printed.
+ */
+enum class EBenchmarkResult
+{
+	Passed, Failed, Unknown
+};
+
+class Benchmark
+{
+public:
+	// Unknown if there is no benchmark of that name, count overrides the benchmark's default problem size when non zero
+	static EBenchmarkResult run(const std::string& name, uint32_t count = 0);
+
+private:
+	static bool runSkeleton();
+	static bool runAnimation(uint32_t animatorNum);
+	static bool runKernels(uint32_t boneNum);
+	static bool runPalette(uint32_t boneNum);
+	static bool runBake(uint32_t vertexNum);
+	static bool runPoseShare(uint32_t animatorNum);
+	static bool runHierarchy(uint32_t nodeNum);
+	static bool runCooker(uint32_t clipNum);
+	static bool runOptimizer();
+};
@@ -5,6 +5,15 @@
 #include "input/input_manager.h"
 #include "config/config_manager.h"
 #include "utility/utility.h"
+#include "utility/thread_pool.h"
+#include "io/texture_cooker.h"
+#include "io/vertex_packer.h"
+#include "io/animation_compressor.h"
+#include "io/vertex_animation_baker.h"
+#include "component/animation_kernels.h"
+#include "component/pose_pool.h"
+#include "component/pose_cache.h"
+#include "rendering/streaming_service.h"
 #include "scene.h"
 
 void Engine::init()
@@ -14,6 +23,9 @@ void Engine::init()
 	uint32_t width, height;
 	ConfigManager::getInstance().getResolution(width, height);
 
+	// worker threads for asset loading
+	ThreadPool::getInstance().init();
+
 	// ʼɫ
 	ShaderManager::getInstance().init();
 
@@ -25,6 +37,27 @@ void Engine::init()
 	// ʼȾԴ
 	ResourceFactory::getInstance().init(m_backend);
 
+	// texture compression depends on what the device can sample
+	TextureCooker::getInstance().init(m_backend->isTextureCompressionBCSupported());
+
+	// packed vertex layout of imported meshes
+	VertexPacker::getInstance().init();
+
+	// error budget of imported animation clips
+	AnimationCompressor::getInstance().init();
+
+	// instruction set of animation sampling and pose evaluation
+	AnimationKernels::getInstance().init();
+
+	// frame rate of clips baked into vertex animation textures
+	VertexAnimationBaker::getInstance().init();
+
+	// palettes shared by animators playing the same clip in sync
+	PoseCache::getInstance().init();
+
+	// background uploads on the transfer queue
+	StreamingService::getInstance().init(m_backend);
+
 	// ʼȾ
 	m_renderer = std::make_shared<Renderer>();
 	m_renderer->init(m_backend);
@@ -53,6 +86,8 @@ void Engine::run()
 		glfwPollEvents();
 
 		m_renderer->wait();
+		ResourceFactory::getInstance().flushUploadBatches();
+		StreamingService::getInstance().update();
 		m_scene->tick(m_deltaTime);
 		m_renderer->update();
 		m_renderer->submit();
@@ -65,6 +100,7 @@ void Engine::run()
 		evaluateTime();
 	}
 
+	StreamingService::getInstance().wait();
 	vkDeviceWaitIdle(m_backend->getDevice());
 
 	m_scene->end();
@@ -73,20 +109,35 @@ void Engine::run()
 
 void Engine::destroy()
 {
+	StreamingService::getInstance().destroy();
 	ResourceFactory::getInstance().destroy();
+	TextureCooker::getInstance().destroy();
+	VertexPacker::getInstance().destroy();
+	AnimationCompressor::getInstance().destroy();
+	AnimationKernels::getInstance().destroy();
+	VertexAnimationBaker::getInstance().destroy();
+	ThreadPool::getInstance().destroy();
 	InputManager::getInstance().destroy();
 	ShaderManager::getInstance().destroy();
 	ConfigManager::getInstance().destroy();
 
 	m_scene->destroy();
+	PoseCache::getInstance().destroy();
+	BoneBindingCache::getInstance().destroy();
+	PosePool::getInstance().destroy();
 	m_renderer->destroy();
 	m_backend->destroy();
 }
 
 void Engine::updateTitle()
 {
-	char title[100];
-	snprintf(title, sizeof(title), "Bamboo Engine | FPS: %d", static_cast<int>(1.0f / m_deltaTime));
+	const ClusterCullStats& cullStats = m_scene->getClusterCullStats();
+	const AnimationLodStats& lodStats = m_scene->getAnimationLodStats();
+	char title[512];
+	snprintf(title, sizeof(title), "Bamboo Engine | FPS: %d | Clusters: %u/%u culled (%.1f%%) | Animators: %u full, %u half, %u quarter, %u baked, %u culled, %u palettes skipped, %u poses shared, %u evaluated",
+		static_cast<int>(1.0f / m_deltaTime), cullStats.frustumCulled + cullStats.backfaceCulled, cullStats.meshletCount, cullStats.getCullRate() * 100.0f,
+		lodStats.full, lodStats.half, lodStats.quarter, lodStats.baked, lodStats.culled, lodStats.paletteSkips,
+		lodStats.sharedPoses, lodStats.evaluatedPoses);
 	glfwSetWindowTitle(m_backend->getWindow(), title);
 }
 
@@ -9,12 +9,11 @@
 
 #define SWAPCHAIN_IMAGE_NUM 3
 #define INVALID_BONE -1
-#define MAX_BONE_NUM 100
 #define BONE_NUM_PER_VERTEX 4
 
 enum class EPipelineType
 {
-	StaticMesh, SkeletalMesh
+	StaticMesh, SkeletalMesh, VertexAnimation
 };
 
 const glm::vec3 ForwardVector = glm::vec3(1.0f, 0.0f, 0.0f);
@@ -27,14 +26,19 @@ struct Transform
 	glm::vec3 rotation = glm::vec3(0.0f);
 	glm::vec3 scale = glm::vec3(1.0f);
 
+	// the euler angles in degrees, applied around the forward, right and up axes in turn
+	glm::quat quaternion() const
+	{
+		return glm::angleAxis(glm::radians(rotation.x), ForwardVector) * glm::angleAxis(glm::radians(rotation.y), RightVector) *
+			glm::angleAxis(glm::radians(rotation.z), UpVector);
+	}
+
 	glm::mat4 matrix()
 	{
 		glm::mat4 modelMatrix(1.0f);
 
 		modelMatrix = glm::translate(modelMatrix, position);
-		modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.x), ForwardVector);
-		modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.y), RightVector);
-		modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.z), UpVector);
+		modelMatrix *= glm::mat4_cast(quaternion());
 		modelMatrix = glm::scale(modelMatrix, scale);
 
 		return modelMatrix;
@@ -4,7 +4,7 @@
 Entity::Entity(Scene* scene, entt::entity handle) :
 	m_scene(scene), m_handle(handle)
 {
-	m_parent = nullptr;
+
 }
 
 Entity::~Entity()
@@ -12,21 +12,17 @@ Entity::~Entity()
 
 }
 
+// the parent lives in the TransformComponent, the hierarchy is sorted again before the next transform update
 void Entity::attach(std::shared_ptr<Entity> parent)
 {
-	detach();
-
-	m_parent = parent.get();
-	m_parent->m_children.insert(this);
+	getComponent<TransformComponent>().parent = parent->m_handle;
+	m_scene->m_transformHierarchy.markDirty();
 }
 
 void Entity::detach()
 {
-	if (m_parent)
-	{
-		m_parent->m_children.erase(this);
-		m_parent = nullptr;
-	}
+	getComponent<TransformComponent>().parent = entt::null;
+	m_scene->m_transformHierarchy.markDirty();
 }
 
 void Entity::destroy()
@@ -37,25 +33,3 @@ void Entity::destroy()
 	m_scene->removeEntity(tag.name);
 	m_scene->getRegistry().remove(m_handle);
 }
-
-void Entity::update()
-{
-	auto& tag = getComponent<TagComponent>();
-	auto& transform = getComponent<TransformComponent>();
-	transform.localMatrix = transform.matrix();
-
-	if (m_parent)
-	{
-		auto& parentTransform = m_parent->getComponent<TransformComponent>();
-		transform.worldMatrix = parentTransform.worldMatrix * transform.localMatrix;
-	}
-	else
-	{
-		transform.worldMatrix = transform.localMatrix;
-	}
-
-	for (auto& iter : m_children)
-	{
-		iter->update();
-	}
-}
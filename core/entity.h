@@ -12,8 +12,6 @@ public:
 	void detach();
 	void destroy();
 
-	void update();
-
 	template<typename T, typename... Args>
 	T& addComponent(Args&&... args)
 	{
@@ -47,7 +45,4 @@ public:
 private:
 	Scene* m_scene;
 	entt::entity m_handle;
-
-	Entity* m_parent;
-	std::set<Entity*> m_children;
 };
\ No newline at end of file
@@ -2,9 +2,37 @@
 #include <iostream>
 
 #include "core/engine.h"
+#include "core/benchmark.h"
 
-int main()
+int main(int argc, char* argv[])
 {
+	if (argc >= 3 && std::string(argv[1]) == "-benchmark")
+	{
+		EBenchmarkResult result = EBenchmarkResult::Unknown;
+		try
+		{
+			uint32_t count = argc > 3 ? static_cast<uint32_t>(std::stoul(argv[3])) : 0;
+			result = Benchmark::run(argv[2], count);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		if (result == EBenchmarkResult::Unknown)
+		{
+			std::cerr << "unknown benchmark: " << argv[2] << std::endl;
+			return EXIT_FAILURE;
+		}
+		if (result == EBenchmarkResult::Failed)
+		{
+			std::cerr << "benchmark failed: " << argv[2] << std::endl;
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
 	Engine engine;
 
 	try
@@ -3,12 +3,16 @@
 #include "input/input_manager.h"
 #include "component/component.h"
 #include "io/asset_loader.h"
+#include "io/vertex_animation_baker.h"
 #include "rendering/renderer.h"
+#include "rendering/resource_factory.h"
 #include "utility/utility.h"
+#include "config/config_manager.h"
 
 void Scene::init(std::shared_ptr<class Renderer> renderer)
 {
 	m_renderer = renderer;
+	m_transformHierarchy.init(m_registry);
 
 	// ʼʱ
 	m_timerManager = std::make_shared<TimerManager>();
@@ -20,6 +24,13 @@ void Scene::init(std::shared_ptr<class Renderer> renderer)
 	m_camera = std::make_unique<Camera>(glm::vec3(8.5f, -1.9f, 3.9f), -194.4f, -18.7f, 2.0f, 0.1f);
 	m_camera->setFovy(45.0f);
 	m_camera->setClipping(0.1f, 1000.0f);
+	m_lodErrorPixels = ConfigManager::getInstance().getLodErrorPixels();
+	m_lodHysteresis = ConfigManager::getInstance().getLodHysteresis();
+	m_parallelAnimation = ConfigManager::getInstance().getAnimationParallel();
+	m_animationLodHalfPixels = ConfigManager::getInstance().getAnimationLodHalfPixels();
+	m_animationLodQuarterPixels = ConfigManager::getInstance().getAnimationLodQuarterPixels();
+	m_animationLodBoneDepth = ConfigManager::getInstance().getAnimationLodBoneDepth();
+	m_animationBakeDistance = ConfigManager::getInstance().getAnimationBakeDistance();
 
 	// ¼
 	InputManager::getInstance().registerKeyPressed(std::bind(&Camera::onKeyPressed, m_camera.get(), std::placeholders::_1));
@@ -47,12 +58,21 @@ void Scene::init(std::shared_ptr<class Renderer> renderer)
 		"asset/model/mannequin/mannequin_climb.fbx",
 	};
 
+	// all model files are imported on the worker threads at the same time
+	std::vector<std::future<ModelAsset>> modelFutures;
 	for (const std::string& meshName : meshNames)
 	{
-		StaticMeshComponent staticMeshComp;
-		SkeletalMeshComponent skeletalMeshComp;
-		AnimatorComponent animatorComp;
-		AssetLoader::getInstance().loadModel(meshName, staticMeshComp, skeletalMeshComp, animatorComp);
+		modelFutures.push_back(AssetLoader::getInstance().loadModelAsync(meshName));
+	}
+
+	// join in the original order on the main thread, so animations are matched after their skeletal meshes
+	for (size_t i = 0; i < meshNames.size(); ++i)
+	{
+		const std::string& meshName = meshNames[i];
+		ModelAsset modelAsset = modelFutures[i].get();
+		StaticMeshComponent& staticMeshComp = modelAsset.staticMeshComp;
+		SkeletalMeshComponent& skeletalMeshComp = modelAsset.skeletalMeshComp;
+		AnimatorComponent& animatorComp = modelAsset.animatorComp;
 
 		if (animatorComp.isValid())
 		{
@@ -88,6 +108,12 @@ void Scene::init(std::shared_ptr<class Renderer> renderer)
 		}
 	}
 
+	TextureCacheStats textureCacheStats = AssetLoader::getInstance().getTextureCacheStats();
+	printf("texture cache: %u hits, %u misses, decoded %.1f MB in %.3f s, saved %.1f MB and %.3f s\n",
+		textureCacheStats.hits, textureCacheStats.misses,
+		textureCacheStats.decodedBytes / (1024.0f * 1024.0f), textureCacheStats.decodeTime,
+		textureCacheStats.savedBytes / (1024.0f * 1024.0f), textureCacheStats.savedDecodeTime);
+
 	//m_entities["mannequin"]->attach(m_entities["sponza"]);
 	//m_entities["dragon"]->attach(m_entities["mannequin"]);
 	//m_entities["dragon"]->getComponent<TransformComponent>().position = glm::vec3(4.0f, 4.0f, 4.0f);
@@ -103,23 +129,48 @@ void Scene::init(std::shared_ptr<class Renderer> renderer)
 
 	m_entities["exclamation"]->attach(m_entities["dragon"]);
 	m_entities["exclamation"]->getComponent<TransformComponent>().position = glm::vec3(0.0f, 0.0f, 1.2f);
+
+	// models left out of the startup load are imported in the background and streamed in while the scene runs
+	for (const std::string& filename : ConfigManager::getInstance().getStreamedModels())
+	{
+		spawnModel(Utility::basename(filename), filename);
+	}
 }
 
 void Scene::destroy()
 {
+	m_transformHierarchy.destroy();
 	m_registry.clear();
 	m_entities.clear();
 }
 
 void Scene::pre()
 {
-	m_registry.view<StaticMeshComponent>().each([this](auto entity, StaticMeshComponent& staticMeshComp) {
-		staticMeshComp.initBatchResource(m_renderer);
+	// every mesh and texture of the scene goes to the GPU in one submit
+	auto& factory = ResourceFactory::getInstance();
+	std::shared_ptr<UploadBatch> uploadBatch = factory.createUploadBatch();
+
+	// the clips of an animated mesh are baked once, for the distant instances of all its components
+	std::map<const SkeletalMesh*, std::shared_ptr<VertexAnimation>> vertexAnimations;
+	m_registry.view<SkeletalMeshComponent, AnimatorComponent>().each([&vertexAnimations](auto entity, SkeletalMeshComponent& skeletalMeshComp, AnimatorComponent& animatorComp) {
+		auto iter = vertexAnimations.find(skeletalMeshComp.mesh.get());
+		if (iter == vertexAnimations.end())
+		{
+			std::shared_ptr<VertexAnimation> vertexAnimation = VertexAnimationBaker::getInstance().bake(*skeletalMeshComp.mesh, *skeletalMeshComp.skeleton, animatorComp.animations);
+			iter = vertexAnimations.emplace(skeletalMeshComp.mesh.get(), vertexAnimation).first;
+		}
+		skeletalMeshComp.vertexAnimation = iter->second;
 	});
 
-	m_registry.view<SkeletalMeshComponent>().each([this](auto entity, SkeletalMeshComponent& skeletalMeshComp) {
-		skeletalMeshComp.initBatchResource(m_renderer);
+	m_registry.view<StaticMeshComponent>().each([this, &uploadBatch](auto entity, StaticMeshComponent& staticMeshComp) {
+		staticMeshComp.initBatchResource(m_renderer, *uploadBatch);
+	});
+
+	m_registry.view<SkeletalMeshComponent>().each([this, &uploadBatch](auto entity, SkeletalMeshComponent& skeletalMeshComp) {
+		skeletalMeshComp.initBatchResource(m_renderer, *uploadBatch);
 	});
+
+	factory.submitUploadBatch(uploadBatch);
 }
 
 void Scene::begin()
@@ -146,6 +197,9 @@ void Scene::tick(float deltaTime)
 	// ¼ʱ
 	m_timerManager->tick(deltaTime);
 
+	// models spawned mid session start streaming once they are imported
+	tickSpawn();
+
 	// 泤
 	glm::ivec2 viewportSize = m_renderer->getViewportSize();
 	if (viewportSize.x != 0 && viewportSize.y != 0)
@@ -154,11 +208,83 @@ void Scene::tick(float deltaTime)
 	}
 
 	// ϴ
-	m_registry.view<SkeletalMeshComponent, AnimatorComponent>().each([this, deltaTime](auto entity, SkeletalMeshComponent& skeletalMeshComp, AnimatorComponent& animatorComp) {
-		skeletalMeshComp.updateUniformBuffer(m_renderer, sizeof(SkeletalMeshUBO), static_cast<void*>(animatorComp.gBones));
+	// every mesh gathers the model matrices and palettes of its visible instances, culled animators keep a stale palette
+	// and baked ones send their frames instead
+	glm::mat4 viewProjection = m_camera->getViewPerspectiveMatrix();
+	for (EPipelineType pipelineType : { EPipelineType::SkeletalMesh, EPipelineType::VertexAnimation })
+	{
+		for (const std::shared_ptr<BatchResource>& batchResource : m_renderer->getPipeline(pipelineType)->getBatchResources())
+		{
+			SkeletalBatchResource& skeletalBatchResource = static_cast<SkeletalBatchResource&>(*batchResource);
+			skeletalBatchResource.viewProjection = viewProjection;
+			skeletalBatchResource.clearInstances();
+		}
+	}
+
+	m_animationLodStats.paletteUploads = 0;
+	m_animationLodStats.paletteSkips = 0;
+	m_registry.view<TransformComponent, SkeletalMeshComponent>().each([this, &viewProjection](auto entity, TransformComponent& transformComp, SkeletalMeshComponent& skeletalMeshComp) {
+		AnimatorComponent* animatorComp = m_registry.try_get<AnimatorComponent>(entity);
+		if (!animatorComp)
+		{
+			if (skeletalMeshComp.isVisible(viewProjection * transformComp.worldMatrix))
+			{
+				skeletalMeshComp.addInstance(transformComp.worldMatrix, nullptr);
+			}
+		}
+		else if (animatorComp->getLod() == EAnimationLod::Culled)
+		{
+			m_animationLodStats.paletteSkips++;
+		}
+		else if (animatorComp->getLod() == EAnimationLod::Baked)
+		{
+			m_animationLodStats.paletteSkips++;
+			skeletalMeshComp.addBakedInstance(transformComp.worldMatrix, animatorComp->getAnimationName(), animatorComp->getAnimationTime(), animatorComp->isLooping());
+		}
+		else
+		{
+			m_animationLodStats.paletteUploads++;
+			skeletalMeshComp.addInstance(transformComp.worldMatrix, animatorComp->getPalette());
+		}
 	});
 }
 
+void Scene::spawnModel(const std::string& name, const std::string& filename)
+{
+	m_spawningModels.emplace_back(name, AssetLoader::getInstance().loadModelAsync(filename));
+}
+
+void Scene::tickSpawn()
+{
+	for (auto iter = m_spawningModels.begin(); iter != m_spawningModels.end();)
+	{
+		if (iter->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++iter;
+			continue;
+		}
+
+		ModelAsset modelAsset = iter->second.get();
+		auto entity = createEntity(iter->first);
+		if (modelAsset.staticMeshComp.isValid())
+		{
+			entity->addComponent<StaticMeshComponent>(modelAsset.staticMeshComp).streamBatchResource(m_renderer);
+		}
+		else if (modelAsset.skeletalMeshComp.isValid())
+		{
+			entity->addComponent<SkeletalMeshComponent>(modelAsset.skeletalMeshComp).streamBatchResource(m_renderer);
+			if (modelAsset.animatorComp.isValid())
+			{
+				modelAsset.animatorComp.skeleton = modelAsset.skeletalMeshComp.skeleton;
+				entity->addComponent<AnimatorComponent>(modelAsset.animatorComp);
+			}
+		}
+		entity->attach(m_rootEntity);
+
+		iter = m_spawningModels.erase(iter);
+	}
+}
+
 void Scene::end()
 {
 	m_timerManager->end();
@@ -201,40 +327,94 @@ void Scene::tickTransform(float deltaTime)
 	// TransformComponent
 	m_entities["dragon"]->getComponent<TransformComponent>().rotation = glm::vec3(0.0f, 0.0f, m_timerManager->time() * 90.0f);
 	m_entities["dragon"]->getComponent<TransformComponent>().position = glm::vec3(0.0f, 0.0f, std::sin(m_timerManager->time()) * 1.0f + 1.0f);
-	m_rootEntity->update();
+	m_transformHierarchy.update();
+
+	// pixels per world unit at distance one, scaled so a projected error of one means the allowed pixel error
+	float lodScale = std::abs(m_camera->getPerspectiveMatrix()[1][1]) * static_cast<float>(m_renderer->getViewportSize().y) * 0.5f / m_lodErrorPixels;
+	m_clusterCullStats = ClusterCullStats();
 
 	// StaticMeshComponent
-	m_registry.view<TransformComponent, StaticMeshComponent>().each([this](auto entity, TransformComponent& transformComp, StaticMeshComponent& staticMeshComp) {
+	m_registry.view<TransformComponent, StaticMeshComponent>().each([this, lodScale](auto entity, TransformComponent& transformComp, StaticMeshComponent& staticMeshComp) {
 		staticMeshComp.batchResource->vpco.m = transformComp.worldMatrix;
 		staticMeshComp.batchResource->vpco.mvp = m_camera->getViewPerspectiveMatrix() * transformComp.worldMatrix;
 		staticMeshComp.batchResource->fpco.cameraPosition = m_camera->getPosition();
 		staticMeshComp.batchResource->fpco.lightDirection = glm::vec3(-1.0f, 1.0f, -1.0f);
+		staticMeshComp.selectLod(transformComp.worldMatrix, m_camera->getPosition(), lodScale, m_lodHysteresis);
+		staticMeshComp.cullMeshlets(transformComp.worldMatrix, staticMeshComp.batchResource->vpco.mvp, m_camera->getPosition(), m_clusterCullStats);
 	});
 
 	// SkeletalMeshComponent
-	m_registry.view<TransformComponent, SkeletalMeshComponent>().each([this](auto entity, TransformComponent& transformComp, SkeletalMeshComponent& skeletalMeshComp) {
-		skeletalMeshComp.batchResource->vpco.m = transformComp.worldMatrix;
-		skeletalMeshComp.batchResource->vpco.mvp = m_camera->getViewPerspectiveMatrix() * transformComp.worldMatrix;
+	m_registry.view<TransformComponent, SkeletalMeshComponent>().each([this, lodScale](auto entity, TransformComponent& transformComp, SkeletalMeshComponent& skeletalMeshComp) {
 		skeletalMeshComp.batchResource->fpco.cameraPosition = m_camera->getPosition();
 		skeletalMeshComp.batchResource->fpco.lightDirection = glm::vec3(-1.0f, 1.0f, -1.0f);
+		if (skeletalMeshComp.bakedBatchResource)
+		{
+			skeletalMeshComp.bakedBatchResource->fpco = skeletalMeshComp.batchResource->fpco;
+		}
+		skeletalMeshComp.selectLod(transformComp.worldMatrix, m_camera->getPosition(), lodScale, m_lodHysteresis);
 	});
 }
 
 void Scene::tickAnimation(float deltaTime)
 {
 	// ¶
-	m_registry.view<AnimatorComponent>().each([this, deltaTime](auto entity, AnimatorComponent& animatorComp) {
-		//Transform transform;
-		//transform.rotation = glm::vec3(0.0f, 0.0f, m_timerManager->time() * 90.0f);
-		//transform.position = glm::vec3(std::sin(m_timerManager->time()) * 100.0f, 0.0f, 0.0f);
-		//glm::mat4 mat = transform.matrix();
-
-		//animatorComp.skeleton->getBone("calf_l").animatedTransform.rotation = glm::vec3(m_timerManager->time() * 2.0f, 0.0f, 0.0f);
-		//animatorComp.skeleton->getBone("calf_r").animatedTransform.rotation = glm::vec3(m_timerManager->time() * 2.0f, 0.0f, 0.0f);
-		//animatorComp.skeleton->getBone("hand_l").animatedTransform.rotation = glm::vec3(m_timerManager->time() * 2.0f, 0.0f, 0.0f);
-		//animatorComp.skeleton->getBone("middle_02_l").animatedTransform.rotation = glm::vec3(0.0f, m_timerManager->time() * 2.0f, 0.0f);
-		animatorComp.tick(deltaTime);
+	// animators are gathered first, so they can be split over the worker threads
+	// the update policy of each animator follows the screen size of its mesh
+	float pixelScale = std::abs(m_camera->getPerspectiveMatrix()[1][1]) * static_cast<float>(m_renderer->getViewportSize().y) * 0.5f;
+	m_animationLodStats.full = m_animationLodStats.half = m_animationLodStats.quarter = m_animationLodStats.baked = m_animationLodStats.culled = 0;
+
+	m_animators.clear();
+	m_registry.view<AnimatorComponent>().each([this, pixelScale](auto entity, AnimatorComponent& animatorComp) {
+		EAnimationLod lod = EAnimationLod::Full;
+		const SkeletalMeshComponent* skeletalMeshComp = m_registry.try_get<SkeletalMeshComponent>(entity);
+		if (skeletalMeshComp)
+		{
+			lod = selectAnimationLod(m_registry.get<TransformComponent>(entity).worldMatrix, *skeletalMeshComp, animatorComp, pixelScale);
+		}
+		animatorComp.setLod(lod, lod == EAnimationLod::Quarter ? m_animationLodBoneDepth : UINT32_MAX);
+
+		uint32_t* counters[] = { &m_animationLodStats.full, &m_animationLodStats.half, &m_animationLodStats.quarter, &m_animationLodStats.baked, &m_animationLodStats.culled };
+		(*counters[static_cast<uint32_t>(lod)])++;
+		m_animators.push_back(&animatorComp);
 	});
+	PoseCache::getInstance().beginTick();
+	AnimatorComponent::tickAll(m_animators, deltaTime, m_parallelAnimation);
+
+	PoseCacheStats poseCacheStats = PoseCache::getInstance().getStats();
+	m_animationLodStats.sharedPoses = poseCacheStats.hits;
+	m_animationLodStats.evaluatedPoses = poseCacheStats.misses;
+}
+
+EAnimationLod Scene::selectAnimationLod(const glm::mat4& worldMatrix, const SkeletalMeshComponent& meshComp, const AnimatorComponent& animatorComp, float pixelScale)
+{
+	if (!meshComp.isVisible(m_camera->getViewPerspectiveMatrix() * worldMatrix))
+	{
+		return EAnimationLod::Culled;
+	}
+
+	float scale = glm::max(glm::length(glm::vec3(worldMatrix[0])), glm::max(glm::length(glm::vec3(worldMatrix[1])), glm::length(glm::vec3(worldMatrix[2]))));
+	glm::vec3 center = glm::vec3(worldMatrix * glm::vec4(meshComp.bounds.center, 1.0f));
+	float radius = meshComp.bounds.radius * scale;
+	float distance = glm::length(center - m_camera->getPosition());
+
+	// the camera inside the bounds always sees full detail
+	if (distance <= radius)
+	{
+		return EAnimationLod::Full;
+	}
+
+	// far instances play their clip from the vertex animation texture
+	if (m_animationBakeDistance > 0.0f && distance > m_animationBakeDistance && animatorComp.isPlaying() && meshComp.hasBakedClip(animatorComp.getAnimationName()))
+	{
+		return EAnimationLod::Baked;
+	}
+
+	float projectedRadius = radius * pixelScale / distance;
+	if (projectedRadius >= m_animationLodHalfPixels)
+	{
+		return EAnimationLod::Full;
+	}
+	return projectedRadius >= m_animationLodQuarterPixels ? EAnimationLod::Half : EAnimationLod::Quarter;
 }
 
 void Scene::tickEvent(float deltaTime)
@@ -7,6 +7,8 @@
 
 #include "camera.h"
 #include "timer_manager.h"
+#include "transform_hierarchy.h"
+#include "io/asset_loader.h"
 
 class Scene
 {
@@ -23,7 +25,12 @@ public:
 	friend class Entity;
 	std::shared_ptr<class Entity> createEntity(const std::string& name);
 
+	// loads a model in the background and streams it to the GPU, the entity appears once its geometry is resident
+	void spawnModel(const std::string& name, const std::string& filename);
+
 	std::shared_ptr<TimerManager> getTimerManager() { return m_timerManager; }
+	const ClusterCullStats& getClusterCullStats() { return m_clusterCullStats; }
+	const AnimationLodStats& getAnimationLodStats() { return m_animationLodStats; }
 
 private:
 	entt::registry& getRegistry() { return m_registry; };
@@ -32,13 +39,35 @@ private:
 	void tickTransform(float deltaTime);
 	void tickEvent(float deltaTime);
 	void tickAnimation(float deltaTime);
+	EAnimationLod selectAnimationLod(const glm::mat4& worldMatrix, const SkeletalMeshComponent& skeletalMeshComp, const AnimatorComponent& animatorComp, float pixelScale);
+	void tickSpawn();
 
 	entt::registry m_registry;
 
 	std::shared_ptr<class Renderer> m_renderer;
 	std::shared_ptr<class Entity> m_rootEntity;
 	std::map<std::string, std::shared_ptr<class Entity>> m_entities;
+	TransformHierarchy m_transformHierarchy;
 
 	std::unique_ptr<Camera> m_camera;
 	std::shared_ptr<TimerManager> m_timerManager;
+
+	std::vector<std::pair<std::string, std::future<ModelAsset>>> m_spawningModels;
+
+	float m_lodErrorPixels;
+	float m_lodHysteresis;
+
+	bool m_parallelAnimation;
+	std::vector<struct AnimatorComponent*> m_animators;
+
+	// projected radius in pixels below which animators update at half and quarter rate, and the bone depth sampled at quarter rate
+	float m_animationLodHalfPixels;
+	float m_animationLodQuarterPixels;
+	uint32_t m_animationLodBoneDepth;
+
+	// distance beyond which animators with a baked clip are played from the vertex animation texture, 0 never plays them baked
+	float m_animationBakeDistance;
+
+	ClusterCullStats m_clusterCullStats;
+	AnimationLodStats m_animationLodStats;
 };
\ No newline at end of file
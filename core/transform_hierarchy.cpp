@@ -0,0 +1,118 @@
+#include "transform_hierarchy.h"
+#include "component/component.h"
+#include "component/animation_kernels.h"
+
+#include <algorithm>
+
+void TransformHierarchy::init(entt::registry& registry)
+{
+	m_registry = &registry;
+	m_registry->on_construct<TransformComponent>().connect<&TransformHierarchy::onChanged>(*this);
+	m_registry->on_destroy<TransformComponent>().connect<&TransformHierarchy::onChanged>(*this);
+	m_dirty = true;
+}
+
+void TransformHierarchy::destroy()
+{
+	if (m_registry)
+	{
+		m_registry->on_construct<TransformComponent>().disconnect<&TransformHierarchy::onChanged>(*this);
+		m_registry->on_destroy<TransformComponent>().disconnect<&TransformHierarchy::onChanged>(*this);
+		m_registry = nullptr;
+	}
+	m_streams.clear();
+	m_localMatrices.clear();
+}
+
+void TransformHierarchy::update()
+{
+	if (m_dirty)
+	{
+		sort();
+		m_dirty = false;
+	}
+
+	auto view = m_registry->view<TransformComponent>();
+	uint32_t count = static_cast<uint32_t>(view.size());
+	TransformComponent* transformComps = view.raw();
+
+	// euler angles are turned into quaternions, then all local matrices are composed in one batch
+	m_streams.resize(static_cast<size_t>(count) * 10);
+	m_localMatrices.resize(count);
+	float* streams = m_streams.data();
+	TransformStreams localTransforms;
+	localTransforms.position = VectorStream{ streams, streams + count, streams + 2 * count };
+	localTransforms.rotation = QuatStream{ streams + 3 * count, streams + 4 * count, streams + 5 * count, streams + 6 * count };
+	localTransforms.scale = VectorStream{ streams + 7 * count, streams + 8 * count, streams + 9 * count };
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		QuatTransform localTransform;
+		localTransform.position = transformComps[i].position;
+		localTransform.rotation = transformComps[i].quaternion();
+		localTransform.scale = transformComps[i].scale;
+		localTransforms.set(i, localTransform);
+	}
+	AnimationKernels::getInstance().compose(localTransforms, m_localMatrices.data(), count);
+
+	// parents come first, their world matrix is final when their children read it
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		TransformComponent& transformComp = transformComps[i];
+		transformComp.localMatrix = m_localMatrices[i];
+		transformComp.worldMatrix = transformComp.parentIndex != UINT32_MAX ?
+			transformComps[transformComp.parentIndex].worldMatrix * transformComp.localMatrix : transformComp.localMatrix;
+	}
+}
+
+void TransformHierarchy::sort()
+{
+	auto view = m_registry->view<TransformComponent>();
+	uint32_t count = static_cast<uint32_t>(view.size());
+	TransformComponent* transformComps = view.raw();
+
+	// the children of a destroyed entity become roots
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		TransformComponent& transformComp = transformComps[i];
+		if (transformComp.parent != entt::null && (!m_registry->valid(transformComp.parent) || !m_registry->has<TransformComponent>(transformComp.parent)))
+		{
+			transformComp.parent = entt::null;
+		}
+		transformComp.depth = UINT32_MAX;
+	}
+
+	// walks up to the first ancestor with a known depth, then sets the depths of the walked chain top down
+	std::vector<TransformComponent*> chain;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		TransformComponent* transformComp = &transformComps[i];
+		while (transformComp && transformComp->depth == UINT32_MAX)
+		{
+			chain.push_back(transformComp);
+			transformComp = transformComp->parent != entt::null ? &m_registry->get<TransformComponent>(transformComp->parent) : nullptr;
+		}
+
+		uint32_t depth = transformComp ? transformComp->depth + 1 : 0;
+		for (auto iter = chain.rbegin(); iter != chain.rend(); ++iter)
+		{
+			(*iter)->depth = depth++;
+		}
+		chain.clear();
+	}
+
+	// moving the components is the expensive part, a change that kept the depth order leaves them in place
+	auto compare = [](const TransformComponent& a, const TransformComponent& b) { return a.depth < b.depth; };
+	if (!std::is_sorted(transformComps, transformComps + count, compare))
+	{
+		m_registry->sort<TransformComponent>(compare);
+	}
+
+	// sorting moved the components, parents are looked up again in the sorted storage
+	transformComps = view.raw();
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		TransformComponent& transformComp = transformComps[i];
+		transformComp.parentIndex = transformComp.parent != entt::null ?
+			static_cast<uint32_t>(&m_registry->get<TransformComponent>(transformComp.parent) - transformComps) : UINT32_MAX;
+	}
+}
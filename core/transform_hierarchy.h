@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include <entt/entt.hpp>
+
+#include "engine_type.h"
+
+/*
+ * Flattened transform hierarchy over the TransformComponents of a registry
+ * The transform storage is sorted by depth after entities are attached, detached, created or destroyed, so a parent always comes
+ * before its children and the world matrices are propagated in one linear pass. Local matrices are composed in one batch by the AnimationKernels.
+ */
+class TransformHierarchy
+{
+public:
+	void init(entt::registry& registry);
+	void destroy();
+
+	// the storage is sorted again before the next update
+	void markDirty() { m_dirty = true; }
+
+	// local and world matrices of every transform
+	void update();
+
+private:
+	void onChanged(entt::registry&, entt::entity) { m_dirty = true; }
+
+	// depths of all transforms, then the storage sorted by them and the parent indices into it
+	void sort();
+
+	entt::registry* m_registry = nullptr;
+	bool m_dirty = true;
+
+	// local transforms as SoA streams, one array per component, grown with the storage
+	std::vector<float> m_streams;
+	std::vector<glm::mat4> m_localMatrices;
+};
@@ -0,0 +1,226 @@
+#include "animation_compressor.h"
+#include "config/config_manager.h"
+
+#include <algorithm>
+
+namespace
+{
+	// keys between two kept keys are dropped while interpolating the kept pair reproduces them within tolerance,
+	// uniform tracks keep every frame unless the whole track is constant
+	template<typename KeyType, typename Interpolate, typename Measure>
+	std::vector<uint32_t> reduceKeys(const std::vector<KeyType>& keys, float tolerance, bool uniform, Interpolate interpolate, Measure measure)
+	{
+		std::vector<uint32_t> keptKeys;
+		if (keys.empty())
+		{
+			return keptKeys;
+		}
+
+		// a constant track keeps a single key
+		keptKeys.push_back(0);
+		bool constant = true;
+		for (const KeyType& key : keys)
+		{
+			constant &= measure(key.value, keys[0].value) <= tolerance;
+		}
+		if (constant)
+		{
+			return keptKeys;
+		}
+
+		uint32_t keyCount = static_cast<uint32_t>(keys.size());
+		if (uniform)
+		{
+			for (uint32_t i = 1; i < keyCount; ++i)
+			{
+				keptKeys.push_back(i);
+			}
+			return keptKeys;
+		}
+
+		uint32_t anchor = 0;
+		for (uint32_t end = 2; end < keyCount; ++end)
+		{
+			float span = keys[end].time - keys[anchor].time;
+			bool fits = span > 0.0f;
+			for (uint32_t i = anchor + 1; i < end && fits; ++i)
+			{
+				float t = (keys[i].time - keys[anchor].time) / span;
+				fits = measure(interpolate(keys[anchor].value, keys[end].value, t), keys[i].value) <= tolerance;
+			}
+
+			if (!fits)
+			{
+				anchor = end - 1;
+				keptKeys.push_back(anchor);
+			}
+		}
+		keptKeys.push_back(keyCount - 1);
+		return keptKeys;
+	}
+
+	// the keys interpolated at frameCount evenly spaced times over the clip
+	template<typename KeyType, typename Interpolate>
+	std::vector<KeyType> resampleKeys(const std::vector<KeyType>& keys, float duration, uint32_t frameCount, Interpolate interpolate)
+	{
+		std::vector<KeyType> frames;
+		if (keys.empty())
+		{
+			return frames;
+		}
+
+		for (uint32_t i = 0; i < frameCount; ++i)
+		{
+			KeyType frame;
+			frame.time = duration * i / (frameCount - 1);
+
+			auto high = std::upper_bound(keys.begin(), keys.end(), frame);
+			if (high == keys.begin() || high == keys.end())
+			{
+				frame.value = high == keys.begin() ? keys.front().value : keys.back().value;
+			}
+			else
+			{
+				auto low = high - 1;
+				frame.value = interpolate(low->value, high->value, (frame.time - low->time) / (high->time - low->time));
+			}
+			frames.push_back(frame);
+		}
+		return frames;
+	}
+
+	uint16_t packTime(float time, float duration)
+	{
+		return duration > 0.0f ? static_cast<uint16_t>(std::clamp(time / duration, 0.0f, 1.0f) * 65535.0f + 0.5f) : 0;
+	}
+}
+
+AnimationCompressor& AnimationCompressor::getInstance()
+{
+	static AnimationCompressor compressor;
+	return compressor;
+}
+
+void AnimationCompressor::init()
+{
+	m_error = ConfigManager::getInstance().getAnimationError();
+	m_sampleRate = ConfigManager::getInstance().getAnimationSampleRate();
+}
+
+void AnimationCompressor::destroy()
+{
+
+}
+
+std::shared_ptr<Animation> AnimationCompressor::compress(const std::string& name, float duration, float frameRate,
+	const std::map<std::string, RawAnimationChannel>& rawChannels, float skeletonSize)
+{
+	std::shared_ptr<Animation> animation = std::make_shared<Animation>();
+	animation->name = name;
+	animation->duration = duration;
+	animation->frameRate = frameRate;
+
+	// one frame per 1 / m_sampleRate seconds, frameRate being ticks per second
+	bool uniform = m_sampleRate > 0.0f && duration > 0.0f;
+	if (uniform)
+	{
+		animation->frameCount = std::max(static_cast<uint32_t>(std::ceil(duration / frameRate * m_sampleRate)), 1u) + 1;
+	}
+
+	float tolerance = m_error * skeletonSize;
+	for (const auto& iter : rawChannels)
+	{
+		RawAnimationChannel rawChannel = iter.second;
+		if (uniform)
+		{
+			auto mix = [](const glm::vec3& a, const glm::vec3& b, float t) { return glm::mix(a, b, t); };
+			rawChannel.positionKeys = resampleKeys(rawChannel.positionKeys, duration, animation->frameCount, mix);
+			rawChannel.scaleKeys = resampleKeys(rawChannel.scaleKeys, duration, animation->frameCount, mix);
+			rawChannel.rotationKeys = resampleKeys(rawChannel.rotationKeys, duration, animation->frameCount,
+				[](const glm::quat& a, const glm::quat& b, float t) { return glm::slerp(a, b, t); });
+		}
+
+		// end bones still swing the vertices they skin, so their lever never drops to zero
+		float lever = std::max(rawChannel.chainLength, skeletonSize * 0.05f);
+		if (lever <= 0.0f)
+		{
+			lever = 1.0f;
+		}
+
+		AnimationChannel channel;
+		channel.position = addVectorTrack(rawChannel.positionKeys, reduceVectorKeys(rawChannel.positionKeys, tolerance, uniform),
+			duration, uniform ? nullptr : &animation->positionTimes, animation->positions);
+		channel.scale = addVectorTrack(rawChannel.scaleKeys, reduceVectorKeys(rawChannel.scaleKeys, tolerance / lever, uniform),
+			duration, uniform ? nullptr : &animation->scaleTimes, animation->scales);
+
+		std::vector<uint32_t> keptRotations = reduceQuatKeys(rawChannel.rotationKeys, tolerance / lever, uniform);
+		channel.rotation.firstKey = static_cast<uint32_t>(animation->rotations.size());
+		channel.rotation.keyCount = static_cast<uint32_t>(keptRotations.size());
+		for (uint32_t key : keptRotations)
+		{
+			if (!uniform)
+			{
+				animation->rotationTimes.push_back(packTime(rawChannel.rotationKeys[key].time, duration));
+			}
+			animation->rotations.push_back(packQuat(rawChannel.rotationKeys[key].value));
+		}
+
+		animation->channelNames.push_back(iter.first);
+		animation->channels.push_back(channel);
+	}
+
+	return animation;
+}
+
+std::vector<uint32_t> AnimationCompressor::reduceVectorKeys(const std::vector<VectorKey>& keys, float tolerance, bool uniform)
+{
+	return reduceKeys(keys, tolerance, uniform,
+		[](const glm::vec3& a, const glm::vec3& b, float t) { return glm::mix(a, b, t); },
+		[](const glm::vec3& a, const glm::vec3& b) { return glm::length(a - b); });
+}
+
+std::vector<uint32_t> AnimationCompressor::reduceQuatKeys(const std::vector<QuatKey>& keys, float tolerance, bool uniform)
+{
+	// tolerance is an angle here, the error of a rotation is the angle to the reference
+	return reduceKeys(keys, tolerance, uniform,
+		[](const glm::quat& a, const glm::quat& b, float t) { return glm::slerp(a, b, t); },
+		[](const glm::quat& a, const glm::quat& b) { return 2.0f * std::acos(std::min(std::abs(glm::dot(glm::normalize(a), glm::normalize(b))), 1.0f)); });
+}
+
+AnimationTrack AnimationCompressor::addVectorTrack(const std::vector<VectorKey>& keys, const std::vector<uint32_t>& keptKeys, float duration,
+	std::vector<uint16_t>* times, std::vector<PackedVector>& values)
+{
+	AnimationTrack track;
+	track.firstKey = static_cast<uint32_t>(values.size());
+	track.keyCount = static_cast<uint32_t>(keptKeys.size());
+	if (keptKeys.empty())
+	{
+		return track;
+	}
+
+	glm::vec3 boundsMin = keys[keptKeys[0]].value;
+	glm::vec3 boundsMax = boundsMin;
+	for (uint32_t key : keptKeys)
+	{
+		boundsMin = glm::min(boundsMin, keys[key].value);
+		boundsMax = glm::max(boundsMax, keys[key].value);
+	}
+	track.offset = boundsMin;
+	track.range = boundsMax - boundsMin;
+
+	for (uint32_t key : keptKeys)
+	{
+		PackedVector packedVector;
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			float value = track.range[i] > 0.0f ? (keys[key].value[i] - boundsMin[i]) / track.range[i] : 0.0f;
+			packedVector.data[i] = static_cast<uint16_t>(std::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+		}
+		if (times)
+		{
+			times->push_back(packTime(keys[key].time, duration));
+		}
+		values.push_back(packedVector);
+	}
+	return track;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "component/animation.h"
+
+// full rate keys of one bone as imported
+struct RawAnimationChannel
+{
+	std::vector<VectorKey> positionKeys;
+	std::vector<QuatKey> rotationKeys;
+	std::vector<VectorKey> scaleKeys;
+
+	// distance from the bone to its furthest descendant joint, a rotation error moves that joint the most
+	float chainLength = 0.0f;
+};
+
+/*
+ * Import time animation clip compression
+ * Keys that linear or spherical interpolation of their neighbours reproduces within the error budget are dropped.
+ * The budget is a distance, so rotation and scale errors are weighed by how far they swing the bone's descendants.
+ * The kept rotations are stored as smallest three quaternions, positions and scales are quantized against their track range.
+ * With a sample rate configured the tracks are resampled to uniform frames instead and only constant tracks are reduced,
+ * so sampling indexes the two frames around the time directly.
+ */
+class AnimationCompressor
+{
+public:
+	static AnimationCompressor& getInstance();
+	void init();
+	void destroy();
+
+	// the clips of cooked models depend on both, the cache is rejected when they change
+	float getError() const { return m_error; }
+	float getSampleRate() const { return m_sampleRate; }
+
+	// skeletonSize scales the configured relative error into a distance
+	std::shared_ptr<Animation> compress(const std::string& name, float duration, float frameRate,
+		const std::map<std::string, RawAnimationChannel>& rawChannels, float skeletonSize);
+
+private:
+	std::vector<uint32_t> reduceVectorKeys(const std::vector<VectorKey>& keys, float tolerance, bool uniform);
+	std::vector<uint32_t> reduceQuatKeys(const std::vector<QuatKey>& keys, float tolerance, bool uniform);
+
+	// uniform tracks have no key times
+	AnimationTrack addVectorTrack(const std::vector<VectorKey>& keys, const std::vector<uint32_t>& keptKeys, float duration,
+		std::vector<uint16_t>* times, std::vector<PackedVector>& values);
+
+	float m_error;
+	float m_sampleRate;
+};
@@ -1,8 +1,17 @@
 #include "asset_loader.h"
+#include "model_cooker.h"
+#include "texture_cooker.h"
+#include "vertex_packer.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "meshlet_builder.h"
+#include "animation_compressor.h"
 #include "utility/utility.h"
+#include "utility/thread_pool.h"
 
 #include <fstream>
 #include <iostream>
+#include <chrono>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image/stb_image.h>
@@ -58,9 +67,41 @@ std::vector<char> AssetLoader::loadBinary(const std::string& filename)
 
 void AssetLoader::loadModel(const std::string& filename, StaticMeshComponent& staticMeshComp, SkeletalMeshComponent& skeletalMeshComp, AnimatorComponent& animatorComp)
 {
+	const uint32_t importFlags = aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_JoinIdenticalVertices | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace;
+
+	// cooked cache hit, skip assimp entirely
+	if (!ModelCooker::getInstance().load(filename, importFlags, staticMeshComp, skeletalMeshComp, animatorComp))
+	{
+		importModel(filename, importFlags, staticMeshComp, skeletalMeshComp, animatorComp);
+		ModelCooker::getInstance().save(filename, importFlags, staticMeshComp, skeletalMeshComp, animatorComp);
+	}
+
+	// the GPU copy is quantized after cooking, so the cooked file stays independent of the packed format
+	if (staticMeshComp.mesh)
+	{
+		VertexPacker::getInstance().pack(*staticMeshComp.mesh);
+	}
+	if (skeletalMeshComp.mesh)
+	{
+		VertexPacker::getInstance().pack(*skeletalMeshComp.mesh);
+	}
+}
+
+std::future<ModelAsset> AssetLoader::loadModelAsync(const std::string& filename)
+{
+	return ThreadPool::getInstance().enqueue([this, filename]() {
+		ModelAsset modelAsset;
+		loadModel(filename, modelAsset.staticMeshComp, modelAsset.skeletalMeshComp, modelAsset.animatorComp);
+		return modelAsset;
+	});
+}
+
+void AssetLoader::importModel(const std::string& filename, uint32_t importFlags, StaticMeshComponent& staticMeshComp, SkeletalMeshComponent& skeletalMeshComp, AnimatorComponent& animatorComp)
+{
+	// points and lines can't be triangulated, they are dropped so every section is a triangle list
 	Assimp::Importer importer;
-	const aiScene* assScene = importer.ReadFile(filename.c_str(),
-		aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
+	importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+	const aiScene* assScene = importer.ReadFile(filename.c_str(), importFlags);
 
 	if (!assScene || !assScene->mRootNode)
 	{
@@ -81,8 +122,7 @@ void AssetLoader::loadModel(const std::string& filename, StaticMeshComponent& st
 	if (assScene->mMeshes[0]->HasBones())
 	{
 		std::shared_ptr<Skeleton> skeleton = std::make_shared<Skeleton>();
-		processSkeleton(assScene->mMeshes[0], skeleton);
-		processBoneNode(assScene->mRootNode, skeleton);
+		processSkeleton(assScene, skeleton);
 
 		skeletalMeshComp.mesh = std::make_shared<SkeletalMesh>();
 		skeletalMeshComp.skeleton = skeleton;
@@ -93,12 +133,123 @@ void AssetLoader::loadModel(const std::string& filename, StaticMeshComponent& st
 	}
 
 	processMeshNode(assScene->mRootNode, assScene, filename, staticMeshComp, skeletalMeshComp);
+
+	// reordering keeps every section's index and vertex range, so it runs before the index type is chosen
+	if (staticMeshComp.mesh)
+	{
+		MeshOptimizer::optimize(staticMeshComp);
+	}
+	else
+	{
+		MeshOptimizer::optimize(skeletalMeshComp);
+	}
+
+	// levels of detail are simplified from the optimized full detail indices and appended behind them
+	if (staticMeshComp.mesh)
+	{
+		staticMeshComp.bounds = computeBoundingSphere(staticMeshComp.mesh->vertices);
+		MeshSimplifier::generateLods(staticMeshComp);
+		MeshletBuilder::build(staticMeshComp);
+	}
+	if (skeletalMeshComp.mesh)
+	{
+		skeletalMeshComp.bounds = computeBoundingSphere(skeletalMeshComp.mesh->vertices);
+		MeshSimplifier::generateLods(skeletalMeshComp);
+	}
+
+	if (staticMeshComp.mesh)
+	{
+		staticMeshComp.mesh->indexType = getIndexType(staticMeshComp.mesh->indices);
+	}
+	if (skeletalMeshComp.mesh)
+	{
+		skeletalMeshComp.mesh->indexType = getIndexType(skeletalMeshComp.mesh->indices);
+	}
+}
+
+// bytes held in memory, compressed levels when the texture has them
+size_t getTextureSize(const Texture& texture)
+{
+	return texture.levels.empty() ? static_cast<size_t>(texture.width) * texture.height * 4 : texture.levelData.size();
 }
 
 std::shared_ptr<Texture> AssetLoader::loadTexure(const std::string& filename)
+{
+	std::string key = boost::filesystem::path(filename).lexically_normal().generic_string();
+
+	std::shared_ptr<TextureCacheEntry> entry;
+	{
+		std::lock_guard<std::mutex> lock(m_textureCacheMutex);
+		std::shared_ptr<TextureCacheEntry>& cacheEntry = m_textureCache[key];
+		if (!cacheEntry)
+		{
+			cacheEntry = std::make_shared<TextureCacheEntry>();
+		}
+		entry = cacheEntry;
+	}
+
+	// only loads of the same file wait on each other, different files still decode in parallel
+	std::lock_guard<std::mutex> entryLock(entry->mutex);
+	std::shared_ptr<Texture> texture = entry->texture.lock();
+	if (texture)
+	{
+		std::lock_guard<std::mutex> lock(m_textureCacheMutex);
+		m_textureCacheStats.hits++;
+		m_textureCacheStats.savedDecodeTime += entry->decodeTime;
+		m_textureCacheStats.savedBytes += getTextureSize(*texture);
+		return texture;
+	}
+
+	auto beginTime = std::chrono::high_resolution_clock::now();
+	texture = decodeTexture(key);
+	entry->decodeTime = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - beginTime).count();
+	entry->texture = texture;
+
+	std::lock_guard<std::mutex> lock(m_textureCacheMutex);
+	m_textureCacheStats.misses++;
+	m_textureCacheStats.decodeTime += entry->decodeTime;
+	m_textureCacheStats.decodedBytes += getTextureSize(*texture);
+	return texture;
+}
+
+TextureCacheStats AssetLoader::getTextureCacheStats()
+{
+	std::lock_guard<std::mutex> lock(m_textureCacheMutex);
+	return m_textureCacheStats;
+}
+
+void AssetLoader::purgeTextureCache()
+{
+	std::lock_guard<std::mutex> lock(m_textureCacheMutex);
+	for (auto iter = m_textureCache.begin(); iter != m_textureCache.end();)
+	{
+		// entries that are still being decoded are kept
+		std::unique_lock<std::mutex> entryLock(iter->second->mutex, std::try_to_lock);
+		if (entryLock.owns_lock() && iter->second->texture.expired())
+		{
+			entryLock.unlock();
+			iter = m_textureCache.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+}
+
+std::shared_ptr<Texture> AssetLoader::decodeTexture(const std::string& filename)
 {
 	std::shared_ptr<Texture> texture = std::make_shared<Texture>();
 	texture->name = Utility::basename(filename);
+	texture->filename = filename;
+
+	// a cooked container skips stb, the mip filter and the block compressor
+	TextureCooker& cooker = TextureCooker::getInstance();
+	if (cooker.load(*texture))
+	{
+		return texture;
+	}
+
 	texture->data = stbi_load(filename.c_str(), &texture->width, &texture->height, &texture->channels, STBI_rgb_alpha);
 
 	if (!texture->data)
@@ -106,6 +257,8 @@ std::shared_ptr<Texture> AssetLoader::loadTexure(const std::string& filename)
 		throw std::runtime_error((boost::format("failed to load texture%s") % filename).str());
 	}
 
+	cooker.cook(*texture);
+
 	return texture;
 }
 
@@ -143,7 +296,7 @@ void AssetLoader::processMeshNode(aiNode* assNode, const aiScene* assScene, cons
 			auto& mesh = skeletalMeshComp.mesh;
 			uint32_t baseIndex = static_cast<uint32_t>(mesh->vertices.size());
 			processSection(assMesh, assScene, filename, baseIndex, mesh->indices, skeletalMeshComp.sections);
-			processSkeletalVertices(assMesh, assScene, mesh->vertices);
+			processSkeletalVertices(assMesh, assScene, *skeletalMeshComp.skeleton, mesh->vertices);
 		}
 	}
 
@@ -153,79 +306,103 @@ void AssetLoader::processMeshNode(aiNode* assNode, const aiScene* assScene, cons
 	}
 }
 
-void AssetLoader::processBoneNode(struct aiNode* assNode, std::shared_ptr<Skeleton>& skeleton)
+// bones are added in hierarchy order, so every parent precedes its children
+void AssetLoader::processBoneNode(struct aiNode* assNode, const std::map<std::string, glm::mat4>& inverseBindPoses,
+	int parent, const glm::mat4& parentToNode, std::shared_ptr<Skeleton>& skeleton)
 {
-	std::string parentName = assNode->mName.C_Str();
-	if (skeleton->hasBone(parentName))
+	// nodes between two bones, such as fbx pivots, are folded into the local bind pose of the lower bone
+	glm::mat4 nodeTransform = parentToNode * assMatToGlmMat(assNode->mTransformation);
+	auto iter = inverseBindPoses.find(assNode->mName.C_Str());
+	if (iter != inverseBindPoses.end())
 	{
-		Bone& parentBone = skeleton->getBone(parentName);
-		parentBone.localBindPoseMatrix = assMatToGlmMat(assNode->mTransformation);
-		for (uint32_t i = 0; i < assNode->mNumChildren; ++i)
-		{
-			std::string childName = assNode->mChildren[i]->mName.C_Str();
-			if (skeleton->hasBone(childName))
-			{
-				Bone& childBone = skeleton->getBone(childName);
-				parentBone.children.push_back(&childBone);
-				childBone.parent = &parentBone;
-			}
-		}
+		parent = static_cast<int>(skeleton->addBone(iter->first, parent, nodeTransform, iter->second));
+		nodeTransform = glm::mat4(1.0f);
+	}
+	else if (parent == INVALID_BONE)
+	{
+		nodeTransform = glm::mat4(1.0f);
 	}
 
 	for (uint32_t i = 0; i < assNode->mNumChildren; ++i)
 	{
-		processBoneNode(assNode->mChildren[i], skeleton);
+		processBoneNode(assNode->mChildren[i], inverseBindPoses, parent, nodeTransform, skeleton);
 	}
 }
 
-void AssetLoader::processSkeleton(struct aiMesh* assMesh, std::shared_ptr<Skeleton>& skeleton)
+void AssetLoader::processSkeleton(const struct aiScene* assScene, std::shared_ptr<Skeleton>& skeleton)
 {
-	for (uint8_t i = 0; i < static_cast<uint8_t>(assMesh->mNumBones); ++i)
+	std::map<std::string, glm::mat4> inverseBindPoses;
+	for (uint32_t i = 0; i < assScene->mNumMeshes; ++i)
 	{
-		aiBone* assBone = assMesh->mBones[i];
-		std::string name = assBone->mName.C_Str();
+		aiMesh* assMesh = assScene->mMeshes[i];
+		for (uint32_t j = 0; j < assMesh->mNumBones; ++j)
+		{
+			aiBone* assBone = assMesh->mBones[j];
+			inverseBindPoses[assBone->mName.C_Str()] = assMatToGlmMat(assBone->mOffsetMatrix);
+		}
+	}
 
-		Bone bone;
-		bone.name = name;
-		bone.globalInverseBindPoseMatrix = assMatToGlmMat(assBone->mOffsetMatrix);
-		skeleton->bones.push_back(bone);
-		skeleton->nameIndexMap[name] = i;
+	processBoneNode(assScene->mRootNode, inverseBindPoses, INVALID_BONE, glm::mat4(1.0f), skeleton);
+}
+
+// distance from every node to its furthest descendant, the lever arm of the node's rotation
+float computeChainLengths(const aiNode* assNode, std::map<std::string, float>& chainLengths)
+{
+	float chainLength = 0.0f;
+	for (uint32_t i = 0; i < assNode->mNumChildren; ++i)
+	{
+		const aiNode* assChild = assNode->mChildren[i];
+		float childLength = glm::length(glm::vec3(assMatToGlmMat(assChild->mTransformation)[3]));
+		chainLength = std::max(chainLength, childLength + computeChainLengths(assChild, chainLengths));
 	}
+
+	// fbx pivot nodes share the bone name, the bone keeps the longest chain
+	std::string name = assNode->mName.C_Str();
+	Utility::replace(name, "_$AssimpFbx$_Rotation", "");
+	chainLengths[name] = std::max(chainLengths[name], chainLength);
+	return chainLength;
 }
 
 void AssetLoader::processAnimation(const struct aiScene* assScene, const std::string& filename, AnimatorComponent& animatorComp)
 {
+	std::map<std::string, float> chainLengths;
+	float skeletonSize = computeChainLengths(assScene->mRootNode, chainLengths);
+
 	for (uint32_t i = 0; i < assScene->mNumAnimations; ++i)
 	{
 		aiAnimation* assAnimation = assScene->mAnimations[i];
-		std::shared_ptr<Animation> animation = std::make_shared<Animation>();
 
 		//animation->name = assAnimation->mName.C_Str();
-		animation->name = Utility::basename(filename);
-		animation->duration = static_cast<float>(assAnimation->mDuration);
-		animation->frameRate = static_cast<float>(assAnimation->mTicksPerSecond > 0.0 ? assAnimation->mTicksPerSecond : 24.0);
+		std::string name = Utility::basename(filename);
+		float duration = static_cast<float>(assAnimation->mDuration);
+		float frameRate = static_cast<float>(assAnimation->mTicksPerSecond > 0.0 ? assAnimation->mTicksPerSecond : 24.0);
+
+		std::map<std::string, RawAnimationChannel> rawChannels;
 		for (uint32_t j = 0; j < assAnimation->mNumChannels; ++j)
 		{
 			aiNodeAnim* channel = assAnimation->mChannels[j];
-			std::string name = channel->mNodeName.C_Str();
-			Utility::replace(name, "_$AssimpFbx$_Rotation", "");
+			std::string channelName = channel->mNodeName.C_Str();
+			Utility::replace(channelName, "_$AssimpFbx$_Rotation", "");
+			RawAnimationChannel& rawChannel = rawChannels[channelName];
+			rawChannel.chainLength = chainLengths[channelName];
 			for (uint32_t k = 0; k < channel->mNumPositionKeys; ++k)
 			{
 				const aiVectorKey& key = channel->mPositionKeys[k];
-				animation->positionKeys[name].push_back({ static_cast<float>(key.mTime), assVectorToGlmVector(key.mValue) });
+				rawChannel.positionKeys.push_back({ static_cast<float>(key.mTime), assVectorToGlmVector(key.mValue) });
 			}
 			for (uint32_t k = 0; k < channel->mNumRotationKeys; ++k)
 			{
 				const aiQuatKey& key = channel->mRotationKeys[k];
-				animation->rotationKeys[name].push_back({ static_cast<float>(key.mTime), assQuatToGlmQuat(key.mValue) });
+				rawChannel.rotationKeys.push_back({ static_cast<float>(key.mTime), assQuatToGlmQuat(key.mValue) });
 			}
 			for (uint32_t k = 0; k < channel->mNumScalingKeys; ++k)
 			{
 				const aiVectorKey& key = channel->mScalingKeys[k];
-				animation->scaleKeys[name].push_back({ static_cast<float>(key.mTime), assVectorToGlmVector(key.mValue) });
+				rawChannel.scaleKeys.push_back({ static_cast<float>(key.mTime), assVectorToGlmVector(key.mValue) });
 			}
 		}
 
+		std::shared_ptr<Animation> animation = AnimationCompressor::getInstance().compress(name, duration, frameRate, rawChannels, skeletonSize);
 		animatorComp.animations[animation->name] = animation;
 	}
 }
@@ -240,12 +417,18 @@ void AssetLoader::processSection(struct aiMesh* assMesh, const struct aiScene* a
 	for (uint32_t i = 0; i < assMesh->mNumFaces; ++i)
 	{
 		const aiFace& face = assMesh->mFaces[i];
+		if (face.mNumIndices != 3)
+		{
+			continue;
+		}
+
 		for (uint32_t j = 0; j < face.mNumIndices; ++j)
 		{
-			indices.push_back(baseIndex + face.mIndices[j]);
+			indices.push_back(face.mIndices[j]);
 		}
 	}
 	section.indexCount = static_cast<uint32_t>(indices.size());
+	section.baseVertex = baseIndex;
 
 	// materials
 	std::shared_ptr<Material> material = std::make_shared<Material>();
@@ -283,7 +466,7 @@ void AssetLoader::processStaticVertices(struct aiMesh* assMesh, const struct aiS
 	}
 }
 
-void AssetLoader::processSkeletalVertices(struct aiMesh* assMesh, const struct aiScene* assScene, std::vector<SkeletalVertex>& skeletalVertices)
+void AssetLoader::processSkeletalVertices(struct aiMesh* assMesh, const struct aiScene* assScene, const Skeleton& skeleton, std::vector<SkeletalVertex>& skeletalVertices)
 {
 	// base vertice index
 	uint32_t baseVerticeIndex = static_cast<uint32_t>(skeletalVertices.size());
@@ -308,10 +491,16 @@ void AssetLoader::processSkeletalVertices(struct aiMesh* assMesh, const struct a
 
 	// ÿ㵱ǰѾõĹ
 	std::vector<uint32_t> vertexBoneNums(assMesh->mNumVertices, 0);
-	for (uint8_t i = 0; i < static_cast<uint8_t>(assMesh->mNumBones); ++i)
+	for (uint32_t i = 0; i < assMesh->mNumBones; ++i)
 	{
+		// the skeleton is shared by all meshes, so a mesh bone is looked up by name
 		aiBone* assBone = assMesh->mBones[i];
-		std::string name = assBone->mName.C_Str();
+		int boneIndex = skeleton.getBoneIndex(assBone->mName.C_Str());
+		if (boneIndex == INVALID_BONE)
+		{
+			continue;
+		}
+
 		for (uint32_t j = 0; j < assBone->mNumWeights; ++j)
 		{
 			aiVertexWeight& weight = assBone->mWeights[j];
@@ -320,7 +509,7 @@ void AssetLoader::processSkeletalVertices(struct aiMesh* assMesh, const struct a
 			uint32_t vertexIndex = baseVerticeIndex + weight.mVertexId;
 			if (vertexBoneIndex < BONE_NUM_PER_VERTEX)
 			{
-				skeletalVertices[vertexIndex].bones[vertexBoneIndex] = i;
+				skeletalVertices[vertexIndex].bones[vertexBoneIndex] = boneIndex;
 				skeletalVertices[vertexIndex].weights[vertexBoneIndex] = weight.mWeight;
 			}
 			else
@@ -3,10 +3,34 @@
 #include <string>
 #include <vector>
 #include <tuple>
+#include <future>
+#include <mutex>
+#include <map>
 #include <boost/format.hpp>
 
 #include "component/component.h"
 
+struct ModelAsset
+{
+	StaticMeshComponent staticMeshComp;
+	SkeletalMeshComponent skeletalMeshComp;
+	AnimatorComponent animatorComp;
+};
+
+struct TextureCacheStats
+{
+	uint32_t hits = 0;
+	uint32_t misses = 0;
+
+	// time spent in decoding or cooked texture loading, and the time the hits would have cost
+	float decodeTime = 0.0f;
+	float savedDecodeTime = 0.0f;
+
+	// bytes held by loaded textures (RGBA or compressed levels), and the bytes the hits would have duplicated
+	size_t decodedBytes = 0;
+	size_t savedBytes = 0;
+};
+
 class AssetLoader
 {
 public:
@@ -14,19 +38,39 @@ public:
 
 	std::vector<char> loadBinary(const std::string& filename);
 	void loadModel(const std::string& filename, StaticMeshComponent& staticMeshComp, SkeletalMeshComponent& skeletalMeshComp, AnimatorComponent& animatorComp);
+	std::future<ModelAsset> loadModelAsync(const std::string& filename);
 	std::shared_ptr<Texture> loadTexure(const std::string& filename);
 
+	TextureCacheStats getTextureCacheStats();
+	void purgeTextureCache();
+
 private:
+	struct TextureCacheEntry
+	{
+		std::mutex mutex;
+		std::weak_ptr<Texture> texture;
+		float decodeTime = 0.0f;
+	};
+
+	std::shared_ptr<Texture> decodeTexture(const std::string& filename);
+
 	std::string loadString(const std::string& filename);
+	void importModel(const std::string& filename, uint32_t importFlags, StaticMeshComponent& staticMeshComp, SkeletalMeshComponent& skeletalMeshComp, AnimatorComponent& animatorComp);
 
 	void processMeshNode(struct aiNode* assNode, const struct aiScene* assScene, const std::string& filename, 
 		StaticMeshComponent& staticMeshComp, SkeletalMeshComponent& skeletalMeshComp);
-	void processBoneNode(struct aiNode* assNode, std::shared_ptr<Skeleton>& skeleton);
-	void processSkeleton(struct aiMesh* assMesh, std::shared_ptr<Skeleton>& skeleton);
+	void processBoneNode(struct aiNode* assNode, const std::map<std::string, glm::mat4>& inverseBindPoses,
+		int parent, const glm::mat4& parentToNode, std::shared_ptr<Skeleton>& skeleton);
+	void processSkeleton(const struct aiScene* assScene, std::shared_ptr<Skeleton>& skeleton);
 	void processAnimation(const struct aiScene* assScene, const std::string& filename, AnimatorComponent& animatorComp);
 
 	void processSection(struct aiMesh* assMesh, const struct aiScene* assScene, const std::string& filename, 
 		uint32_t baseIndex, std::vector<uint32_t>& indices, std::vector<Section>& sections);
 	void processStaticVertices(struct aiMesh* assMesh, const struct aiScene* assScene, std::vector<StaticVertex>& staticVertices);
-	void processSkeletalVertices(struct aiMesh* assMesh, const struct aiScene* assScene, std::vector<SkeletalVertex>& skeletalVertices);
+	void processSkeletalVertices(struct aiMesh* assMesh, const struct aiScene* assScene, const Skeleton& skeleton, std::vector<SkeletalVertex>& skeletalVertices);
+
+	// textures are shared by normalized path for as long as someone holds a reference
+	std::map<std::string, std::shared_ptr<TextureCacheEntry>> m_textureCache;
+	TextureCacheStats m_textureCacheStats;
+	std::mutex m_textureCacheMutex;
 };
\ No newline at end of file
@@ -0,0 +1,393 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#define VERTEX_CACHE_SIZE 32
+#define INVALID_TRIANGLE UINT32_MAX
+
+namespace
+{
+	// Forsyth's vertex score, vertices near the front of the cache and vertices with few remaining triangles score higher
+	float scoreVertex(int32_t cachePosition, uint32_t liveTriangleCount)
+	{
+		if (liveTriangleCount == 0)
+		{
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// the triangle just emitted gets a fixed score so it is not favoured over its neighbours
+			if (cachePosition < 3)
+			{
+				score = 0.75f;
+			}
+			else
+			{
+				float scaler = 1.0f - static_cast<float>(cachePosition - 3) / (VERTEX_CACHE_SIZE - 3);
+				score = std::pow(scaler, 1.5f);
+			}
+		}
+
+		return score + 2.0f * std::pow(static_cast<float>(liveTriangleCount), -0.5f);
+	}
+
+	struct Cluster
+	{
+		size_t begin;
+		size_t end;
+		float sortKey;
+	};
+
+	// section i covers indices [getIndexBegin(i), sections[i].indexCount) and vertices [baseVertex, next baseVertex)
+	size_t getIndexBegin(const std::vector<Section>& sections, size_t i)
+	{
+		return i == 0 ? 0 : sections[i - 1].indexCount;
+	}
+
+	uint32_t getVertexEnd(const std::vector<Section>& sections, size_t i, size_t vertexCount)
+	{
+		return i + 1 < sections.size() ? sections[i + 1].baseVertex : static_cast<uint32_t>(vertexCount);
+	}
+}
+
+MeshOptimizationStats MeshOptimizer::optimize(StaticMeshComponent& staticMeshComp)
+{
+	return optimizeSections(staticMeshComp.mesh->vertices, staticMeshComp.mesh->indices, staticMeshComp.sections);
+}
+
+MeshOptimizationStats MeshOptimizer::optimize(SkeletalMeshComponent& skeletalMeshComp)
+{
+	return optimizeSections(skeletalMeshComp.mesh->vertices, skeletalMeshComp.mesh->indices, skeletalMeshComp.sections);
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, const std::vector<Section>& sections, uint32_t cacheSize)
+{
+	VertexCacheStats stats;
+	if (indices.empty())
+	{
+		return stats;
+	}
+
+	// cache entries are mesh level vertex indices, every section starts with a cold cache like a new draw does
+	std::vector<uint32_t> cache;
+	std::vector<bool> referenced;
+	uint32_t missCount = 0;
+	uint32_t referencedCount = 0;
+	for (size_t i = 0; i < sections.size(); ++i)
+	{
+		cache.clear();
+		for (size_t j = getIndexBegin(sections, i); j < sections[i].indexCount; ++j)
+		{
+			uint32_t vertex = sections[i].baseVertex + indices[j];
+			if (vertex >= referenced.size())
+			{
+				referenced.resize(vertex + 1, false);
+			}
+			if (!referenced[vertex])
+			{
+				referenced[vertex] = true;
+				referencedCount++;
+			}
+
+			if (std::find(cache.begin(), cache.end(), vertex) == cache.end())
+			{
+				missCount++;
+				cache.insert(cache.begin(), vertex);
+				if (cache.size() > cacheSize)
+				{
+					cache.pop_back();
+				}
+			}
+		}
+	}
+
+	stats.acmr = static_cast<float>(missCount) / (indices.size() / 3);
+	stats.atvr = referencedCount > 0 ? static_cast<float>(missCount) / referencedCount : 0.0f;
+	return stats;
+}
+
+template<typename VertexType>
+MeshOptimizationStats MeshOptimizer::optimizeSections(std::vector<VertexType>& vertices, std::vector<uint32_t>& indices, const std::vector<Section>& sections)
+{
+	MeshOptimizationStats stats;
+	stats.before = analyzeVertexCache(indices, sections);
+
+	for (size_t i = 0; i < sections.size(); ++i)
+	{
+		const Section& section = sections[i];
+		size_t indexBegin = getIndexBegin(sections, i);
+		size_t indexCount = section.indexCount - indexBegin;
+		uint32_t vertexCount = getVertexEnd(sections, i, vertices.size()) - section.baseVertex;
+		if (indexCount < 3 || indexCount % 3 != 0)
+		{
+			continue;
+		}
+
+		uint32_t* sectionIndices = indices.data() + indexBegin;
+		VertexType* sectionVertices = vertices.data() + section.baseVertex;
+
+		std::vector<glm::vec3> positions(vertexCount);
+		for (uint32_t j = 0; j < vertexCount; ++j)
+		{
+			positions[j] = sectionVertices[j].position;
+		}
+
+		optimizeVertexCache(sectionIndices, indexCount, vertexCount);
+		optimizeOverdraw(sectionIndices, indexCount, positions, 16);
+		optimizeVertexFetch(sectionIndices, indexCount, sectionVertices, vertexCount);
+	}
+
+	stats.after = analyzeVertexCache(indices, sections);
+	return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount)
+{
+	// a range that isn't a triangle list is left in its order, the emit loop would never reach indexCount
+	if (indexCount % 3 != 0)
+	{
+		return;
+	}
+
+	uint32_t triangleCount = static_cast<uint32_t>(indexCount / 3);
+
+	// triangles adjacent to each vertex, the live ones are kept at the front of each vertex's range
+	std::vector<uint32_t> liveTriangleCounts(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		liveTriangleCounts[indices[i]]++;
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangleCounts[i];
+	}
+
+	std::vector<uint32_t> adjacency(indexCount);
+	std::vector<uint32_t> fillCounts(vertexCount, 0);
+	for (uint32_t i = 0; i < triangleCount; ++i)
+	{
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t vertex = indices[i * 3 + k];
+			adjacency[adjacencyOffsets[vertex] + fillCounts[vertex]++] = i;
+		}
+	}
+
+	std::vector<int32_t> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		vertexScores[i] = scoreVertex(-1, liveTriangleCounts[i]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (uint32_t i = 0; i < triangleCount; ++i)
+	{
+		triangleScores[i] = vertexScores[indices[i * 3]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(indexCount);
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	uint32_t bestTriangle = static_cast<uint32_t>(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+	uint32_t scanCursor = 0;
+
+	while (result.size() < indexCount)
+	{
+		// dead end, restart from the next triangle in input order
+		if (bestTriangle == INVALID_TRIANGLE)
+		{
+			while (emitted[scanCursor])
+			{
+				scanCursor++;
+			}
+			bestTriangle = scanCursor;
+		}
+
+		emitted[bestTriangle] = true;
+		const uint32_t* triangle = indices + bestTriangle * 3;
+		newCache.assign(triangle, triangle + 3);
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t vertex = triangle[k];
+			result.push_back(vertex);
+
+			// move the emitted triangle out of the live part of the vertex's adjacency
+			uint32_t* begin = adjacency.data() + adjacencyOffsets[vertex];
+			uint32_t* end = begin + liveTriangleCounts[vertex];
+			uint32_t* found = std::find(begin, end, bestTriangle);
+			std::swap(*found, *(end - 1));
+			liveTriangleCounts[vertex]--;
+		}
+
+		for (uint32_t vertex : cache)
+		{
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+			{
+				newCache.push_back(vertex);
+			}
+		}
+
+		// evicted vertices lose their cache score
+		for (size_t i = VERTEX_CACHE_SIZE; i < newCache.size(); ++i)
+		{
+			cachePositions[newCache[i]] = -1;
+		}
+		for (size_t i = 0; i < newCache.size(); ++i)
+		{
+			uint32_t vertex = newCache[i];
+			if (i < VERTEX_CACHE_SIZE)
+			{
+				cachePositions[vertex] = static_cast<int32_t>(i);
+			}
+			vertexScores[vertex] = scoreVertex(cachePositions[vertex], liveTriangleCounts[vertex]);
+		}
+
+		// only triangles touching the cache changed their score, the best of them is emitted next
+		bestTriangle = INVALID_TRIANGLE;
+		float bestScore = -1.0f;
+		for (uint32_t vertex : newCache)
+		{
+			const uint32_t* liveTriangles = adjacency.data() + adjacencyOffsets[vertex];
+			for (uint32_t j = 0; j < liveTriangleCounts[vertex]; ++j)
+			{
+				uint32_t t = liveTriangles[j];
+				float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				triangleScores[t] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if (newCache.size() > VERTEX_CACHE_SIZE)
+		{
+			newCache.resize(VERTEX_CACHE_SIZE);
+		}
+		cache.swap(newCache);
+	}
+
+	std::copy(result.begin(), result.end(), indices);
+}
+
+void MeshOptimizer::optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<glm::vec3>& positions, uint32_t cacheSize)
+{
+	size_t triangleCount = indexCount / 3;
+
+	// a triangle missing on all three vertices starts a new cluster, so sorting clusters keeps most of the cache order
+	std::vector<Cluster> clusters;
+	std::vector<uint32_t> cache;
+	for (size_t i = 0; i < triangleCount; ++i)
+	{
+		uint32_t missCount = 0;
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t vertex = indices[i * 3 + k];
+			if (std::find(cache.begin(), cache.end(), vertex) == cache.end())
+			{
+				missCount++;
+				cache.insert(cache.begin(), vertex);
+				if (cache.size() > cacheSize)
+				{
+					cache.pop_back();
+				}
+			}
+		}
+
+		if (i == 0 || missCount == 3)
+		{
+			clusters.push_back({ i, i + 1, 0.0f });
+		}
+		else
+		{
+			clusters.back().end = i + 1;
+		}
+	}
+
+	if (clusters.size() < 2)
+	{
+		return;
+	}
+
+	glm::vec3 meshCentroid(0.0f);
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		meshCentroid += positions[indices[i]];
+	}
+	meshCentroid /= static_cast<float>(indexCount);
+
+	// clusters facing away from the mesh center are drawn first, they are the likely occluders
+	for (Cluster& cluster : clusters)
+	{
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (size_t i = cluster.begin; i < cluster.end; ++i)
+		{
+			const glm::vec3& p0 = positions[indices[i * 3]];
+			const glm::vec3& p1 = positions[indices[i * 3 + 1]];
+			const glm::vec3& p2 = positions[indices[i * 3 + 2]];
+			glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+			float triangleArea = glm::length(n);
+
+			centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += n;
+			area += triangleArea;
+		}
+
+		centroid = area > 0.0f ? centroid / area : positions[indices[cluster.begin * 3]];
+		float normalLength = glm::length(normal);
+		cluster.sortKey = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indexCount);
+	for (const Cluster& cluster : clusters)
+	{
+		result.insert(result.end(), indices + cluster.begin * 3, indices + cluster.end * 3);
+	}
+	std::copy(result.begin(), result.end(), indices);
+}
+
+template<typename VertexType>
+void MeshOptimizer::optimizeVertexFetch(uint32_t* indices, size_t indexCount, VertexType* vertices, uint32_t vertexCount)
+{
+	// vertices are renumbered in first use order, unreferenced ones keep their place behind the used ones
+	std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+	uint32_t nextVertex = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		uint32_t& target = remap[indices[i]];
+		if (target == UINT32_MAX)
+		{
+			target = nextVertex++;
+		}
+		indices[i] = target;
+	}
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		if (remap[i] == UINT32_MAX)
+		{
+			remap[i] = nextVertex++;
+		}
+	}
+
+	std::vector<VertexType> reordered(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		reordered[remap[i]] = vertices[i];
+	}
+	std::copy(reordered.begin(), reordered.end(), vertices);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "component/component.h"
+
+struct VertexCacheStats
+{
+	// average cache miss ratio per triangle and per referenced vertex, 0.5 and 1.0 are the ideal values
+	float acmr = 0.0f;
+	float atvr = 0.0f;
+};
+
+struct MeshOptimizationStats
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+/*
+ * Import time mesh optimization
+ * Triangles of each section are reordered for the post transform vertex cache (Forsyth's linear speed algorithm),
+ * then clusters of that order are sorted so outward facing geometry is drawn first to cut overdraw,
+ * and finally the section's vertices are reordered by first use for fetch locality.
+ * Section index ranges and vertex ranges stay where they are, so the result cooks like any imported mesh.
+ */
+class MeshOptimizer
+{
+public:
+	static MeshOptimizationStats optimize(StaticMeshComponent& staticMeshComp);
+	static MeshOptimizationStats optimize(SkeletalMeshComponent& skeletalMeshComp);
+
+	// FIFO cache simulation over all sections
+	static VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, const std::vector<Section>& sections, uint32_t cacheSize = 16);
+
+	// Forsyth reordering of a single triangle list, also used for the simplified levels of detail, other ranges are left as they are
+	static void optimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount);
+
+private:
+	template<typename VertexType>
+	static MeshOptimizationStats optimizeSections(std::vector<VertexType>& vertices, std::vector<uint32_t>& indices, const std::vector<Section>& sections);
+
+	static void optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<glm::vec3>& positions, uint32_t cacheSize);
+
+	template<typename VertexType>
+	static void optimizeVertexFetch(uint32_t* indices, size_t indexCount, VertexType* vertices, uint32_t vertexCount);
+};
@@ -0,0 +1,504 @@
+#include "mesh_simplifier.h"
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <numeric>
+
+#define MAX_LOD_NUM 4
+
+// the coarsest collapse allowed, relative to the bounding sphere radius
+#define MAX_SIMPLIFY_ERROR 0.05f
+
+// a level is only kept when it removes at least this share of the previous level's triangles
+#define MIN_LOD_REDUCTION 0.2f
+
+namespace
+{
+	// plane distance quadric, evaluates to the weighted sum of squared distances to the accumulated planes
+	struct Quadric
+	{
+		double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+		double b2 = 0.0, bc = 0.0, bd = 0.0;
+		double c2 = 0.0, cd = 0.0;
+		double d2 = 0.0;
+		double weight = 0.0;
+
+		void addPlane(const glm::dvec3& n, double d, double w)
+		{
+			a2 += n.x * n.x * w; ab += n.x * n.y * w; ac += n.x * n.z * w; ad += n.x * d * w;
+			b2 += n.y * n.y * w; bc += n.y * n.z * w; bd += n.y * d * w;
+			c2 += n.z * n.z * w; cd += n.z * d * w;
+			d2 += d * d * w;
+			weight += w;
+		}
+
+		Quadric& operator+=(const Quadric& other)
+		{
+			a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+			b2 += other.b2; bc += other.bc; bd += other.bd;
+			c2 += other.c2; cd += other.cd;
+			d2 += other.d2;
+			weight += other.weight;
+			return *this;
+		}
+
+		// weighted mean squared distance, so the result is in squared mesh units
+		double evaluate(const glm::vec3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double error = a2 * x * x + b2 * y * y + c2 * z * z +
+				2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z) + d2;
+			return weight > 0.0 ? std::abs(error) / weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		float cost;
+		uint32_t from;
+		uint32_t to;
+	};
+
+	// share of the skinning that differs between two vertices, 0 for identical influences and 1 for disjoint bones
+	float getSkinningDistance(const StaticVertex&, const StaticVertex&)
+	{
+		return 0.0f;
+	}
+
+	float getSkinningDistance(const SkeletalVertex& a, const SkeletalVertex& b)
+	{
+		float distance = 0.0f;
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			float weightB = 0.0f;
+			for (uint32_t j = 0; j < 4; ++j)
+			{
+				weightB += b.bones[j] == a.bones[i] ? b.weights[j] : 0.0f;
+			}
+			distance += std::abs(a.weights[i] - weightB);
+
+			bool shared = false;
+			for (uint32_t j = 0; j < 4; ++j)
+			{
+				shared |= a.bones[j] == b.bones[i];
+			}
+			distance += shared ? 0.0f : b.weights[i];
+		}
+		return distance * 0.5f;
+	}
+
+	float getAttributeDistance(const StaticVertex& a, const StaticVertex& b)
+	{
+		glm::vec2 texCoord = a.texCoord - b.texCoord;
+		glm::vec3 normal = a.normal - b.normal;
+		return glm::dot(texCoord, texCoord) + glm::dot(normal, normal);
+	}
+
+	/*
+	 * Edge collapse state of a single section
+	 * Wedges are the section's vertices, wedges sharing a position form one collapsible vertex named after its first wedge.
+	 * Collapses run in passes: all edges are ranked by cost, then the cheapest ones that touch disjoint neighbourhoods are applied.
+	 */
+	template<typename VertexType>
+	class SectionSimplifier
+	{
+	public:
+		SectionSimplifier(const VertexType* vertices, uint32_t vertexCount, const uint32_t* indices, size_t indexCount, float radius) :
+			m_vertices(vertices), m_vertexCount(vertexCount), m_triangles(indices, indices + indexCount)
+		{
+			m_skinningScale = (0.1f * radius) * (0.1f * radius);
+			m_attributeScale = (0.02f * radius) * (0.02f * radius);
+
+			weldPositions();
+			computeQuadrics();
+			compactTriangles();
+		}
+
+		// collapses edges until at most targetTriangleCount triangles remain or the next collapse would exceed maxError
+		void simplify(size_t targetTriangleCount, float maxError)
+		{
+			while (m_triangles.size() / 3 > targetTriangleCount)
+			{
+				if (!collapsePass(targetTriangleCount, maxError * maxError))
+				{
+					break;
+				}
+				compactTriangles();
+			}
+		}
+
+		const std::vector<uint32_t>& getIndices() const { return m_triangles; }
+		float getError() const { return std::sqrt(m_maxCost); }
+
+	private:
+		void weldPositions()
+		{
+			std::vector<uint32_t> order(m_vertexCount);
+			std::iota(order.begin(), order.end(), 0);
+			auto less = [this](uint32_t a, uint32_t b) {
+				const glm::vec3& pa = m_vertices[a].position;
+				const glm::vec3& pb = m_vertices[b].position;
+				return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : (pa.z != pb.z ? pa.z < pb.z : a < b));
+			};
+			std::sort(order.begin(), order.end(), less);
+
+			m_positionIds.resize(m_vertexCount);
+			for (size_t i = 0; i < order.size(); ++i)
+			{
+				bool same = i > 0 && m_vertices[order[i]].position == m_vertices[order[i - 1]].position;
+				m_positionIds[order[i]] = same ? m_positionIds[order[i - 1]] : order[i];
+			}
+
+			// wedges grouped by position, in CSR form
+			m_wedgeOffsets.assign(m_vertexCount + 1, 0);
+			for (uint32_t i = 0; i < m_vertexCount; ++i)
+			{
+				m_wedgeOffsets[m_positionIds[i] + 1]++;
+			}
+			std::partial_sum(m_wedgeOffsets.begin(), m_wedgeOffsets.end(), m_wedgeOffsets.begin());
+			m_wedges.resize(m_vertexCount);
+			std::vector<uint32_t> fillCounts(m_vertexCount, 0);
+			for (uint32_t i = 0; i < m_vertexCount; ++i)
+			{
+				uint32_t positionId = m_positionIds[i];
+				m_wedges[m_wedgeOffsets[positionId] + fillCounts[positionId]++] = i;
+			}
+
+			m_wedgeRemap.resize(m_vertexCount);
+			std::iota(m_wedgeRemap.begin(), m_wedgeRemap.end(), 0);
+		}
+
+		void computeQuadrics()
+		{
+			m_quadrics.assign(m_vertexCount, Quadric());
+
+			std::vector<uint64_t> edges;
+			for (size_t i = 0; i < m_triangles.size(); i += 3)
+			{
+				uint32_t p[3] = { m_positionIds[m_triangles[i]], m_positionIds[m_triangles[i + 1]], m_positionIds[m_triangles[i + 2]] };
+				glm::dvec3 p0 = getPosition(p[0]), p1 = getPosition(p[1]), p2 = getPosition(p[2]);
+				glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+				double area = glm::length(normal);
+				if (area == 0.0)
+				{
+					continue;
+				}
+				normal /= area;
+
+				Quadric quadric;
+				quadric.addPlane(normal, -glm::dot(normal, p0), area * 0.5);
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					m_quadrics[p[k]] += quadric;
+					edges.push_back(static_cast<uint64_t>(std::min(p[k], p[(k + 1) % 3])) << 32 | std::max(p[k], p[(k + 1) % 3]));
+				}
+			}
+
+			// open borders get a plane perpendicular to their face, so the outline keeps its shape
+			std::sort(edges.begin(), edges.end());
+			for (size_t i = 0; i < m_triangles.size(); i += 3)
+			{
+				uint32_t p[3] = { m_positionIds[m_triangles[i]], m_positionIds[m_triangles[i + 1]], m_positionIds[m_triangles[i + 2]] };
+				glm::dvec3 p0 = getPosition(p[0]), p1 = getPosition(p[1]), p2 = getPosition(p[2]);
+				glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+				if (glm::length(normal) == 0.0)
+				{
+					continue;
+				}
+
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					uint32_t a = p[k], b = p[(k + 1) % 3];
+					uint64_t edge = static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b);
+					auto range = std::equal_range(edges.begin(), edges.end(), edge);
+					if (range.second - range.first != 1)
+					{
+						continue;
+					}
+
+					glm::dvec3 edgeVector = getPosition(b) - getPosition(a);
+					glm::dvec3 borderNormal = glm::cross(edgeVector, normal);
+					double length = glm::length(borderNormal);
+					if (length == 0.0)
+					{
+						continue;
+					}
+					borderNormal /= length;
+
+					Quadric quadric;
+					quadric.addPlane(borderNormal, -glm::dot(borderNormal, getPosition(a)), glm::dot(edgeVector, edgeVector) * 10.0);
+					m_quadrics[a] += quadric;
+					m_quadrics[b] += quadric;
+				}
+			}
+		}
+
+		bool collapsePass(size_t targetTriangleCount, float maxCost)
+		{
+			// unique position edges of the current triangles, each ranked by its cheaper direction
+			std::vector<uint64_t> edges;
+			edges.reserve(m_triangles.size());
+			for (size_t i = 0; i < m_triangles.size(); i += 3)
+			{
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					uint32_t a = m_positionIds[m_triangles[i + k]];
+					uint32_t b = m_positionIds[m_triangles[i + (k + 1) % 3]];
+					edges.push_back(static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b));
+				}
+			}
+			std::sort(edges.begin(), edges.end());
+			edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+			std::vector<Collapse> collapses;
+			collapses.reserve(edges.size());
+			for (uint64_t edge : edges)
+			{
+				uint32_t a = static_cast<uint32_t>(edge >> 32);
+				uint32_t b = static_cast<uint32_t>(edge & UINT32_MAX);
+				float costAB = getCollapseCost(a, b);
+				float costBA = getCollapseCost(b, a);
+				collapses.push_back(costAB <= costBA ? Collapse{ costAB, a, b } : Collapse{ costBA, b, a });
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			// triangles around each position
+			std::vector<uint32_t> adjacencyOffsets(m_vertexCount + 1, 0);
+			for (uint32_t index : m_triangles)
+			{
+				adjacencyOffsets[m_positionIds[index] + 1]++;
+			}
+			std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+			std::vector<uint32_t> adjacency(m_triangles.size());
+			std::vector<uint32_t> fillCounts(m_vertexCount, 0);
+			for (size_t i = 0; i < m_triangles.size(); ++i)
+			{
+				uint32_t positionId = m_positionIds[m_triangles[i]];
+				adjacency[adjacencyOffsets[positionId] + fillCounts[positionId]++] = static_cast<uint32_t>(i / 3);
+			}
+
+			size_t triangleCount = m_triangles.size() / 3;
+			std::vector<bool> touched(m_vertexCount, false);
+			bool collapsed = false;
+			for (const Collapse& collapse : collapses)
+			{
+				if (triangleCount <= targetTriangleCount || collapse.cost > maxCost)
+				{
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to])
+				{
+					continue;
+				}
+
+				const uint32_t* triangles = adjacency.data() + adjacencyOffsets[collapse.from];
+				uint32_t adjacentCount = adjacencyOffsets[collapse.from + 1] - adjacencyOffsets[collapse.from];
+				if (flipsTriangle(triangles, adjacentCount, collapse.from, collapse.to))
+				{
+					continue;
+				}
+
+				// every position around the collapsed one sees a changed triangle and waits for the next pass
+				for (uint32_t i = 0; i < adjacentCount; ++i)
+				{
+					uint32_t removed = 0;
+					for (uint32_t k = 0; k < 3; ++k)
+					{
+						uint32_t positionId = m_positionIds[m_triangles[triangles[i] * 3 + k]];
+						touched[positionId] = true;
+						removed |= positionId == collapse.to ? 1 : 0;
+					}
+					triangleCount -= removed;
+				}
+
+				applyCollapse(collapse.from, collapse.to);
+				m_maxCost = std::max(m_maxCost, collapse.cost);
+				collapsed = true;
+			}
+
+			return collapsed;
+		}
+
+		float getCollapseCost(uint32_t from, uint32_t to)
+		{
+			Quadric quadric = m_quadrics[from];
+			quadric += m_quadrics[to];
+			float cost = static_cast<float>(quadric.evaluate(m_vertices[to].position));
+
+			float skinningDistance = getSkinningDistance(m_vertices[from], m_vertices[to]);
+			cost += skinningDistance * skinningDistance * m_skinningScale;
+
+			// each wedge of the collapsed position takes the attributes of the closest wedge it lands on
+			float attributeDistance = 0.0f;
+			for (uint32_t i = m_wedgeOffsets[from]; i < m_wedgeOffsets[from + 1]; ++i)
+			{
+				attributeDistance = std::max(attributeDistance, getAttributeDistance(m_vertices[m_wedges[i]], m_vertices[findClosestWedge(m_wedges[i], to)]));
+			}
+			return cost + attributeDistance * m_attributeScale;
+		}
+
+		uint32_t findClosestWedge(uint32_t wedge, uint32_t positionId)
+		{
+			uint32_t closest = m_wedges[m_wedgeOffsets[positionId]];
+			float closestDistance = getAttributeDistance(m_vertices[wedge], m_vertices[closest]);
+			for (uint32_t i = m_wedgeOffsets[positionId] + 1; i < m_wedgeOffsets[positionId + 1]; ++i)
+			{
+				float distance = getAttributeDistance(m_vertices[wedge], m_vertices[m_wedges[i]]);
+				if (distance < closestDistance)
+				{
+					closestDistance = distance;
+					closest = m_wedges[i];
+				}
+			}
+			return closest;
+		}
+
+		bool flipsTriangle(const uint32_t* triangles, uint32_t triangleCount, uint32_t from, uint32_t to)
+		{
+			for (uint32_t i = 0; i < triangleCount; ++i)
+			{
+				const uint32_t* triangle = m_triangles.data() + triangles[i] * 3;
+				uint32_t p[3] = { m_positionIds[triangle[0]], m_positionIds[triangle[1]], m_positionIds[triangle[2]] };
+				if (p[0] == to || p[1] == to || p[2] == to)
+				{
+					continue;
+				}
+
+				glm::dvec3 before[3], after[3];
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					before[k] = getPosition(p[k]);
+					after[k] = getPosition(p[k] == from ? to : p[k]);
+				}
+
+				glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				if (glm::dot(normalBefore, normalAfter) <= 0.0)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void applyCollapse(uint32_t from, uint32_t to)
+		{
+			m_quadrics[to] += m_quadrics[from];
+			for (uint32_t i = m_wedgeOffsets[from]; i < m_wedgeOffsets[from + 1]; ++i)
+			{
+				m_wedgeRemap[m_wedges[i]] = findClosestWedge(m_wedges[i], to);
+			}
+		}
+
+		// applies the collapses to the triangle list and drops the triangles that lost an edge
+		void compactTriangles()
+		{
+			size_t writeIndex = 0;
+			for (size_t i = 0; i < m_triangles.size(); i += 3)
+			{
+				uint32_t triangle[3];
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					uint32_t wedge = m_triangles[i + k];
+					while (m_wedgeRemap[wedge] != wedge)
+					{
+						wedge = m_wedgeRemap[wedge];
+					}
+					triangle[k] = wedge;
+				}
+
+				uint32_t p0 = m_positionIds[triangle[0]], p1 = m_positionIds[triangle[1]], p2 = m_positionIds[triangle[2]];
+				if (p0 == p1 || p1 == p2 || p2 == p0)
+				{
+					continue;
+				}
+
+				std::copy(triangle, triangle + 3, m_triangles.begin() + writeIndex);
+				writeIndex += 3;
+			}
+			m_triangles.resize(writeIndex);
+		}
+
+		glm::dvec3 getPosition(uint32_t positionId) const
+		{
+			return glm::dvec3(m_vertices[positionId].position);
+		}
+
+		const VertexType* m_vertices;
+		uint32_t m_vertexCount;
+		std::vector<uint32_t> m_triangles;
+
+		std::vector<uint32_t> m_positionIds;
+		std::vector<uint32_t> m_wedgeOffsets;
+		std::vector<uint32_t> m_wedges;
+		std::vector<uint32_t> m_wedgeRemap;
+		std::vector<Quadric> m_quadrics;
+
+		float m_skinningScale;
+		float m_attributeScale;
+		float m_maxCost = 0.0f;
+	};
+}
+
+void MeshSimplifier::generateLods(StaticMeshComponent& staticMeshComp)
+{
+	generateLods(staticMeshComp.mesh->vertices, staticMeshComp.mesh->indices, staticMeshComp.sections, staticMeshComp.bounds, staticMeshComp.lods);
+}
+
+void MeshSimplifier::generateLods(SkeletalMeshComponent& skeletalMeshComp)
+{
+	generateLods(skeletalMeshComp.mesh->vertices, skeletalMeshComp.mesh->indices, skeletalMeshComp.sections, skeletalMeshComp.bounds, skeletalMeshComp.lods);
+}
+
+template<typename VertexType>
+void MeshSimplifier::generateLods(const std::vector<VertexType>& vertices, std::vector<uint32_t>& indices,
+	const std::vector<Section>& sections, const BoundingSphere& bounds, std::vector<MeshLod>& lods)
+{
+	lods.clear();
+	if (sections.empty() || bounds.radius <= 0.0f)
+	{
+		return;
+	}
+
+	std::vector<SectionSimplifier<VertexType>> simplifiers;
+	std::vector<uint32_t> vertexCounts;
+	for (size_t i = 0; i < sections.size(); ++i)
+	{
+		uint32_t indexBegin = i == 0 ? 0 : sections[i - 1].indexCount;
+		uint32_t vertexEnd = i + 1 < sections.size() ? sections[i + 1].baseVertex : static_cast<uint32_t>(vertices.size());
+		vertexCounts.push_back(vertexEnd - sections[i].baseVertex);
+		simplifiers.emplace_back(vertices.data() + sections[i].baseVertex, vertexCounts.back(),
+			indices.data() + indexBegin, sections[i].indexCount - indexBegin, bounds.radius);
+	}
+
+	// each level continues from the previous one, so the error only grows with the level
+	uint32_t previousIndexCount = sections.back().indexCount;
+	for (uint32_t level = 1; level <= MAX_LOD_NUM; ++level)
+	{
+		MeshLod lod;
+		std::vector<uint32_t> lodIndices;
+		float error = 0.0f;
+		for (size_t i = 0; i < sections.size(); ++i)
+		{
+			uint32_t indexBegin = i == 0 ? 0 : sections[i - 1].indexCount;
+			size_t targetTriangleCount = std::max<size_t>((sections[i].indexCount - indexBegin) / 3 >> level, 1);
+			simplifiers[i].simplify(targetTriangleCount, MAX_SIMPLIFY_ERROR * bounds.radius);
+
+			std::vector<uint32_t> sectionIndices = simplifiers[i].getIndices();
+			MeshOptimizer::optimizeVertexCache(sectionIndices.data(), sectionIndices.size(), vertexCounts[i]);
+			lodIndices.insert(lodIndices.end(), sectionIndices.begin(), sectionIndices.end());
+			lod.indexCounts.push_back(static_cast<uint32_t>(indices.size() + lodIndices.size()));
+			error = std::max(error, simplifiers[i].getError());
+		}
+
+		if (static_cast<float>(lodIndices.size()) > previousIndexCount * (1.0f - MIN_LOD_REDUCTION))
+		{
+			break;
+		}
+
+		lod.error = error / bounds.radius;
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+		lods.push_back(lod);
+		previousIndexCount = static_cast<uint32_t>(lodIndices.size());
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "component/component.h"
+
+/*
+ * Import time level of detail generation
+ * Every section is simplified by quadric error edge collapse on its own vertices, each level roughly halves the triangle count
+ * of the previous one. Vertices are never moved or added, so all levels share the vertex buffer and only append indices
+ * behind the full detail sections. Vertices with the same position are welded first, so attribute seams collapse
+ * together, and a collapse between vertices with different bone weights is penalized so joints keep their skinning.
+ */
+class MeshSimplifier
+{
+public:
+	static void generateLods(StaticMeshComponent& staticMeshComp);
+	static void generateLods(SkeletalMeshComponent& skeletalMeshComp);
+
+private:
+	template<typename VertexType>
+	static void generateLods(const std::vector<VertexType>& vertices, std::vector<uint32_t>& indices,
+		const std::vector<Section>& sections, const BoundingSphere& bounds, std::vector<MeshLod>& lods);
+};
@@ -0,0 +1,107 @@
+#include "meshlet_builder.h"
+
+#include <algorithm>
+
+void MeshletBuilder::build(StaticMeshComponent& staticMeshComp)
+{
+	build(staticMeshComp.mesh->vertices, staticMeshComp.mesh->indices, staticMeshComp.sections, staticMeshComp.meshlets);
+}
+
+template<typename VertexType>
+void MeshletBuilder::build(const std::vector<VertexType>& vertices, const std::vector<uint32_t>& indices,
+	std::vector<Section>& sections, std::vector<Meshlet>& meshlets)
+{
+	meshlets.clear();
+
+	// the meshlet each vertex was last counted for, so unique vertices are counted without a set
+	std::vector<uint32_t> vertexMeshlets(vertices.size(), UINT32_MAX);
+	for (size_t i = 0; i < sections.size(); ++i)
+	{
+		Section& section = sections[i];
+		const VertexType* sectionVertices = vertices.data() + section.baseVertex;
+		uint32_t indexBegin = i == 0 ? 0 : sections[i - 1].indexCount;
+
+		uint32_t firstIndex = indexBegin;
+		uint32_t vertexCount = 0;
+		for (uint32_t j = indexBegin; j + 2 < section.indexCount; j += 3)
+		{
+			uint32_t meshletId = static_cast<uint32_t>(meshlets.size());
+			uint32_t newVertexCount = 0;
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				newVertexCount += vertexMeshlets[section.baseVertex + indices[j + k]] != meshletId ? 1 : 0;
+			}
+
+			// the triangle would overflow the current meshlet, close it and count again for the next one
+			if (vertexCount + newVertexCount > MAX_MESHLET_VERTEX_NUM || (j - firstIndex) / 3 == MAX_MESHLET_TRIANGLE_NUM)
+			{
+				meshlets.push_back(createMeshlet(sectionVertices, indices, firstIndex, j - firstIndex));
+				firstIndex = j;
+				vertexCount = 0;
+				meshletId++;
+			}
+
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				uint32_t& vertexMeshlet = vertexMeshlets[section.baseVertex + indices[j + k]];
+				vertexCount += vertexMeshlet != meshletId ? 1 : 0;
+				vertexMeshlet = meshletId;
+			}
+		}
+
+		if (section.indexCount > firstIndex)
+		{
+			meshlets.push_back(createMeshlet(sectionVertices, indices, firstIndex, section.indexCount - firstIndex));
+		}
+		section.meshletCount = static_cast<uint32_t>(meshlets.size());
+	}
+}
+
+template<typename VertexType>
+Meshlet MeshletBuilder::createMeshlet(const VertexType* vertices, const std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount)
+{
+	Meshlet meshlet;
+	meshlet.firstIndex = firstIndex;
+	meshlet.indexCount = indexCount;
+
+	std::vector<VertexType> meshletVertices;
+	for (uint32_t i = firstIndex; i < firstIndex + indexCount; ++i)
+	{
+		meshletVertices.push_back(vertices[indices[i]]);
+	}
+	meshlet.bounds = computeBoundingSphere(meshletVertices);
+
+	// the cone axis is the average facing, its cutoff is how far the most divergent triangle leans away from it
+	std::vector<glm::vec3> normals;
+	glm::vec3 axis(0.0f);
+	for (uint32_t i = firstIndex; i + 2 < firstIndex + indexCount; i += 3)
+	{
+		const glm::vec3& p0 = vertices[indices[i]].position;
+		const glm::vec3& p1 = vertices[indices[i + 1]].position;
+		const glm::vec3& p2 = vertices[indices[i + 2]].position;
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float area = glm::length(normal);
+		if (area > 0.0f)
+		{
+			normals.push_back(normal / area);
+			axis += normal;
+		}
+	}
+
+	float axisLength = glm::length(axis);
+	meshlet.coneAxis = axisLength > 0.0f ? axis / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = 1.0f;
+
+	float minDot = 1.0f;
+	for (const glm::vec3& normal : normals)
+	{
+		minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+	}
+
+	// a cone wider than a hemisphere never culls, a cutoff of one keeps the test false
+	if (axisLength > 0.0f && minDot > 0.0f)
+	{
+		meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+	return meshlet;
+}
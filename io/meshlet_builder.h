@@ -0,0 +1,27 @@
+#pragma once
+
+#include "component/component.h"
+
+#define MAX_MESHLET_VERTEX_NUM 64
+#define MAX_MESHLET_TRIANGLE_NUM 124
+
+/*
+ * Import time meshlet build
+ * The full detail triangles of each section are cut into clusters of at most 64 vertices and 124 triangles in their
+ * vertex cache order, so every meshlet stays a contiguous index range that can be drawn with a plain indexed draw.
+ * Each meshlet gets a bounding sphere for frustum culling and a normal cone for back face culling.
+ * Only static meshes are clustered, skinned meshlets would need bounds for every pose.
+ */
+class MeshletBuilder
+{
+public:
+	static void build(StaticMeshComponent& staticMeshComp);
+
+private:
+	template<typename VertexType>
+	static void build(const std::vector<VertexType>& vertices, const std::vector<uint32_t>& indices,
+		std::vector<Section>& sections, std::vector<Meshlet>& meshlets);
+
+	template<typename VertexType>
+	static Meshlet createMeshlet(const VertexType* vertices, const std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount);
+};
@@ -0,0 +1,241 @@
+#include "mipmap_generator.h"
+#include "utility/thread_pool.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPMAP_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+#define KAISER_TAP_NUM 8
+#define KAISER_WIDTH 2.0f
+#define KAISER_ALPHA 4.0f
+
+namespace
+{
+	const float PI = 3.14159265358979f;
+
+	// dst = sum of weights[k] * taps[k] over RGBA float pixels
+	inline void filterPixel(float* dst, const float* const* taps, const float* weights, uint32_t tapNum)
+	{
+#ifdef MIPMAP_GENERATOR_SSE2
+		__m128 sum = _mm_setzero_ps();
+		for (uint32_t k = 0; k < tapNum; ++k)
+		{
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(taps[k]), _mm_set1_ps(weights[k])));
+		}
+		sum = _mm_min_ps(_mm_max_ps(sum, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		_mm_storeu_ps(dst, sum);
+#else
+		float sum[4] = {};
+		for (uint32_t k = 0; k < tapNum; ++k)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				sum[c] += taps[k][c] * weights[k];
+			}
+		}
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			dst[c] = std::clamp(sum[c], 0.0f, 1.0f);
+		}
+#endif
+	}
+
+	float besselI0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		for (uint32_t k = 1; k < 20; ++k)
+		{
+			float factor = x / (2.0f * k);
+			term *= factor * factor;
+			sum += term;
+		}
+		return sum;
+	}
+
+	// windowed sinc, t is measured in destination pixels
+	float kaiser(float t)
+	{
+		float r = t / KAISER_WIDTH;
+		if (std::fabs(r) >= 1.0f)
+		{
+			return 0.0f;
+		}
+
+		float sinc = t == 0.0f ? 1.0f : std::sin(PI * t) / (PI * t);
+		return sinc * besselI0(KAISER_ALPHA * std::sqrt(1.0f - r * r)) / besselI0(KAISER_ALPHA);
+	}
+
+	struct KaiserKernel
+	{
+		float weights[KAISER_TAP_NUM];
+
+		KaiserKernel()
+		{
+			// destination pixel x is centered between source pixels 2x and 2x+1, tap k reads source pixel 2x-3+k
+			float sum = 0.0f;
+			for (uint32_t k = 0; k < KAISER_TAP_NUM; ++k)
+			{
+				weights[k] = kaiser((static_cast<float>(k) - 3.5f) / 2.0f);
+				sum += weights[k];
+			}
+			for (uint32_t k = 0; k < KAISER_TAP_NUM; ++k)
+			{
+				weights[k] /= sum;
+			}
+		}
+	};
+
+	const KaiserKernel& getKaiserKernel()
+	{
+		static KaiserKernel kernel;
+		return kernel;
+	}
+
+	struct SrgbTable
+	{
+		float toLinear[256];
+
+		SrgbTable()
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				float s = i / 255.0f;
+				toLinear[i] = s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+			}
+		}
+	};
+
+	const SrgbTable& getSrgbTable()
+	{
+		static SrgbTable table;
+		return table;
+	}
+
+	uint8_t linearToSrgb(float v)
+	{
+		float s = v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+		return static_cast<uint8_t>(std::clamp(s, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	uint8_t unitToByte(float v)
+	{
+		return static_cast<uint8_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	uint32_t wrap(int32_t i, uint32_t size)
+	{
+		int32_t n = static_cast<int32_t>(size);
+		return static_cast<uint32_t>(((i % n) + n) % n);
+	}
+
+	void downsampleBox(const std::vector<float>& src, uint32_t width, uint32_t height, std::vector<float>& dst, uint32_t dstWidth, uint32_t dstHeight)
+	{
+		const float weights[4] = { 0.25f, 0.25f, 0.25f, 0.25f };
+		ThreadPool::getInstance().parallelFor(dstHeight, [&](uint32_t y) {
+			// odd edges reuse the last row/column
+			uint32_t y0 = std::min(y * 2, height - 1);
+			uint32_t y1 = std::min(y * 2 + 1, height - 1);
+			for (uint32_t x = 0; x < dstWidth; ++x)
+			{
+				uint32_t x0 = std::min(x * 2, width - 1);
+				uint32_t x1 = std::min(x * 2 + 1, width - 1);
+				const float* taps[4] = {
+					&src[(static_cast<size_t>(y0) * width + x0) * 4], &src[(static_cast<size_t>(y0) * width + x1) * 4],
+					&src[(static_cast<size_t>(y1) * width + x0) * 4], &src[(static_cast<size_t>(y1) * width + x1) * 4]
+				};
+				filterPixel(&dst[(static_cast<size_t>(y) * dstWidth + x) * 4], taps, weights, 4);
+			}
+		});
+	}
+
+	void downsampleKaiser(const std::vector<float>& src, uint32_t width, uint32_t height, std::vector<float>& dst, uint32_t dstWidth, uint32_t dstHeight)
+	{
+		const float* weights = getKaiserKernel().weights;
+
+		// horizontal pass, an axis that is already 1 pixel wide is passed through
+		std::vector<float> temp;
+		const std::vector<float>* rows = &src;
+		if (width > 1)
+		{
+			temp.resize(static_cast<size_t>(dstWidth) * height * 4);
+			ThreadPool::getInstance().parallelFor(height, [&](uint32_t y) {
+				const float* row = &src[static_cast<size_t>(y) * width * 4];
+				for (uint32_t x = 0; x < dstWidth; ++x)
+				{
+					const float* taps[KAISER_TAP_NUM];
+					for (uint32_t k = 0; k < KAISER_TAP_NUM; ++k)
+					{
+						taps[k] = &row[wrap(static_cast<int32_t>(x * 2 + k) - 3, width) * 4];
+					}
+					filterPixel(&temp[(static_cast<size_t>(y) * dstWidth + x) * 4], taps, weights, KAISER_TAP_NUM);
+				}
+			});
+			rows = &temp;
+		}
+
+		if (height == 1)
+		{
+			dst = *rows;
+			return;
+		}
+
+		// vertical pass
+		ThreadPool::getInstance().parallelFor(dstHeight, [&](uint32_t y) {
+			const float* taps[KAISER_TAP_NUM];
+			for (uint32_t x = 0; x < dstWidth; ++x)
+			{
+				for (uint32_t k = 0; k < KAISER_TAP_NUM; ++k)
+				{
+					taps[k] = &(*rows)[(static_cast<size_t>(wrap(static_cast<int32_t>(y * 2 + k) - 3, height)) * dstWidth + x) * 4];
+				}
+				filterPixel(&dst[(static_cast<size_t>(y) * dstWidth + x) * 4], taps, weights, KAISER_TAP_NUM);
+			}
+		});
+	}
+}
+
+void MipmapGenerator::generate(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb, EMipmapFilter filter, std::vector<MipmapLevel>& levels)
+{
+	size_t pixelCount = static_cast<size_t>(width) * height;
+	levels.clear();
+	levels.push_back({ width, height, std::vector<uint8_t>(rgba, rgba + pixelCount * 4) });
+
+	// the chain is carried in float so rounding errors do not accumulate from level to level
+	const SrgbTable& srgbTable = getSrgbTable();
+	std::vector<float> current(pixelCount * 4);
+	for (size_t i = 0; i < pixelCount * 4; ++i)
+	{
+		current[i] = srgb && (i & 3) != 3 ? srgbTable.toLinear[rgba[i]] : rgba[i] / 255.0f;
+	}
+
+	while (width > 1 || height > 1)
+	{
+		uint32_t nextWidth = std::max(width / 2, 1u);
+		uint32_t nextHeight = std::max(height / 2, 1u);
+		std::vector<float> next(static_cast<size_t>(nextWidth) * nextHeight * 4);
+		if (filter == EMipmapFilter::Kaiser)
+		{
+			downsampleKaiser(current, width, height, next, nextWidth, nextHeight);
+		}
+		else
+		{
+			downsampleBox(current, width, height, next, nextWidth, nextHeight);
+		}
+
+		MipmapLevel level{ nextWidth, nextHeight, std::vector<uint8_t>(next.size()) };
+		for (size_t i = 0; i < next.size(); ++i)
+		{
+			level.pixels[i] = srgb && (i & 3) != 3 ? linearToSrgb(next[i]) : unitToByte(next[i]);
+		}
+		levels.push_back(std::move(level));
+
+		current.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum class EMipmapFilter
+{
+	Box, Kaiser
+};
+
+struct MipmapLevel
+{
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint8_t> pixels;
+};
+
+/*
+ * CPU mip chain generator
+ * Every level is filtered from the float result of the previous one, in linear space for sRGB textures
+ * so averaging happens on light rather than on gamma encoded values. Alpha is always filtered linearly.
+ * Box is a plain 2x2 average, Kaiser is a separable 8 tap windowed sinc with wrapped edges that keeps
+ * smaller levels sharper. Pixels are processed as 4 wide float vectors with SSE2 when available.
+ */
+class MipmapGenerator
+{
+public:
+	// levels[0] is a copy of the source, each following level halves both sides down to 1x1
+	static void generate(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb, EMipmapFilter filter, std::vector<MipmapLevel>& levels);
+};
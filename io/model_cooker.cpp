@@ -0,0 +1,603 @@
+#include "model_cooker.h"
+#include "asset_loader.h"
+#include "animation_compressor.h"
+#include "utility/utility.h"
+#include "utility/mapped_file.h"
+
+#include <fstream>
+#include <set>
+#include <type_traits>
+#include <boost/filesystem.hpp>
+
+#define COOKED_MAGIC 0x4B4F4F43 // "COOK"
+#define COOKED_VERSION 9
+#define COOKED_ALIGNMENT 16
+
+enum class ECookedChunk : uint32_t
+{
+	Strings, StaticVertices, SkeletalVertices, Indices, Sections, Bones,
+	Animations, Channels, PositionTimes, Positions, RotationTimes, Rotations, ScaleTimes, Scales, ShortIndices,
+	Lods, LodIndexCounts, Bounds, Meshlets
+};
+
+struct CookedHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;
+	uint32_t importFlags;
+	uint32_t chunkCount;
+
+	// the clips are compressed and resampled with these settings
+	float animationError;
+	float animationSampleRate;
+};
+
+struct CookedChunk
+{
+	ECookedChunk type;
+	uint32_t count;
+	uint64_t offset;
+	uint64_t size;
+};
+
+// string table reference
+struct CookedString
+{
+	uint32_t offset;
+	uint32_t length;
+};
+
+struct CookedSection
+{
+	uint32_t indexCount;
+	uint32_t baseVertex;
+	uint32_t meshletCount;
+	CookedString baseTex;
+};
+
+// one entry of LodIndexCounts per section
+struct CookedLod
+{
+	float error;
+	uint32_t firstIndexCount;
+};
+
+struct CookedBone
+{
+	CookedString name;
+	int32_t parent;
+	glm::mat4 globalInverseBindPoseMatrix;
+	glm::mat4 localBindPoseMatrix;
+};
+
+struct CookedAnimation
+{
+	CookedString name;
+	float duration;
+	float frameRate;
+	uint32_t frameCount;
+	uint32_t firstChannel, channelCount;
+	uint32_t firstPositionKey, positionKeyCount;
+	uint32_t firstRotationKey, rotationKeyCount;
+	uint32_t firstScaleKey, scaleKeyCount;
+
+	// uniform clips have no key times, keyed clips have one per key
+	uint32_t firstPositionTime, firstRotationTime, firstScaleTime;
+};
+
+// track keys are relative to the key runs of the animation
+struct CookedChannel
+{
+	CookedString name;
+	AnimationChannel channel;
+};
+
+class CookedWriter
+{
+public:
+	CookedString addString(const std::string& str)
+	{
+		CookedString ref{ static_cast<uint32_t>(m_strings.size()), static_cast<uint32_t>(str.size()) };
+		m_strings.insert(m_strings.end(), str.begin(), str.end());
+		return ref;
+	}
+
+	template<typename T>
+	void addChunk(ECookedChunk type, const std::vector<T>& elements)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "cooked chunk elements must be trivially copyable");
+		addChunk(type, static_cast<uint32_t>(elements.size()), elements.data(), sizeof(T) * elements.size());
+	}
+
+	void addChunk(ECookedChunk type, uint32_t count, const void* data, size_t size)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		m_payload.resize((m_payload.size() + COOKED_ALIGNMENT - 1) / COOKED_ALIGNMENT * COOKED_ALIGNMENT, 0);
+		m_chunks.push_back({ type, count, static_cast<uint64_t>(m_payload.size()), static_cast<uint64_t>(size) });
+		m_payload.insert(m_payload.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+	}
+
+	bool write(const std::string& filename, uint64_t sourceHash, uint32_t importFlags)
+	{
+		addChunk(ECookedChunk::Strings, static_cast<uint32_t>(m_strings.size()), m_strings.data(), m_strings.size());
+
+		// chunk offsets are relative to the payload, rebase them behind the header and the chunk table
+		size_t headerSize = sizeof(CookedHeader) + sizeof(CookedChunk) * m_chunks.size();
+		size_t payloadOffset = (headerSize + COOKED_ALIGNMENT - 1) / COOKED_ALIGNMENT * COOKED_ALIGNMENT;
+		for (CookedChunk& chunk : m_chunks)
+		{
+			chunk.offset += payloadOffset;
+		}
+
+		const AnimationCompressor& compressor = AnimationCompressor::getInstance();
+		CookedHeader header{ COOKED_MAGIC, COOKED_VERSION, sourceHash, importFlags, static_cast<uint32_t>(m_chunks.size()),
+			compressor.getError(), compressor.getSampleRate() };
+		std::vector<char> padding(payloadOffset - headerSize, 0);
+
+		// write to a temporary file first, so a half written cache is never picked up
+		std::string tempFilename = filename + ".tmp";
+		{
+			std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				return false;
+			}
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(m_chunks.data()), sizeof(CookedChunk) * m_chunks.size());
+			file.write(padding.data(), padding.size());
+			file.write(m_payload.data(), m_payload.size());
+			if (!file.good())
+			{
+				return false;
+			}
+		}
+
+		boost::system::error_code ec;
+		boost::filesystem::rename(tempFilename, filename, ec);
+		return !ec;
+	}
+
+private:
+	std::vector<char> m_strings;
+	std::vector<char> m_payload;
+	std::vector<CookedChunk> m_chunks;
+};
+
+class CookedReader
+{
+public:
+	CookedReader(const MappedFile& file) : m_file(file) {}
+
+	bool validate(uint64_t sourceHash, uint32_t importFlags)
+	{
+		if (m_file.size() < sizeof(CookedHeader))
+		{
+			return false;
+		}
+
+		m_header = reinterpret_cast<const CookedHeader*>(m_file.data());
+		const AnimationCompressor& compressor = AnimationCompressor::getInstance();
+		if (m_header->magic != COOKED_MAGIC || m_header->version != COOKED_VERSION ||
+			m_header->sourceHash != sourceHash || m_header->importFlags != importFlags ||
+			m_header->animationError != compressor.getError() || m_header->animationSampleRate != compressor.getSampleRate())
+		{
+			return false;
+		}
+
+		if (m_file.size() < sizeof(CookedHeader) + sizeof(CookedChunk) * m_header->chunkCount)
+		{
+			return false;
+		}
+
+		m_chunks = reinterpret_cast<const CookedChunk*>(m_file.data() + sizeof(CookedHeader));
+		for (uint32_t i = 0; i < m_header->chunkCount; ++i)
+		{
+			if (m_chunks[i].offset + m_chunks[i].size > m_file.size())
+			{
+				return false;
+			}
+		}
+
+		m_strings = getChunk<char>(ECookedChunk::Strings, m_stringCount);
+		return true;
+	}
+
+	template<typename T>
+	const T* getChunk(ECookedChunk type, uint32_t& count)
+	{
+		for (uint32_t i = 0; i < m_header->chunkCount; ++i)
+		{
+			const CookedChunk& chunk = m_chunks[i];
+			if (chunk.type == type && chunk.size == sizeof(T) * chunk.count)
+			{
+				count = chunk.count;
+				return reinterpret_cast<const T*>(m_file.data() + chunk.offset);
+			}
+		}
+
+		count = 0;
+		return nullptr;
+	}
+
+	template<typename T>
+	void readChunk(ECookedChunk type, std::vector<T>& elements)
+	{
+		uint32_t count;
+		const T* data = getChunk<T>(type, count);
+		elements.assign(data, data + count);
+	}
+
+	std::string getString(const CookedString& ref)
+	{
+		if (static_cast<uint64_t>(ref.offset) + ref.length > m_stringCount)
+		{
+			return std::string();
+		}
+		return std::string(m_strings + ref.offset, ref.length);
+	}
+
+private:
+	const MappedFile& m_file;
+	const CookedHeader* m_header = nullptr;
+	const CookedChunk* m_chunks = nullptr;
+	const char* m_strings = nullptr;
+	uint32_t m_stringCount = 0;
+};
+
+// 16 bit meshes are cooked as ShortIndices and widened again on load
+void addIndices(CookedWriter& writer, const std::vector<uint32_t>& indices, EIndexType indexType)
+{
+	if (indexType == EIndexType::Uint16)
+	{
+		std::vector<uint16_t> shortIndices(indices.size());
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			shortIndices[i] = static_cast<uint16_t>(indices[i]);
+		}
+		writer.addChunk(ECookedChunk::ShortIndices, shortIndices);
+	}
+	else
+	{
+		writer.addChunk(ECookedChunk::Indices, indices);
+	}
+}
+
+EIndexType readIndices(CookedReader& reader, std::vector<uint32_t>& indices)
+{
+	uint32_t count;
+	const uint16_t* shortIndices = reader.getChunk<uint16_t>(ECookedChunk::ShortIndices, count);
+	if (shortIndices)
+	{
+		indices.assign(shortIndices, shortIndices + count);
+		return EIndexType::Uint16;
+	}
+
+	reader.readChunk(ECookedChunk::Indices, indices);
+	return EIndexType::Uint32;
+}
+
+ModelCooker& ModelCooker::getInstance()
+{
+	static ModelCooker cooker;
+	return cooker;
+}
+
+bool ModelCooker::load(const std::string& filename, uint32_t importFlags,
+	StaticMeshComponent& outStaticMeshComp, SkeletalMeshComponent& outSkeletalMeshComp, AnimatorComponent& outAnimatorComp)
+{
+	MappedFile file;
+	if (!file.open(getCookedFilename(filename)))
+	{
+		return false;
+	}
+
+	CookedReader reader(file);
+	if (!reader.validate(hashSourceFile(filename), importFlags))
+	{
+		return false;
+	}
+
+	// components are only handed out once the whole file has been read successfully
+	StaticMeshComponent staticMeshComp;
+	SkeletalMeshComponent skeletalMeshComp;
+	AnimatorComponent animatorComp;
+
+	// sections
+	uint32_t sectionCount;
+	const CookedSection* cookedSections = reader.getChunk<CookedSection>(ECookedChunk::Sections, sectionCount);
+	std::vector<Section> sections(sectionCount);
+	for (uint32_t i = 0; i < sectionCount; ++i)
+	{
+		sections[i].indexCount = cookedSections[i].indexCount;
+		sections[i].baseVertex = cookedSections[i].baseVertex;
+		sections[i].meshletCount = cookedSections[i].meshletCount;
+		sections[i].material = std::make_shared<Material>();
+		sections[i].material->baseTex = AssetLoader::getInstance().loadTexure(reader.getString(cookedSections[i].baseTex));
+	}
+
+	// levels of detail, only a mesh has sections, lods and bounds, animation only files have none of them
+	uint32_t lodCount, lodIndexCountCount;
+	const CookedLod* cookedLods = reader.getChunk<CookedLod>(ECookedChunk::Lods, lodCount);
+	const uint32_t* lodIndexCounts = reader.getChunk<uint32_t>(ECookedChunk::LodIndexCounts, lodIndexCountCount);
+	uint32_t boundsCount;
+	const BoundingSphere* bounds = reader.getChunk<BoundingSphere>(ECookedChunk::Bounds, boundsCount);
+	if (cookedSections && boundsCount != 1)
+	{
+		return false;
+	}
+
+	std::vector<MeshLod> lods(lodCount);
+	for (uint32_t i = 0; i < lodCount; ++i)
+	{
+		if (cookedLods[i].firstIndexCount + sectionCount > lodIndexCountCount)
+		{
+			return false;
+		}
+
+		lods[i].error = cookedLods[i].error;
+		lods[i].indexCounts.assign(lodIndexCounts + cookedLods[i].firstIndexCount, lodIndexCounts + cookedLods[i].firstIndexCount + sectionCount);
+	}
+
+	// meshes
+	uint32_t staticVertexCount, skeletalVertexCount;
+	reader.getChunk<StaticVertex>(ECookedChunk::StaticVertices, staticVertexCount);
+	reader.getChunk<SkeletalVertex>(ECookedChunk::SkeletalVertices, skeletalVertexCount);
+	if ((staticVertexCount > 0 || skeletalVertexCount > 0) && !cookedSections)
+	{
+		return false;
+	}
+
+	if (staticVertexCount > 0)
+	{
+		staticMeshComp.mesh = std::make_shared<StaticMesh>();
+		reader.readChunk(ECookedChunk::StaticVertices, staticMeshComp.mesh->vertices);
+		staticMeshComp.mesh->indexType = readIndices(reader, staticMeshComp.mesh->indices);
+		staticMeshComp.sections = std::move(sections);
+		staticMeshComp.lods = std::move(lods);
+		staticMeshComp.bounds = *bounds;
+		reader.readChunk(ECookedChunk::Meshlets, staticMeshComp.meshlets);
+		if (!staticMeshComp.sections.empty() && staticMeshComp.sections.back().meshletCount != staticMeshComp.meshlets.size())
+		{
+			return false;
+		}
+	}
+	else if (skeletalVertexCount > 0)
+	{
+		skeletalMeshComp.mesh = std::make_shared<SkeletalMesh>();
+		reader.readChunk(ECookedChunk::SkeletalVertices, skeletalMeshComp.mesh->vertices);
+		skeletalMeshComp.mesh->indexType = readIndices(reader, skeletalMeshComp.mesh->indices);
+		skeletalMeshComp.sections = std::move(sections);
+		skeletalMeshComp.lods = std::move(lods);
+		skeletalMeshComp.bounds = *bounds;
+
+		// skeleton, bones are cooked parent first
+		uint32_t boneCount;
+		const CookedBone* cookedBones = reader.getChunk<CookedBone>(ECookedChunk::Bones, boneCount);
+		std::shared_ptr<Skeleton> skeleton = std::make_shared<Skeleton>();
+		for (uint32_t i = 0; i < boneCount; ++i)
+		{
+			int32_t parent = cookedBones[i].parent;
+			if (parent != INVALID_BONE && (parent < 0 || parent >= static_cast<int32_t>(i)))
+			{
+				return false;
+			}
+			skeleton->addBone(reader.getString(cookedBones[i].name), parent, cookedBones[i].localBindPoseMatrix, cookedBones[i].globalInverseBindPoseMatrix);
+		}
+		skeletalMeshComp.skeleton = skeleton;
+	}
+
+	// animations
+	uint32_t animationCount, channelCount;
+	const CookedAnimation* cookedAnimations = reader.getChunk<CookedAnimation>(ECookedChunk::Animations, animationCount);
+	const CookedChannel* cookedChannels = reader.getChunk<CookedChannel>(ECookedChunk::Channels, channelCount);
+	uint32_t positionTimeCount, positionCount, rotationTimeCount, rotationCount, scaleTimeCount, scaleCount;
+	const uint16_t* positionTimes = reader.getChunk<uint16_t>(ECookedChunk::PositionTimes, positionTimeCount);
+	const PackedVector* positions = reader.getChunk<PackedVector>(ECookedChunk::Positions, positionCount);
+	const uint16_t* rotationTimes = reader.getChunk<uint16_t>(ECookedChunk::RotationTimes, rotationTimeCount);
+	const PackedQuat* rotations = reader.getChunk<PackedQuat>(ECookedChunk::Rotations, rotationCount);
+	const uint16_t* scaleTimes = reader.getChunk<uint16_t>(ECookedChunk::ScaleTimes, scaleTimeCount);
+	const PackedVector* scales = reader.getChunk<PackedVector>(ECookedChunk::Scales, scaleCount);
+
+	// a uniform track has no key, a constant key or a key per frame
+	auto isValidTrack = [](const AnimationTrack& track, uint32_t keyCount, uint32_t frameCount)
+	{
+		return track.firstKey + track.keyCount <= keyCount && (frameCount == 0 || track.keyCount <= 1 || track.keyCount == frameCount);
+	};
+
+	for (uint32_t i = 0; i < animationCount; ++i)
+	{
+		const CookedAnimation& cookedAnimation = cookedAnimations[i];
+		bool uniform = cookedAnimation.frameCount > 0;
+		uint32_t positionTimeNum = uniform ? 0 : cookedAnimation.positionKeyCount;
+		uint32_t rotationTimeNum = uniform ? 0 : cookedAnimation.rotationKeyCount;
+		uint32_t scaleTimeNum = uniform ? 0 : cookedAnimation.scaleKeyCount;
+		if (cookedAnimation.frameCount == 1 ||
+			cookedAnimation.firstChannel + cookedAnimation.channelCount > channelCount ||
+			cookedAnimation.firstPositionKey + cookedAnimation.positionKeyCount > positionCount ||
+			cookedAnimation.firstRotationKey + cookedAnimation.rotationKeyCount > rotationCount ||
+			cookedAnimation.firstScaleKey + cookedAnimation.scaleKeyCount > scaleCount ||
+			cookedAnimation.firstPositionTime + positionTimeNum > positionTimeCount ||
+			cookedAnimation.firstRotationTime + rotationTimeNum > rotationTimeCount ||
+			cookedAnimation.firstScaleTime + scaleTimeNum > scaleTimeCount)
+		{
+			return false;
+		}
+
+		std::shared_ptr<Animation> animation = std::make_shared<Animation>();
+		animation->name = reader.getString(cookedAnimation.name);
+		animation->duration = cookedAnimation.duration;
+		animation->frameRate = cookedAnimation.frameRate;
+		animation->frameCount = cookedAnimation.frameCount;
+		for (uint32_t j = 0; j < cookedAnimation.channelCount; ++j)
+		{
+			const CookedChannel& cookedChannel = cookedChannels[cookedAnimation.firstChannel + j];
+			const AnimationChannel& channel = cookedChannel.channel;
+			if (!isValidTrack(channel.position, cookedAnimation.positionKeyCount, cookedAnimation.frameCount) ||
+				!isValidTrack(channel.rotation, cookedAnimation.rotationKeyCount, cookedAnimation.frameCount) ||
+				!isValidTrack(channel.scale, cookedAnimation.scaleKeyCount, cookedAnimation.frameCount))
+			{
+				return false;
+			}
+
+			animation->channelNames.push_back(reader.getString(cookedChannel.name));
+			animation->channels.push_back(channel);
+		}
+
+		animation->positionTimes.assign(positionTimes + cookedAnimation.firstPositionTime, positionTimes + cookedAnimation.firstPositionTime + positionTimeNum);
+		animation->positions.assign(positions + cookedAnimation.firstPositionKey, positions + cookedAnimation.firstPositionKey + cookedAnimation.positionKeyCount);
+		animation->rotationTimes.assign(rotationTimes + cookedAnimation.firstRotationTime, rotationTimes + cookedAnimation.firstRotationTime + rotationTimeNum);
+		animation->rotations.assign(rotations + cookedAnimation.firstRotationKey, rotations + cookedAnimation.firstRotationKey + cookedAnimation.rotationKeyCount);
+		animation->scaleTimes.assign(scaleTimes + cookedAnimation.firstScaleTime, scaleTimes + cookedAnimation.firstScaleTime + scaleTimeNum);
+		animation->scales.assign(scales + cookedAnimation.firstScaleKey, scales + cookedAnimation.firstScaleKey + cookedAnimation.scaleKeyCount);
+		animatorComp.animations[animation->name] = animation;
+	}
+
+	outStaticMeshComp = staticMeshComp;
+	outSkeletalMeshComp = skeletalMeshComp;
+	outAnimatorComp.animations.insert(animatorComp.animations.begin(), animatorComp.animations.end());
+	return true;
+}
+
+void ModelCooker::save(const std::string& filename, uint32_t importFlags,
+	const StaticMeshComponent& staticMeshComp, const SkeletalMeshComponent& skeletalMeshComp, const AnimatorComponent& animatorComp)
+{
+	CookedWriter writer;
+
+	// meshes and sections
+	const std::vector<Section>* sections = nullptr;
+	const std::vector<MeshLod>* lods = nullptr;
+	std::vector<BoundingSphere> bounds;
+	if (staticMeshComp.mesh)
+	{
+		writer.addChunk(ECookedChunk::StaticVertices, staticMeshComp.mesh->vertices);
+		addIndices(writer, staticMeshComp.mesh->indices, staticMeshComp.mesh->indexType);
+		sections = &staticMeshComp.sections;
+		lods = &staticMeshComp.lods;
+		writer.addChunk(ECookedChunk::Meshlets, staticMeshComp.meshlets);
+		bounds.push_back(staticMeshComp.bounds);
+	}
+	else if (skeletalMeshComp.mesh)
+	{
+		writer.addChunk(ECookedChunk::SkeletalVertices, skeletalMeshComp.mesh->vertices);
+		addIndices(writer, skeletalMeshComp.mesh->indices, skeletalMeshComp.mesh->indexType);
+		sections = &skeletalMeshComp.sections;
+		lods = &skeletalMeshComp.lods;
+		bounds.push_back(skeletalMeshComp.bounds);
+
+		const Skeleton& skeleton = *skeletalMeshComp.skeleton;
+		std::vector<CookedBone> cookedBones(skeleton.getBoneNum());
+		for (uint32_t i = 0; i < skeleton.getBoneNum(); ++i)
+		{
+			cookedBones[i].name = writer.addString(skeleton.names[i]);
+			cookedBones[i].parent = skeleton.parents[i];
+			cookedBones[i].globalInverseBindPoseMatrix = skeleton.inverseBindPoses[i];
+			cookedBones[i].localBindPoseMatrix = skeleton.localBindPoses[i];
+		}
+		writer.addChunk(ECookedChunk::Bones, cookedBones);
+	}
+
+	if (sections)
+	{
+		std::vector<CookedSection> cookedSections(sections->size());
+		for (size_t i = 0; i < sections->size(); ++i)
+		{
+			const Section& section = (*sections)[i];
+			cookedSections[i].indexCount = section.indexCount;
+			cookedSections[i].baseVertex = section.baseVertex;
+			cookedSections[i].meshletCount = section.meshletCount;
+			cookedSections[i].baseTex = writer.addString(section.material->baseTex->filename);
+		}
+		writer.addChunk(ECookedChunk::Sections, cookedSections);
+
+		std::vector<CookedLod> cookedLods;
+		std::vector<uint32_t> lodIndexCounts;
+		for (const MeshLod& lod : *lods)
+		{
+			cookedLods.push_back({ lod.error, static_cast<uint32_t>(lodIndexCounts.size()) });
+			lodIndexCounts.insert(lodIndexCounts.end(), lod.indexCounts.begin(), lod.indexCounts.end());
+		}
+		writer.addChunk(ECookedChunk::Lods, cookedLods);
+		writer.addChunk(ECookedChunk::LodIndexCounts, lodIndexCounts);
+		writer.addChunk(ECookedChunk::Bounds, bounds);
+	}
+
+	// animations, the key runs of all clips are cooked back to back
+	std::vector<CookedAnimation> cookedAnimations;
+	std::vector<CookedChannel> cookedChannels;
+	std::vector<uint16_t> positionTimes, rotationTimes, scaleTimes;
+	std::vector<PackedVector> positions, scales;
+	std::vector<PackedQuat> rotations;
+	for (const auto& iter : animatorComp.animations)
+	{
+		const Animation& animation = *iter.second;
+
+		CookedAnimation cookedAnimation;
+		cookedAnimation.name = writer.addString(animation.name);
+		cookedAnimation.duration = animation.duration;
+		cookedAnimation.frameRate = animation.frameRate;
+		cookedAnimation.frameCount = animation.frameCount;
+		cookedAnimation.firstChannel = static_cast<uint32_t>(cookedChannels.size());
+		cookedAnimation.channelCount = static_cast<uint32_t>(animation.channels.size());
+		cookedAnimation.firstPositionKey = static_cast<uint32_t>(positions.size());
+		cookedAnimation.positionKeyCount = static_cast<uint32_t>(animation.positions.size());
+		cookedAnimation.firstRotationKey = static_cast<uint32_t>(rotations.size());
+		cookedAnimation.rotationKeyCount = static_cast<uint32_t>(animation.rotations.size());
+		cookedAnimation.firstScaleKey = static_cast<uint32_t>(scales.size());
+		cookedAnimation.scaleKeyCount = static_cast<uint32_t>(animation.scales.size());
+		cookedAnimation.firstPositionTime = static_cast<uint32_t>(positionTimes.size());
+		cookedAnimation.firstRotationTime = static_cast<uint32_t>(rotationTimes.size());
+		cookedAnimation.firstScaleTime = static_cast<uint32_t>(scaleTimes.size());
+		cookedAnimations.push_back(cookedAnimation);
+
+		for (size_t i = 0; i < animation.channels.size(); ++i)
+		{
+			cookedChannels.push_back({ writer.addString(animation.channelNames[i]), animation.channels[i] });
+		}
+
+		positionTimes.insert(positionTimes.end(), animation.positionTimes.begin(), animation.positionTimes.end());
+		positions.insert(positions.end(), animation.positions.begin(), animation.positions.end());
+		rotationTimes.insert(rotationTimes.end(), animation.rotationTimes.begin(), animation.rotationTimes.end());
+		rotations.insert(rotations.end(), animation.rotations.begin(), animation.rotations.end());
+		scaleTimes.insert(scaleTimes.end(), animation.scaleTimes.begin(), animation.scaleTimes.end());
+		scales.insert(scales.end(), animation.scales.begin(), animation.scales.end());
+	}
+	writer.addChunk(ECookedChunk::Animations, cookedAnimations);
+	writer.addChunk(ECookedChunk::Channels, cookedChannels);
+	writer.addChunk(ECookedChunk::PositionTimes, positionTimes);
+	writer.addChunk(ECookedChunk::Positions, positions);
+	writer.addChunk(ECookedChunk::RotationTimes, rotationTimes);
+	writer.addChunk(ECookedChunk::Rotations, rotations);
+	writer.addChunk(ECookedChunk::ScaleTimes, scaleTimes);
+	writer.addChunk(ECookedChunk::Scales, scales);
+
+	std::string cookedFilename = getCookedFilename(filename);
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(boost::filesystem::path(cookedFilename).parent_path(), ec);
+	if (ec || !writer.write(cookedFilename, hashSourceFile(filename), importFlags))
+	{
+		printf("failed to write cooked model: %s\n", cookedFilename.c_str());
+	}
+}
+
+std::string ModelCooker::getCookedFilename(const std::string& filename)
+{
+	std::string cookedFilename = filename;
+	Utility::replace(cookedFilename, "asset/", "asset/cache/");
+	return cookedFilename + ".cooked";
+}
+
+uint64_t ModelCooker::hashSourceFile(const std::string& filename)
+{
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		return 0;
+	}
+	return Utility::hash(file.data(), file.size());
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "component/component.h"
+
+/*
+ * Cooked model cache
+ * The first import of a model file writes a binary snapshot of the imported meshes, sections, skeleton,
+ * material references and animations next to the asset cache. Later loads map that file and only copy
+ * the blobs out and fix up the bone pointers, so assimp is skipped entirely.
+ * A cooked file is rejected when the source file hash, the importer flags, the animation compression settings or the cooked format version differ.
+ */
+class ModelCooker
+{
+public:
+	static ModelCooker& getInstance();
+
+	bool load(const std::string& filename, uint32_t importFlags,
+		StaticMeshComponent& staticMeshComp, SkeletalMeshComponent& skeletalMeshComp, AnimatorComponent& animatorComp);
+	void save(const std::string& filename, uint32_t importFlags,
+		const StaticMeshComponent& staticMeshComp, const SkeletalMeshComponent& skeletalMeshComp, const AnimatorComponent& animatorComp);
+
+	std::string getCookedFilename(const std::string& filename);
+
+private:
+	uint64_t hashSourceFile(const std::string& filename);
+};
@@ -0,0 +1,550 @@
+#include "texture_compressor.h"
+#include "utility/thread_pool.h"
+
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_COMPRESSOR_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const float BC1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	const int BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// pixels are kept in SoA layout, channel c of pixel i lives at pixels[c * 16 + i]
+	void loadBlock(const uint8_t block[64], float pixels[64])
+	{
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				pixels[c * 16 + i] = static_cast<float>(block[i * 4 + c]);
+			}
+		}
+	}
+
+	void extractBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t block[64])
+	{
+		// blocks that hang over the image border repeat the last row/column
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			uint32_t py = std::min(blockY * 4 + y, height - 1);
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				uint32_t px = std::min(blockX * 4 + x, width - 1);
+				memcpy(&block[(y * 4 + x) * 4], &rgba[(static_cast<size_t>(py) * width + px) * 4], 4);
+			}
+		}
+	}
+
+	// palette is paletteSize entries of 4 floats, returns the summed squared error
+	float selectIndices(const float* pixels, uint32_t channelNum, const float* palette, uint32_t paletteSize, uint8_t indices[16])
+	{
+		float error = 0.0f;
+
+#ifdef TEXTURE_COMPRESSOR_SSE2
+		for (uint32_t group = 0; group < 4; ++group)
+		{
+			__m128 bestDistance = _mm_set1_ps(FLT_MAX);
+			__m128 bestIndex = _mm_setzero_ps();
+			for (uint32_t k = 0; k < paletteSize; ++k)
+			{
+				__m128 distance = _mm_setzero_ps();
+				for (uint32_t c = 0; c < channelNum; ++c)
+				{
+					__m128 delta = _mm_sub_ps(_mm_loadu_ps(&pixels[c * 16 + group * 4]), _mm_set1_ps(palette[k * 4 + c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(delta, delta));
+				}
+
+				__m128 closer = _mm_cmplt_ps(distance, bestDistance);
+				bestDistance = _mm_min_ps(distance, bestDistance);
+				bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(k))), _mm_andnot_ps(closer, bestIndex));
+			}
+
+			alignas(16) int32_t groupIndices[4];
+			alignas(16) float groupDistances[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(groupIndices), _mm_cvttps_epi32(bestIndex));
+			_mm_store_ps(groupDistances, bestDistance);
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				indices[group * 4 + i] = static_cast<uint8_t>(groupIndices[i]);
+				error += groupDistances[i];
+			}
+		}
+#else
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			float bestDistance = FLT_MAX;
+			uint8_t bestIndex = 0;
+			for (uint32_t k = 0; k < paletteSize; ++k)
+			{
+				float distance = 0.0f;
+				for (uint32_t c = 0; c < channelNum; ++c)
+				{
+					float delta = pixels[c * 16 + i] - palette[k * 4 + c];
+					distance += delta * delta;
+				}
+
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = static_cast<uint8_t>(k);
+				}
+			}
+			indices[i] = bestIndex;
+			error += bestDistance;
+		}
+#endif
+
+		return error;
+	}
+
+	// mean and dominant direction of the block colors by power iteration on the covariance matrix
+	void computePrincipalAxis(const float* pixels, uint32_t channelNum, float mean[4], float axis[4])
+	{
+		float minValue[4], maxValue[4];
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			mean[c] = 0.0f;
+			axis[c] = 0.0f;
+			minValue[c] = FLT_MAX;
+			maxValue[c] = -FLT_MAX;
+		}
+
+		for (uint32_t c = 0; c < channelNum; ++c)
+		{
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				float value = pixels[c * 16 + i];
+				mean[c] += value;
+				minValue[c] = std::min(minValue[c], value);
+				maxValue[c] = std::max(maxValue[c], value);
+			}
+			mean[c] /= 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			for (uint32_t a = 0; a < channelNum; ++a)
+			{
+				for (uint32_t b = a; b < channelNum; ++b)
+				{
+					covariance[a][b] += (pixels[a * 16 + i] - mean[a]) * (pixels[b * 16 + i] - mean[b]);
+				}
+			}
+		}
+		for (uint32_t a = 0; a < channelNum; ++a)
+		{
+			for (uint32_t b = 0; b < a; ++b)
+			{
+				covariance[a][b] = covariance[b][a];
+			}
+		}
+
+		for (uint32_t c = 0; c < channelNum; ++c)
+		{
+			axis[c] = maxValue[c] - minValue[c];
+		}
+
+		for (uint32_t iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float maxComponent = 0.0f;
+			for (uint32_t a = 0; a < channelNum; ++a)
+			{
+				for (uint32_t b = 0; b < channelNum; ++b)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				maxComponent = std::max(maxComponent, std::fabs(next[a]));
+			}
+
+			if (maxComponent < 1e-6f)
+			{
+				break;
+			}
+
+			for (uint32_t c = 0; c < channelNum; ++c)
+			{
+				axis[c] = next[c] / maxComponent;
+			}
+		}
+
+		float length = 0.0f;
+		for (uint32_t c = 0; c < channelNum; ++c)
+		{
+			length += axis[c] * axis[c];
+		}
+		length = std::sqrt(length);
+		for (uint32_t c = 0; c < channelNum; ++c)
+		{
+			axis[c] = length > 1e-6f ? axis[c] / length : 0.0f;
+		}
+	}
+
+	void computeEndpoints(const float* pixels, uint32_t channelNum, float insetRatio, float e0[4], float e1[4])
+	{
+		float mean[4], axis[4];
+		computePrincipalAxis(pixels, channelNum, mean, axis);
+
+		float minT = FLT_MAX;
+		float maxT = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			float t = 0.0f;
+			for (uint32_t c = 0; c < channelNum; ++c)
+			{
+				t += (pixels[c * 16 + i] - mean[c]) * axis[c];
+			}
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		float inset = (maxT - minT) * insetRatio;
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			e0[c] = std::clamp(mean[c] + axis[c] * (maxT - inset), 0.0f, 255.0f);
+			e1[c] = std::clamp(mean[c] + axis[c] * (minT + inset), 0.0f, 255.0f);
+		}
+	}
+
+	// least squares endpoints for fixed indices, weights[k] is the contribution of e1 to palette entry k
+	bool refineEndpoints(const float* pixels, uint32_t channelNum, const uint8_t indices[16], const float* weights, float e0[4], float e1[4])
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {}, bx[4] = {};
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			float b = weights[indices[i]];
+			float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (uint32_t c = 0; c < channelNum; ++c)
+			{
+				ax[c] += a * pixels[c * 16 + i];
+				bx[c] += b * pixels[c * 16 + i];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+
+		for (uint32_t c = 0; c < channelNum; ++c)
+		{
+			e0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+			e1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	uint16_t packColor565(const float color[4])
+	{
+		uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+		uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+		uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void unpackColor565(uint16_t packed, float color[4])
+	{
+		uint32_t r = (packed >> 11) & 31;
+		uint32_t g = (packed >> 5) & 63;
+		uint32_t b = packed & 31;
+		color[0] = static_cast<float>((r << 3) | (r >> 2));
+		color[1] = static_cast<float>((g << 2) | (g >> 4));
+		color[2] = static_cast<float>((b << 3) | (b >> 2));
+		color[3] = 255.0f;
+	}
+
+	float encodeBC1Endpoints(const float* pixels, const float e0[4], const float e1[4], uint8_t out[8], uint8_t indices[16])
+	{
+		uint16_t c0 = packColor565(e0);
+		uint16_t c1 = packColor565(e1);
+
+		// c0 > c1 selects the opaque four color mode
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+		}
+
+		float palette[4 * 4];
+		unpackColor565(c0, &palette[0]);
+		unpackColor565(c1, &palette[4]);
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			palette[8 + c] = (2.0f * palette[c] + palette[4 + c]) / 3.0f;
+			palette[12 + c] = (palette[c] + 2.0f * palette[4 + c]) / 3.0f;
+		}
+
+		float error = selectIndices(pixels, 3, palette, c0 == c1 ? 1 : 4, indices);
+
+		uint32_t packedIndices = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			packedIndices |= static_cast<uint32_t>(indices[i]) << (i * 2);
+		}
+
+		out[0] = static_cast<uint8_t>(c0 & 0xFF);
+		out[1] = static_cast<uint8_t>(c0 >> 8);
+		out[2] = static_cast<uint8_t>(c1 & 0xFF);
+		out[3] = static_cast<uint8_t>(c1 >> 8);
+		memcpy(&out[4], &packedIndices, 4);
+		return error;
+	}
+
+	void encodeBC4(const float* values, uint8_t out[8])
+	{
+		float minValue = 255.0f, maxValue = 0.0f;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			minValue = std::min(minValue, values[i]);
+			maxValue = std::max(maxValue, values[i]);
+		}
+
+		// a0 > a1 selects the eight value interpolation mode
+		uint8_t a0 = static_cast<uint8_t>(maxValue + 0.5f);
+		uint8_t a1 = static_cast<uint8_t>(minValue + 0.5f);
+
+		uint8_t indices[16] = {};
+		if (a0 != a1)
+		{
+			float palette[8 * 4] = {};
+			palette[0] = a0;
+			palette[4] = a1;
+			for (uint32_t i = 1; i < 7; ++i)
+			{
+				palette[(i + 1) * 4] = static_cast<float>(((7 - i) * a0 + i * a1) / 7);
+			}
+			selectIndices(values, 1, palette, 8, indices);
+		}
+
+		uint64_t packedIndices = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			packedIndices |= static_cast<uint64_t>(indices[i]) << (i * 3);
+		}
+
+		out[0] = a0;
+		out[1] = a1;
+		for (uint32_t i = 0; i < 6; ++i)
+		{
+			out[2 + i] = static_cast<uint8_t>(packedIndices >> (i * 8));
+		}
+	}
+
+	struct BitWriter
+	{
+		uint8_t* out;
+		uint32_t position = 0;
+
+		void write(uint32_t value, uint32_t bitNum)
+		{
+			for (uint32_t i = 0; i < bitNum; ++i, ++position)
+			{
+				if (value & (1u << i))
+				{
+					out[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+				}
+			}
+		}
+	};
+
+	// 7 bit endpoint plus the p-bit that gives the smallest error over all four channels
+	void quantizeBC7Endpoint(const float endpoint[4], uint32_t quantized[4], uint32_t& pbit)
+	{
+		float bestError = FLT_MAX;
+		for (uint32_t p = 0; p < 2; ++p)
+		{
+			uint32_t candidate[4];
+			float error = 0.0f;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				float value = std::round((endpoint[c] - p) / 2.0f);
+				candidate[c] = static_cast<uint32_t>(std::clamp(value, 0.0f, 127.0f));
+				float delta = static_cast<float>(candidate[c] * 2 + p) - endpoint[c];
+				error += delta * delta;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				pbit = p;
+				memcpy(quantized, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	float encodeBC7Mode6(const float* pixels, const float e0[4], const float e1[4], uint8_t out[16], uint8_t indices[16])
+	{
+		uint32_t q0[4], q1[4], p0, p1;
+		quantizeBC7Endpoint(e0, q0, p0);
+		quantizeBC7Endpoint(e1, q1, p1);
+
+		float palette[16 * 4];
+		for (uint32_t k = 0; k < 16; ++k)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				int v0 = static_cast<int>(q0[c] * 2 + p0);
+				int v1 = static_cast<int>(q1[c] * 2 + p1);
+				palette[k * 4 + c] = static_cast<float>(((64 - BC7Weights[k]) * v0 + BC7Weights[k] * v1 + 32) >> 6);
+			}
+		}
+
+		float error = selectIndices(pixels, 4, palette, 16, indices);
+
+		// the anchor index is stored with 3 bits, so its top bit has to be zero
+		if (indices[0] & 8)
+		{
+			std::swap(q0, q1);
+			std::swap(p0, p1);
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				indices[i] = static_cast<uint8_t>(15 - indices[i]);
+			}
+		}
+
+		memset(out, 0, 16);
+		BitWriter writer{ out };
+		writer.write(1u << 6, 7);
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			writer.write(q0[c], 7);
+			writer.write(q1[c], 7);
+		}
+		writer.write(p0, 1);
+		writer.write(p1, 1);
+		writer.write(indices[0], 3);
+		for (uint32_t i = 1; i < 16; ++i)
+		{
+			writer.write(indices[i], 4);
+		}
+
+		return error;
+	}
+}
+
+uint32_t TextureCompressor::getBlockSize(ETextureFormat format)
+{
+	switch (format)
+	{
+	case ETextureFormat::BC1: return 8;
+	case ETextureFormat::BC3:
+	case ETextureFormat::BC5:
+	case ETextureFormat::BC7: return 16;
+	default: return 0;
+	}
+}
+
+size_t TextureCompressor::getCompressedSize(ETextureFormat format, uint32_t width, uint32_t height)
+{
+	if (format == ETextureFormat::RGBA8)
+	{
+		return static_cast<size_t>(width) * height * 4;
+	}
+
+	size_t blocksX = (std::max(width, 1u) + 3) / 4;
+	size_t blocksY = (std::max(height, 1u) + 3) / 4;
+	return blocksX * blocksY * getBlockSize(format);
+}
+
+void TextureCompressor::compress(ETextureFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& blocks)
+{
+	uint32_t blockSize = getBlockSize(format);
+	uint32_t blocksX = (width + 3) / 4;
+	uint32_t blocksY = (height + 3) / 4;
+	blocks.resize(getCompressedSize(format, width, height));
+
+	ThreadPool::getInstance().parallelFor(blocksY, [&](uint32_t blockY) {
+		uint8_t block[64];
+		for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+		{
+			extractBlock(rgba, width, height, blockX, blockY, block);
+			uint8_t* out = &blocks[(static_cast<size_t>(blockY) * blocksX + blockX) * blockSize];
+			switch (format)
+			{
+			case ETextureFormat::BC1: compressBlockBC1(block, out); break;
+			case ETextureFormat::BC3: compressBlockBC3(block, out); break;
+			case ETextureFormat::BC5: compressBlockBC5(block, out); break;
+			case ETextureFormat::BC7: compressBlockBC7(block, out); break;
+			default: break;
+			}
+		}
+	});
+}
+
+void TextureCompressor::compressBlockBC1(const uint8_t block[64], uint8_t out[8])
+{
+	float pixels[64];
+	loadBlock(block, pixels);
+
+	float e0[4], e1[4];
+	uint8_t indices[16];
+	computeEndpoints(pixels, 3, 1.0f / 16.0f, e0, e1);
+	float error = encodeBC1Endpoints(pixels, e0, e1, out, indices);
+
+	// one least squares pass over the chosen indices, kept only if it lowers the error
+	if (refineEndpoints(pixels, 3, indices, BC1Weights, e0, e1))
+	{
+		uint8_t refined[8], refinedIndices[16];
+		if (encodeBC1Endpoints(pixels, e0, e1, refined, refinedIndices) < error)
+		{
+			memcpy(out, refined, sizeof(refined));
+		}
+	}
+}
+
+void TextureCompressor::compressBlockBC3(const uint8_t block[64], uint8_t out[16])
+{
+	float pixels[64];
+	loadBlock(block, pixels);
+
+	encodeBC4(&pixels[3 * 16], out);
+	compressBlockBC1(block, out + 8);
+}
+
+void TextureCompressor::compressBlockBC5(const uint8_t block[64], uint8_t out[16])
+{
+	float pixels[64];
+	loadBlock(block, pixels);
+
+	encodeBC4(&pixels[0 * 16], out);
+	encodeBC4(&pixels[1 * 16], out + 8);
+}
+
+void TextureCompressor::compressBlockBC7(const uint8_t block[64], uint8_t out[16])
+{
+	float pixels[64];
+	loadBlock(block, pixels);
+
+	float e0[4], e1[4];
+	uint8_t indices[16];
+	computeEndpoints(pixels, 4, 0.0f, e1, e0);
+	float error = encodeBC7Mode6(pixels, e0, e1, out, indices);
+
+	float weights[16];
+	for (uint32_t k = 0; k < 16; ++k)
+	{
+		weights[k] = BC7Weights[k] / 64.0f;
+	}
+
+	// indices may have been flipped for the anchor bit, so the refined endpoints follow that order
+	if (refineEndpoints(pixels, 4, indices, weights, e0, e1))
+	{
+		uint8_t refined[16], refinedIndices[16];
+		if (encodeBC7Mode6(pixels, e0, e1, refined, refinedIndices) < error)
+		{
+			memcpy(out, refined, sizeof(refined));
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "component/material.h"
+
+/*
+ * CPU block compressor for BC1/BC3/BC5/BC7
+ * Endpoints come from the principal axis of each 4x4 block and are refined once by least squares,
+ * index selection is vectorized with SSE2 when available. BC7 blocks are encoded with mode 6 only.
+ * Whole images are split into block rows and compressed on the thread pool.
+ */
+class TextureCompressor
+{
+public:
+	static uint32_t getBlockSize(ETextureFormat format);
+	static size_t getCompressedSize(ETextureFormat format, uint32_t width, uint32_t height);
+
+	// rgba is a tightly packed RGBA8 image, the result is a row major array of blocks
+	static void compress(ETextureFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& blocks);
+
+	static void compressBlockBC1(const uint8_t block[64], uint8_t out[8]);
+	static void compressBlockBC3(const uint8_t block[64], uint8_t out[16]);
+	static void compressBlockBC5(const uint8_t block[64], uint8_t out[16]);
+	static void compressBlockBC7(const uint8_t block[64], uint8_t out[16]);
+};
@@ -0,0 +1,263 @@
+#include "texture_cooker.h"
+#include "texture_compressor.h"
+#include "mipmap_generator.h"
+#include "config/config_manager.h"
+#include "utility/utility.h"
+#include "utility/mapped_file.h"
+
+#include <fstream>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+
+#define COOKED_TEXTURE_VERSION 2
+#define COOKED_TEXTURE_ALIGNMENT 16
+
+// same layout idea as the KTX2 identifier, a non ASCII byte, the tag and the line ending checks
+const uint8_t CookedTextureIdentifier[12] = { 0xAB, 'B', 'T', 'E', 'X', ' ', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+struct CookedTextureHeader
+{
+	uint8_t identifier[12];
+	uint32_t version;
+	uint64_t sourceHash;
+	uint32_t colorFormat;
+	uint32_t mipmapFilter;
+	uint32_t format;
+	uint32_t srgb;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+};
+
+struct CookedTextureLevel
+{
+	uint64_t offset;
+	uint64_t size;
+	uint32_t width;
+	uint32_t height;
+};
+
+TextureCooker& TextureCooker::getInstance()
+{
+	static TextureCooker cooker;
+	return cooker;
+}
+
+void TextureCooker::init(bool compressionSupported)
+{
+	std::string filter = ConfigManager::getInstance().getMipmapFilter();
+	m_mipmapFilter = filter == "box" ? EMipmapFilter::Box : EMipmapFilter::Kaiser;
+
+	std::string compression = ConfigManager::getInstance().getTextureCompression();
+	m_colorFormat = ETextureFormat::RGBA8;
+	if (compressionSupported)
+	{
+		if (compression == "bc7")
+		{
+			m_colorFormat = ETextureFormat::BC7;
+		}
+		else if (compression == "bc1")
+		{
+			m_colorFormat = ETextureFormat::BC1;
+		}
+	}
+}
+
+void TextureCooker::destroy()
+{
+
+}
+
+bool TextureCooker::load(Texture& texture)
+{
+	MappedFile file;
+	if (!file.open(getCookedFilename(texture.filename)) || file.size() < sizeof(CookedTextureHeader))
+	{
+		return false;
+	}
+
+	const CookedTextureHeader* header = reinterpret_cast<const CookedTextureHeader*>(file.data());
+	if (memcmp(header->identifier, CookedTextureIdentifier, sizeof(CookedTextureIdentifier)) != 0 ||
+		header->version != COOKED_TEXTURE_VERSION || header->colorFormat != static_cast<uint32_t>(m_colorFormat) ||
+		header->mipmapFilter != static_cast<uint32_t>(m_mipmapFilter) ||
+		header->sourceHash != hashSourceFile(texture.filename))
+	{
+		return false;
+	}
+
+	size_t indexEnd = sizeof(CookedTextureHeader) + sizeof(CookedTextureLevel) * header->levelCount;
+	if (header->levelCount == 0 || file.size() < indexEnd)
+	{
+		return false;
+	}
+
+	// levels are stored back to back, so the whole payload is copied in one go
+	const CookedTextureLevel* cookedLevels = reinterpret_cast<const CookedTextureLevel*>(file.data() + sizeof(CookedTextureHeader));
+	uint64_t payloadOffset = cookedLevels[0].offset;
+	uint64_t payloadEnd = payloadOffset;
+	std::vector<TextureLevel> levels(header->levelCount);
+	for (uint32_t i = 0; i < header->levelCount; ++i)
+	{
+		const CookedTextureLevel& cookedLevel = cookedLevels[i];
+		if (cookedLevel.offset < payloadOffset || cookedLevel.offset + cookedLevel.size > file.size())
+		{
+			return false;
+		}
+
+		levels[i] = { cookedLevel.width, cookedLevel.height, static_cast<size_t>(cookedLevel.offset - payloadOffset), static_cast<size_t>(cookedLevel.size) };
+		payloadEnd = std::max(payloadEnd, cookedLevel.offset + cookedLevel.size);
+	}
+
+	texture.width = static_cast<int>(header->width);
+	texture.height = static_cast<int>(header->height);
+	texture.channels = 4;
+	texture.format = static_cast<ETextureFormat>(header->format);
+	texture.srgb = header->srgb != 0;
+	texture.levels = std::move(levels);
+	texture.levelData.assign(file.data() + payloadOffset, file.data() + payloadEnd);
+	return true;
+}
+
+void TextureCooker::cook(Texture& texture)
+{
+	if (!texture.data)
+	{
+		return;
+	}
+
+	ETextureFormat format = chooseFormat(texture);
+	texture.srgb = !isNormalMap(texture);
+	buildLevels(texture, format);
+
+	// the RGBA pixels are not needed once the levels exist
+	free(texture.data);
+	texture.data = nullptr;
+
+	std::vector<CookedTextureLevel> cookedLevels(texture.levels.size());
+	size_t headerSize = sizeof(CookedTextureHeader) + sizeof(CookedTextureLevel) * cookedLevels.size();
+	size_t payloadOffset = (headerSize + COOKED_TEXTURE_ALIGNMENT - 1) / COOKED_TEXTURE_ALIGNMENT * COOKED_TEXTURE_ALIGNMENT;
+	for (size_t i = 0; i < texture.levels.size(); ++i)
+	{
+		const TextureLevel& level = texture.levels[i];
+		cookedLevels[i] = { static_cast<uint64_t>(payloadOffset + level.offset), static_cast<uint64_t>(level.size), level.width, level.height };
+	}
+
+	CookedTextureHeader header{};
+	memcpy(header.identifier, CookedTextureIdentifier, sizeof(CookedTextureIdentifier));
+	header.version = COOKED_TEXTURE_VERSION;
+	header.sourceHash = hashSourceFile(texture.filename);
+	header.colorFormat = static_cast<uint32_t>(m_colorFormat);
+	header.mipmapFilter = static_cast<uint32_t>(m_mipmapFilter);
+	header.format = static_cast<uint32_t>(texture.format);
+	header.srgb = texture.srgb ? 1 : 0;
+	header.width = static_cast<uint32_t>(texture.width);
+	header.height = static_cast<uint32_t>(texture.height);
+	header.levelCount = static_cast<uint32_t>(cookedLevels.size());
+
+	std::string cookedFilename = getCookedFilename(texture.filename);
+	std::string tempFilename = cookedFilename + ".tmp";
+	bool written = false;
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(boost::filesystem::path(cookedFilename).parent_path(), ec);
+	if (!ec)
+	{
+		// write to a temporary file first, so a half written container is never picked up
+		std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+		std::vector<char> padding(payloadOffset - headerSize, 0);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(cookedLevels.data()), sizeof(CookedTextureLevel) * cookedLevels.size());
+		file.write(padding.data(), padding.size());
+		file.write(reinterpret_cast<const char*>(texture.levelData.data()), texture.levelData.size());
+		file.close();
+
+		if (file.good())
+		{
+			boost::filesystem::rename(tempFilename, cookedFilename, ec);
+			written = !ec;
+		}
+	}
+
+	if (!written)
+	{
+		printf("failed to write cooked texture: %s\n", cookedFilename.c_str());
+	}
+}
+
+std::string TextureCooker::getCookedFilename(const std::string& filename)
+{
+	std::string cookedFilename = filename;
+	Utility::replace(cookedFilename, "asset/", "asset/cache/");
+	return cookedFilename + ".btex";
+}
+
+bool TextureCooker::isNormalMap(const Texture& texture)
+{
+	std::string name = boost::algorithm::to_lower_copy(texture.name);
+	return name.find("normal") != std::string::npos || name.find("_ddn") != std::string::npos || name.find("_nrm") != std::string::npos;
+}
+
+ETextureFormat TextureCooker::chooseFormat(const Texture& texture)
+{
+	if (m_colorFormat == ETextureFormat::RGBA8)
+	{
+		return ETextureFormat::RGBA8;
+	}
+
+	// tangent space normals only need two channels, z is rebuilt in the shader
+	if (isNormalMap(texture))
+	{
+		return ETextureFormat::BC5;
+	}
+
+	if (m_colorFormat == ETextureFormat::BC7)
+	{
+		return ETextureFormat::BC7;
+	}
+
+	// BC1 has no usable alpha, fall back to BC3 as soon as one pixel is not opaque
+	size_t pixelCount = static_cast<size_t>(texture.width) * texture.height;
+	for (size_t i = 0; i < pixelCount; ++i)
+	{
+		if (texture.data[i * 4 + 3] != 255)
+		{
+			return ETextureFormat::BC3;
+		}
+	}
+	return ETextureFormat::BC1;
+}
+
+void TextureCooker::buildLevels(Texture& texture, ETextureFormat format)
+{
+	std::vector<MipmapLevel> mipmapLevels;
+	MipmapGenerator::generate(texture.data, static_cast<uint32_t>(texture.width), static_cast<uint32_t>(texture.height),
+		texture.srgb, m_mipmapFilter, mipmapLevels);
+
+	texture.format = format;
+	texture.levels.clear();
+	texture.levelData.clear();
+	for (const MipmapLevel& mipmapLevel : mipmapLevels)
+	{
+		std::vector<uint8_t> blocks;
+		if (format == ETextureFormat::RGBA8)
+		{
+			blocks = mipmapLevel.pixels;
+		}
+		else
+		{
+			TextureCompressor::compress(format, mipmapLevel.pixels.data(), mipmapLevel.width, mipmapLevel.height, blocks);
+		}
+
+		texture.levels.push_back({ mipmapLevel.width, mipmapLevel.height, texture.levelData.size(), blocks.size() });
+		texture.levelData.insert(texture.levelData.end(), blocks.begin(), blocks.end());
+	}
+}
+
+uint64_t TextureCooker::hashSourceFile(const std::string& filename)
+{
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		return 0;
+	}
+	return Utility::hash(file.data(), file.size());
+}
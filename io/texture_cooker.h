@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+#include "component/material.h"
+#include "io/mipmap_generator.h"
+
+/*
+ * Cooked texture cache
+ * Decoded textures get a full mip chain built on the CPU, are optionally block compressed (BC7 or BC1/BC3 for color,
+ * BC5 for normal maps) and written to a KTX2 style container in the asset cache: a header, a level index and the level payloads.
+ * Later loads map the container and hand the levels to the GPU as they are, so neither stb, the mip filter nor the compressor runs.
+ * A container is rejected when the source file hash, the configured compression or mip filter, or the container version differ.
+ */
+class TextureCooker
+{
+public:
+	static TextureCooker& getInstance();
+	void init(bool compressionSupported);
+	void destroy();
+
+	bool load(Texture& texture);
+	void cook(Texture& texture);
+
+	std::string getCookedFilename(const std::string& filename);
+
+private:
+	bool isNormalMap(const Texture& texture);
+	ETextureFormat chooseFormat(const Texture& texture);
+	void buildLevels(Texture& texture, ETextureFormat format);
+	uint64_t hashSourceFile(const std::string& filename);
+
+	// RGBA8 when compression is disabled in the config or the device cannot sample BC formats
+	ETextureFormat m_colorFormat = ETextureFormat::RGBA8;
+	EMipmapFilter m_mipmapFilter = EMipmapFilter::Kaiser;
+};
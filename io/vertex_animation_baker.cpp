@@ -0,0 +1,107 @@
+#include "vertex_animation_baker.h"
+#include "config/config_manager.h"
+#include "component/pose_pool.h"
+#include "utility/thread_pool.h"
+
+#include <glm/gtc/packing.hpp>
+
+// the smallest maxImageDimension2D vulkan guarantees
+#define MAX_VERTEX_ANIMATION_SIZE 4096
+
+VertexAnimationBaker& VertexAnimationBaker::getInstance()
+{
+	static VertexAnimationBaker baker;
+	return baker;
+}
+
+void VertexAnimationBaker::init()
+{
+	m_frameRate = ConfigManager::getInstance().getAnimationBakeRate();
+}
+
+void VertexAnimationBaker::destroy()
+{
+
+}
+
+std::shared_ptr<VertexAnimation> VertexAnimationBaker::bake(const SkeletalMesh& mesh, const Skeleton& skeleton,
+	const std::map<std::string, std::shared_ptr<Animation>>& animations)
+{
+	if (m_frameRate <= 0.0f || mesh.vertices.empty() || animations.empty())
+	{
+		return nullptr;
+	}
+
+	auto vertexAnimation = std::make_shared<VertexAnimation>();
+	uint32_t vertexNum = static_cast<uint32_t>(mesh.vertices.size());
+	vertexAnimation->width = std::min(vertexNum, static_cast<uint32_t>(MAX_VERTEX_ANIMATION_SIZE));
+	vertexAnimation->rowsPerFrame = (vertexNum + vertexAnimation->width - 1) / vertexAnimation->width;
+
+	// the clip and sample time of every frame, so the frames can be baked in any order
+	std::vector<std::pair<const Animation*, float>> frames;
+	std::map<const Animation*, std::vector<int>> boneIndices;
+	for (const auto& iter : animations)
+	{
+		const Animation& animation = *iter.second;
+		BakedClip clip;
+		clip.firstFrame = static_cast<uint32_t>(frames.size());
+		clip.frameCount = std::max(static_cast<uint32_t>(std::ceil(animation.duration / animation.frameRate * m_frameRate)), 1u);
+		clip.duration = animation.duration;
+		vertexAnimation->clips[iter.first] = clip;
+
+		boneIndices[&animation] = animation.bind(skeleton);
+		for (uint32_t i = 0; i < clip.frameCount; ++i)
+		{
+			frames.emplace_back(&animation, animation.duration * i / clip.frameCount);
+		}
+	}
+
+	uint32_t frameNum = static_cast<uint32_t>(frames.size());
+	uint32_t frameSize = vertexAnimation->rowsPerFrame * vertexAnimation->width;
+	uint32_t height = frameNum * vertexAnimation->rowsPerFrame * 2;
+	if (height > MAX_VERTEX_ANIMATION_SIZE)
+	{
+		printf("vertex animation of %u frames needs %u rows, more than %d, the mesh is always skinned\n", frameNum, height, MAX_VERTEX_ANIMATION_SIZE);
+		return nullptr;
+	}
+
+	std::shared_ptr<Texture> texture = std::make_shared<Texture>();
+	texture->name = texture->filename = "vertex animation";
+	texture->width = static_cast<int>(vertexAnimation->width);
+	texture->height = static_cast<int>(height);
+	texture->channels = 4;
+	texture->format = ETextureFormat::RGBA16F;
+	texture->srgb = false;
+	texture->levelData.resize(static_cast<size_t>(frameSize) * 2 * frameNum * sizeof(uint64_t));
+	texture->levels.push_back({ vertexAnimation->width, height, 0, texture->levelData.size() });
+	vertexAnimation->texture = texture;
+
+	uint64_t* texels = reinterpret_cast<uint64_t*>(texture->levelData.data());
+	ThreadPool::getInstance().parallelFor(frameNum, [this, &mesh, &skeleton, &frames, &boneIndices, texels, frameSize](uint32_t frame) {
+		const Animation& animation = *frames[frame].first;
+		PoseBuffer pose;
+		pose.reset(skeleton);
+		animation.sample(frames[frame].second, boneIndices.at(&animation), pose.getLocalPoses());
+		skeleton.evaluate(pose.getLocalPoses(), pose.getPalette());
+
+		uint64_t* positions = texels + static_cast<size_t>(frame) * frameSize * 2;
+		skin(mesh, pose.getPalette(), positions, positions + frameSize);
+	});
+	return vertexAnimation;
+}
+
+void VertexAnimationBaker::skin(const SkeletalMesh& mesh, const glm::mat4* palette, uint64_t* positions, uint64_t* normals)
+{
+	// the same weighted sum as the vertex shader, unbound slots read the first bone like the packed vertices do
+	for (size_t i = 0; i < mesh.vertices.size(); ++i)
+	{
+		const SkeletalVertex& vertex = mesh.vertices[i];
+		glm::mat4 transform(0.0f);
+		for (uint32_t j = 0; j < BONE_NUM_PER_VERTEX; ++j)
+		{
+			transform += palette[vertex.bones[j] == INVALID_BONE ? 0 : vertex.bones[j]] * vertex.weights[j];
+		}
+		positions[i] = glm::packHalf4x16(glm::vec4(glm::vec3(transform * glm::vec4(vertex.position, 1.0f)), 1.0f));
+		normals[i] = glm::packHalf4x16(glm::vec4(glm::vec3(transform * glm::vec4(vertex.normal, 0.0f)), 0.0f));
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "component/animation.h"
+#include "component/mesh.h"
+
+/*
+ * Bakes the clips of a skeletal mesh into a vertex animation texture for its distant instances
+ * Every clip is sampled at the configured rate and the mesh is skinned on the CPU with the full matrix palette,
+ * the frames are baked in parallel on the worker threads. A looping clip interpolates from its last frame back to its first.
+ */
+class VertexAnimationBaker
+{
+public:
+	static VertexAnimationBaker& getInstance();
+	void init();
+	void destroy();
+
+	// nullptr when baking is disabled or the frames don't fit in a texture
+	std::shared_ptr<VertexAnimation> bake(const SkeletalMesh& mesh, const Skeleton& skeleton, const std::map<std::string, std::shared_ptr<Animation>>& animations);
+
+private:
+	// skins every vertex with the palette into the position and normal rows of a frame
+	void skin(const SkeletalMesh& mesh, const glm::mat4* palette, uint64_t* positions, uint64_t* normals);
+
+	float m_frameRate;
+};
@@ -0,0 +1,141 @@
+#include "vertex_packer.h"
+#include "config/config_manager.h"
+#include "core/engine_type.h"
+
+#include <glm/gtc/packing.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+	// octahedral mapping of a unit vector onto [-1, 1]^2, the lower hemisphere is folded over the diagonals
+	glm::vec2 encodeOctahedral(glm::vec3 normal)
+	{
+		float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		if (length == 0.0f)
+		{
+			return glm::vec2(0.0f);
+		}
+
+		normal /= length;
+		glm::vec2 encoded(normal.x, normal.y);
+		if (normal.z < 0.0f)
+		{
+			encoded.x = (1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f);
+			encoded.y = (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f);
+		}
+		return encoded;
+	}
+
+	// rounds the weights to unorm8 and gives the rounding error to the largest one, so they still sum to one
+	void packWeights(const glm::vec4& weights, uint8_t packedWeights[4])
+	{
+		float sum = weights.x + weights.y + weights.z + weights.w;
+		float scale = sum > 0.0f ? 255.0f / sum : 0.0f;
+
+		int32_t total = 0;
+		uint32_t largest = 0;
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			packedWeights[i] = static_cast<uint8_t>(std::clamp(weights[i] * scale + 0.5f, 0.0f, 255.0f));
+			total += packedWeights[i];
+			largest = weights[i] > weights[largest] ? i : largest;
+		}
+
+		if (sum > 0.0f)
+		{
+			packedWeights[largest] = static_cast<uint8_t>(std::clamp(packedWeights[largest] + 255 - total, 0, 255));
+		}
+	}
+}
+
+VertexPacker& VertexPacker::getInstance()
+{
+	static VertexPacker packer;
+	return packer;
+}
+
+void VertexPacker::init()
+{
+	std::string positionFormat = ConfigManager::getInstance().getVertexPositionFormat();
+	m_positionFormat = positionFormat == "half" ? EVertexPositionFormat::Half : EVertexPositionFormat::Unorm16;
+}
+
+void VertexPacker::destroy()
+{
+
+}
+
+void VertexPacker::pack(StaticMesh& mesh)
+{
+	packStaticAttributes(mesh.vertices, mesh.packedVertices, mesh.quantization);
+}
+
+void VertexPacker::pack(SkeletalMesh& mesh)
+{
+	packStaticAttributes(mesh.vertices, mesh.packedVertices, mesh.quantization);
+
+	for (size_t i = 0; i < mesh.vertices.size(); ++i)
+	{
+		const SkeletalVertex& vertex = mesh.vertices[i];
+		PackedSkeletalVertex& packedVertex = mesh.packedVertices[i];
+
+		// unused slots point at bone 0 with zero weight
+		for (uint32_t j = 0; j < 4; ++j)
+		{
+			if (vertex.bones[j] > UINT16_MAX)
+			{
+				throw std::runtime_error((boost::format("bone index %d does not fit the packed vertex format") % vertex.bones[j]).str());
+			}
+			packedVertex.bones[j] = vertex.bones[j] == INVALID_BONE ? 0 : static_cast<uint16_t>(vertex.bones[j]);
+		}
+		packWeights(vertex.weights, packedVertex.weights);
+	}
+}
+
+template<typename VertexType, typename PackedVertexType>
+void VertexPacker::packStaticAttributes(const std::vector<VertexType>& vertices, std::vector<PackedVertexType>& packedVertices, VertexQuantization& quantization)
+{
+	glm::vec3 boundsMin(std::numeric_limits<float>::max());
+	glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+	for (const VertexType& vertex : vertices)
+	{
+		boundsMin = glm::min(boundsMin, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+	}
+
+	// a flat axis keeps a tiny extent so the division stays finite
+	glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+	if (m_positionFormat == EVertexPositionFormat::Half)
+	{
+		quantization.scale = extent * 0.5f;
+		quantization.offset = (boundsMin + boundsMax) * 0.5f;
+	}
+	else
+	{
+		quantization.scale = extent;
+		quantization.offset = boundsMin;
+	}
+
+	packedVertices.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const VertexType& vertex = vertices[i];
+		PackedVertexType& packedVertex = packedVertices[i];
+
+		glm::vec3 position = (vertex.position - quantization.offset) / quantization.scale;
+		for (uint32_t j = 0; j < 3; ++j)
+		{
+			packedVertex.position[j] = m_positionFormat == EVertexPositionFormat::Half ? glm::packHalf1x16(position[j]) : glm::packUnorm1x16(position[j]);
+		}
+		packedVertex.position[3] = 0;
+
+		packedVertex.texCoord[0] = glm::packHalf1x16(vertex.texCoord.x);
+		packedVertex.texCoord[1] = glm::packHalf1x16(vertex.texCoord.y);
+
+		glm::vec2 normal = encodeOctahedral(vertex.normal);
+		packedVertex.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(normal.x));
+		packedVertex.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(normal.y));
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "component/mesh.h"
+
+/*
+ * Vertex quantization
+ * Imported meshes keep their float vertices for CPU side processing, the GPU only gets the packed copy:
+ * 16 byte static vertices and 28 byte skeletal vertices instead of 32 and 64.
+ * Positions are stored as unorm16 across the mesh bounds or as half relative to the bounds center,
+ * UVs as half, normals as octahedral snorm16, bone indices as uint16 since skeletons may have more than 255 bones, and weights as unorm8.
+ */
+class VertexPacker
+{
+public:
+	static VertexPacker& getInstance();
+	void init();
+	void destroy();
+
+	void pack(StaticMesh& mesh);
+	void pack(SkeletalMesh& mesh);
+
+	EVertexPositionFormat getPositionFormat() { return m_positionFormat; }
+
+private:
+	template<typename VertexType, typename PackedVertexType>
+	void packStaticAttributes(const std::vector<VertexType>& vertices, std::vector<PackedVertexType>& packedVertices, VertexQuantization& quantization);
+
+	EVertexPositionFormat m_positionFormat = EVertexPositionFormat::Unorm16;
+};
@@ -12,15 +12,32 @@ struct StaticMeshUBO
 	glm::mat4 padding;
 };
 
-struct SkeletalMeshUBO
-{
-	glm::mat4 gBones[MAX_BONE_NUM];
-};
-
 struct VPCO
 {
 	glm::mat4 m;
 	glm::mat4 mvp;
+
+	// dequantization of the packed vertex positions, w is padding
+	glm::vec4 positionScale;
+	glm::vec4 positionOffset;
+};
+
+// instanced skeletal meshes take their model matrices from a storage buffer, only the camera is pushed
+struct SkeletalVPCO
+{
+	glm::mat4 viewProjection;
+	glm::vec4 positionScale;
+	glm::vec4 positionOffset;
+
+	// vec4s of one instance's bone palette
+	uint32_t paletteStride; uint32_t p0; uint32_t p1; uint32_t p2;
+};
+
+// baked positions and normals need no dequantization, only the texture layout is pushed
+struct VertexAnimationVPCO
+{
+	glm::mat4 viewProjection;
+	uint32_t textureWidth; uint32_t rowsPerFrame; uint32_t p0; uint32_t p1;
 };
 
 struct FPCO
@@ -31,8 +48,8 @@ struct FPCO
 
 struct VmaBuffer
 {
-	VkBuffer buffer;
-	VmaAllocation allocation;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VmaAllocation allocation = VK_NULL_HANDLE;
 
 	void destroy(VmaAllocator allocator)
 	{
@@ -42,8 +59,9 @@ struct VmaBuffer
 
 struct VmaImage
 {
-	VkImage image;
-	VmaAllocation allocation;
+	VkImage image = VK_NULL_HANDLE;
+	VmaAllocation allocation = VK_NULL_HANDLE;
+	VkFormat format;
 	uint32_t mipLevels;
 
 	void destroy(VmaAllocator allocator)
@@ -67,8 +85,8 @@ struct VmaImageView
 struct VmaImageViewSampler
 {
 	VmaImage vmaImage;
-	VkImageView view;
-	VkSampler sampler;
+	VkImageView view = VK_NULL_HANDLE;
+	VkSampler sampler = VK_NULL_HANDLE;
 
 	void destroy(VkDevice device, VmaAllocator allocator)
 	{
@@ -78,15 +96,43 @@ struct VmaImageViewSampler
 	}
 };
 
+struct IndexRange
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+};
+
 struct BatchResource 
 {
 	VmaBuffer vertexBuffer;
 	VmaBuffer indexBuffer;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+
+	// cumulative index count and vertex offset of each section
 	std::vector<uint32_t> indexCounts;
+	std::vector<uint32_t> baseVertices;
+
+	// cumulative index counts of the simplified levels, each continuing where the previous level ends
+	std::vector<std::vector<uint32_t>> lodIndexCounts;
+	uint32_t lod = 0;
+
+	// visible meshlet ranges of each section at full detail, merged where they touch, whole sections are drawn when empty
+	std::vector<std::vector<IndexRange>> visibleRanges;
 
 	std::vector<VmaBuffer> uniformBuffers;
 	std::vector<VkDescriptorSet> descriptorSets;
 
+	// instances drawn by every draw of the batch, instanced batches set it each frame
+	uint32_t instanceCount = 1;
+
+	// streamed batches are skipped by the renderer until their geometry is resident,
+	// and sample the placeholder texture until their textures are
+	bool resident = true;
+	bool texturesResident = true;
+
+	// one bit per swapchain image whose descriptor sets must be rewritten before it is recorded again
+	uint32_t dirtyDescriptorMask = 0;
+
 	virtual void destroy(VkDevice device, VmaAllocator allocator)
 	{
 		for (VmaBuffer& uniformBuffer : uniformBuffers)
@@ -115,4 +161,70 @@ struct BasicBatchResource : public BatchResource
 		}
 		BatchResource::destroy(device, allocator);
 	}
+};
+
+/*
+ * All instances of one skeletal mesh, drawn with one instanced draw per section
+ * The scene gathers the model matrix and bone palette of every visible instance each frame, the pipeline uploads them
+ * to storage buffers which the vertex shader indexes by gl_InstanceIndex.
+ */
+struct SkeletalBatchResource : public BasicBatchResource
+{
+	// the shared SkeletalMesh, and the components drawing it
+	const void* mesh = nullptr;
+	uint32_t userCount = 0;
+
+	// vec4s of one instance palette, and the palette of the bind pose for instances without an animator
+	uint32_t paletteStride = 0;
+	std::vector<glm::vec4> bindPalette;
+
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	std::vector<glm::mat4> instanceMatrices;
+	std::vector<glm::vec4> instancePalettes;
+
+	// one pair per swapchain image, grown when the instances outnumber their capacity
+	std::vector<VmaBuffer> instanceBuffers;
+	std::vector<VmaBuffer> paletteBuffers;
+	std::vector<uint32_t> instanceCapacities;
+
+	// starts the instances of a frame, the coarsest level is refined by the instances added
+	void clearInstances()
+	{
+		instanceMatrices.clear();
+		instancePalettes.clear();
+		lod = static_cast<uint32_t>(lodIndexCounts.size());
+	}
+
+	virtual void destroy(VkDevice device, VmaAllocator allocator)
+	{
+		for (size_t i = 0; i < instanceBuffers.size(); ++i)
+		{
+			instanceBuffers[i].destroy(allocator);
+			paletteBuffers[i].destroy(allocator);
+		}
+		BasicBatchResource::destroy(device, allocator);
+	}
+};
+
+/*
+ * Distant instances of one skeletal mesh, playing baked clips from its vertex animation texture
+ * The geometry and base textures belong to the skinned batch of the mesh. The palette of an instance is a single vec4
+ * holding the two frames it blends and the weight of the second.
+ */
+struct VertexAnimationBatchResource : public SkeletalBatchResource
+{
+	uint32_t textureWidth = 0;
+	uint32_t rowsPerFrame = 0;
+	VmaImageViewSampler animationIVS;
+
+	virtual void destroy(VkDevice device, VmaAllocator allocator)
+	{
+		animationIVS.destroy(device, allocator);
+
+		// the skinned batch destroys the shared resources
+		vertexBuffer = VmaBuffer();
+		indexBuffer = VmaBuffer();
+		baseIVSs.clear();
+		SkeletalBatchResource::destroy(device, allocator);
+	}
 };
\ No newline at end of file
@@ -195,6 +195,7 @@ void GraphicsBackend::pickPhysicalDevice()
 
 	// physical device
 	vkGetPhysicalDeviceProperties(m_physicalDevice, &m_physicalDeviceProperties);
+	vkGetPhysicalDeviceFeatures(m_physicalDevice, &m_physicalDeviceFeatures);
 	m_queueFamilyIndices = queryQueueFamilies(m_physicalDevice);
 	m_msaaSamples = queryMaxSampleCount();
 }
@@ -203,14 +204,15 @@ void GraphicsBackend::createLogicalDevice()
 {
 	// create queue
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	std::set<uint32_t> uniqueQueueFamilies = { m_queueFamilyIndices.graphicsFamily.value(), m_queueFamilyIndices.presentFamily.value() };
+	std::set<uint32_t> uniqueQueueFamilies = { m_queueFamilyIndices.graphicsFamily.value(), m_queueFamilyIndices.presentFamily.value(),
+		m_queueFamilyIndices.transferFamily.value() };
 
 	float queuePriority = 1.0f;
 	for (uint32_t queueFamily : uniqueQueueFamilies)
 	{
 		VkDeviceQueueCreateInfo queueCreateInfo{};
 		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		queueCreateInfo.queueFamilyIndex = m_queueFamilyIndices.graphicsFamily.value();
+		queueCreateInfo.queueFamilyIndex = queueFamily;
 		queueCreateInfo.queueCount = 1;
 		queueCreateInfo.pQueuePriorities = &queuePriority;
 
@@ -227,6 +229,7 @@ void GraphicsBackend::createLogicalDevice()
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 	deviceFeatures.sampleRateShading = VK_TRUE;
+	deviceFeatures.textureCompressionBC = m_physicalDeviceFeatures.textureCompressionBC;
 	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 
 	// set extension
@@ -252,6 +255,7 @@ void GraphicsBackend::createLogicalDevice()
 	// get queue
 	vkGetDeviceQueue(m_device, m_queueFamilyIndices.graphicsFamily.value(), 0, &m_graphicsQueue);
 	vkGetDeviceQueue(m_device, m_queueFamilyIndices.presentFamily.value(), 0, &m_presentQueue);
+	vkGetDeviceQueue(m_device, m_queueFamilyIndices.transferFamily.value(), 0, &m_transferQueue);
 }
 
 void GraphicsBackend::createVmaAllocator()
@@ -381,7 +385,7 @@ QueueFamilyIndices GraphicsBackend::queryQueueFamilies(VkPhysicalDevice physical
 
 	for (uint32_t i = 0; i < queueFamilyCount; ++i)
 	{
-		if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		if (!m_indices.graphicsFamily.has_value() && (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
 		{
 			m_indices.graphicsFamily = i;
 		}
@@ -389,17 +393,28 @@ QueueFamilyIndices GraphicsBackend::queryQueueFamilies(VkPhysicalDevice physical
 		VkBool32 presentSupport = false;
 		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, m_surface, &presentSupport);
 
-		if (presentSupport)
+		if (!m_indices.presentFamily.has_value() && presentSupport)
 		{
 			m_indices.presentFamily = i;
 		}
 
-		if (m_indices.isComplete())
+		// prefer the DMA family that does nothing but transfers, then any non graphics family that can transfer
+		VkQueueFlags flags = queueFamilies[i].queueFlags;
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
 		{
-			break;
+			bool dedicated = !(flags & VK_QUEUE_COMPUTE_BIT);
+			if (!m_indices.transferFamily.has_value() || (dedicated && (queueFamilies[m_indices.transferFamily.value()].queueFlags & VK_QUEUE_COMPUTE_BIT)))
+			{
+				m_indices.transferFamily = i;
+			}
 		}
 	}
 
+	if (!m_indices.transferFamily.has_value())
+	{
+		m_indices.transferFamily = m_indices.graphicsFamily;
+	}
+
 	return m_indices;
 }
 
@@ -17,6 +17,9 @@ struct QueueFamilyIndices
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
 
+	// a transfer only family when the device has one, otherwise the graphics family
+	std::optional<uint32_t> transferFamily;
+
 	bool isComplete() const
 	{
 		return graphicsFamily.has_value() && presentFamily.has_value();
@@ -49,12 +52,14 @@ public:
 	VmaAllocator getAllocator() { return m_vmaAllocator; }
 	VkQueue getGraphicsQueue() { return m_graphicsQueue; }
 	VkQueue getPresentQueue() { return m_presentQueue; }
+	VkQueue getTransferQueue() { return m_transferQueue; }
 
 	const VkPhysicalDeviceProperties& getPhysicalDeviceProperties() { return m_physicalDeviceProperties; }
 	SwapChainSupportDetails getSwapChainSupport();
 	const QueueFamilyIndices& getQueueFamilyIndices() { return m_queueFamilyIndices; }
 	VkFormat getSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 	VkSampleCountFlagBits getMsaaSamples() { return m_msaaSamples; }
+	bool isTextureCompressionBCSupported() { return m_physicalDeviceFeatures.textureCompressionBC == VK_TRUE; }
 
 	void setOnFramebufferResized(std::function<void(uint32_t, uint32_t)> onFramebufferResized) { m_onFramebufferResized = onFramebufferResized; }
 
@@ -92,8 +97,10 @@ private:
 	VmaAllocator m_vmaAllocator;
 	VkQueue m_graphicsQueue;
 	VkQueue m_presentQueue;
+	VkQueue m_transferQueue;
 	
 	VkPhysicalDeviceProperties m_physicalDeviceProperties;
+	VkPhysicalDeviceFeatures m_physicalDeviceFeatures;
 	QueueFamilyIndices m_queueFamilyIndices;
 
 	VkSampleCountFlagBits m_msaaSamples;
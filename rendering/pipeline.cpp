@@ -29,6 +29,45 @@ void Pipeline::unregisterBatchResource(std::shared_ptr<BatchResource> batchResou
 	m_batchResources.erase(batchResource);
 }
 
+void Pipeline::refreshDescriptorSets(uint32_t imageIndex)
+{
+	uint32_t imageBit = 1u << imageIndex;
+	for (const std::shared_ptr<BatchResource>& batchResource : m_batchResources)
+	{
+		if (batchResource->dirtyDescriptorMask & imageBit)
+		{
+			writeDescriptorSets(batchResource, imageIndex);
+			batchResource->dirtyDescriptorMask &= ~imageBit;
+		}
+	}
+}
+
+void Pipeline::createDescriptorSets(std::shared_ptr<BatchResource> batchResource)
+{
+	uint32_t sectionCount = static_cast<uint32_t>(batchResource->indexCounts.size());
+	uint32_t descriptorSetSize = SWAPCHAIN_IMAGE_NUM * sectionCount;
+
+	std::vector<VkDescriptorSetLayout> layouts(descriptorSetSize, m_descriptorSetLayout);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_descriptorPool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+	allocInfo.pSetLayouts = layouts.data();
+
+	batchResource->descriptorSets.resize(descriptorSetSize);
+	if (vkAllocateDescriptorSets(m_backend->getDevice(), &allocInfo, batchResource->descriptorSets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate descriptor sets!");
+	}
+
+	for (uint32_t i = 0; i < SWAPCHAIN_IMAGE_NUM; ++i)
+	{
+		writeDescriptorSets(batchResource, i);
+	}
+	batchResource->dirtyDescriptorMask = 0;
+}
+
 void Pipeline::createPipeline()
 {
 	// Input Assembly
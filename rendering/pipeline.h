@@ -20,6 +20,9 @@ public:
 	void registerBatchResource(std::shared_ptr<BatchResource> batchResource);
 	void unregisterBatchResource(std::shared_ptr<BatchResource> batchResource);
 
+	// rewrites the descriptor sets of the batches marked dirty for this swapchain image
+	void refreshDescriptorSets(uint32_t imageIndex);
+
 	virtual void pushConstants(VkCommandBuffer commandBuffer, std::shared_ptr<BatchResource> batchResource) = 0;
 
 protected:
@@ -30,7 +33,7 @@ protected:
 	virtual VkPipelineVertexInputStateCreateInfo createVertexInputState() = 0;
 	virtual std::vector<VkPushConstantRange> createPushConstantRanges() = 0;
 
-	virtual void createDescriptorSets(std::shared_ptr<BatchResource> batchResource) = 0;
+	virtual void writeDescriptorSets(std::shared_ptr<BatchResource> batchResource, uint32_t imageIndex) = 0;
 
 	std::shared_ptr<class GraphicsBackend> m_backend;
 	VkRenderPass m_renderPass;
@@ -47,6 +50,7 @@ protected:
 
 private:
 	void createPipeline();
+	void createDescriptorSets(std::shared_ptr<BatchResource> batchResource);
 
 	std::set<std::shared_ptr<BatchResource>> m_batchResources;
 };
\ No newline at end of file
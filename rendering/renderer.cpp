@@ -13,10 +13,13 @@ void Renderer::init(std::shared_ptr<GraphicsBackend>& backend)
 
 	auto staticMeshPipeline = std::make_shared<StaticMeshPipeline>();
 	auto skeletalMeshPipeline = std::make_shared<SkeletalMeshPipeline>();
+	auto vertexAnimationPipeline = std::make_shared<VertexAnimationPipeline>();
 	staticMeshPipeline->init(backend, m_renderPass.get());
 	skeletalMeshPipeline->init(backend, m_renderPass.get());
+	vertexAnimationPipeline->init(backend, m_renderPass.get());
 	m_pipelines[EPipelineType::StaticMesh] = staticMeshPipeline;
 	m_pipelines[EPipelineType::SkeletalMesh] = skeletalMeshPipeline;
+	m_pipelines[EPipelineType::VertexAnimation] = vertexAnimationPipeline;
 
 	createCommandPool();
 	createMsaaResources();
@@ -68,13 +71,24 @@ void Renderer::wait()
 	// ǰImageڱCPUύݣȴCPU
 	if (m_imagesInFlight[m_imageIndex] != VK_NULL_HANDLE)
 	{
-		vkWaitForFences(m_backend->getDevice(), 1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
+		// the image may have been submitted by another frame in flight, its buffers and descriptor sets are only free once that fence signals
+		vkWaitForFences(m_backend->getDevice(), 1, &m_imagesInFlight[m_imageIndex], VK_TRUE, UINT64_MAX);
 	}
 	m_imagesInFlight[m_imageIndex] = m_inFlightFences[m_currentFrame];
 }
 
 void Renderer::update()
 {
+	// the previous submit of this image has finished, so its instance buffers and descriptor sets can be rewritten
+	for (EPipelineType pipelineType : { EPipelineType::SkeletalMesh, EPipelineType::VertexAnimation })
+	{
+		std::static_pointer_cast<SkeletalMeshPipeline>(m_pipelines[pipelineType])->uploadInstances(m_imageIndex);
+	}
+	for (const auto& iter : m_pipelines)
+	{
+		iter.second->refreshDescriptorSets(m_imageIndex);
+	}
+
 	VkCommandBuffer commandBuffer = m_commandBuffers[m_imageIndex];
 	vkResetCommandBuffer(commandBuffer, 0);
 
@@ -131,23 +145,41 @@ void Renderer::update()
 		auto& batchResources = pipeline->getBatchResources();
 		for (auto& batchResource : batchResources)
 		{
+			if (!batchResource->resident || batchResource->instanceCount == 0)
+			{
+				continue;
+			}
+
 			VkBuffer vertexBuffers[] = { batchResource->vertexBuffer.buffer };
 			VkDeviceSize offsets[] = { 0 };
 			vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-			vkCmdBindIndexBuffer(commandBuffer, batchResource->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(commandBuffer, batchResource->indexBuffer.buffer, 0, batchResource->indexType);
 
 			pipeline->pushConstants(commandBuffer, batchResource);
 
-			std::vector<uint32_t>& indexCounts = batchResource->indexCounts;
+			// simplified levels are drawn with the same vertices, their index ranges follow the full detail sections
+			uint32_t lod = batchResource->lod;
+			std::vector<uint32_t>& indexCounts = lod == 0 ? batchResource->indexCounts : batchResource->lodIndexCounts[lod - 1];
 			size_t sectionCount = indexCounts.size();
-			uint32_t indexOffset = 0;
+			uint32_t indexOffset = lod == 0 ? 0 : (lod == 1 ? batchResource->indexCounts.back() : batchResource->lodIndexCounts[lod - 2].back());
 			for (size_t j = 0; j < sectionCount; ++j)
 			{
 				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(),
 					0, 1, &batchResource->descriptorSets[m_imageIndex * sectionCount + j], 0, nullptr);
 
+				// cluster culled sections only draw their visible meshlets
+				if (!batchResource->visibleRanges.empty())
+				{
+					for (const IndexRange& range : batchResource->visibleRanges[j])
+					{
+						vkCmdDrawIndexed(commandBuffer, range.indexCount, batchResource->instanceCount, range.firstIndex, static_cast<int32_t>(batchResource->baseVertices[j]), 0);
+					}
+					indexOffset = indexCounts[j];
+					continue;
+				}
+
 				uint32_t indexCount = indexCounts[j] - indexOffset;
-				vkCmdDrawIndexed(commandBuffer, indexCount, 1, indexOffset, 0, 0);
+				vkCmdDrawIndexed(commandBuffer, indexCount, batchResource->instanceCount, indexOffset, static_cast<int32_t>(batchResource->baseVertices[j]), 0);
 				indexOffset = indexCounts[j];
 			}
 		}
@@ -7,6 +7,7 @@
 #include "framebuffer.h"
 #include "static_mesh_pipeline.h"
 #include "skeletal_mesh_pipeline.h"
+#include "vertex_animation_pipeline.h"
 
 class Renderer
 {
@@ -2,6 +2,7 @@
 #include "graphics_backend.h"
 
 #include <stb_image/stb_image.h>
+#include <boost/format.hpp>
 
 ResourceFactory& ResourceFactory::getInstance()
 {
@@ -19,104 +20,97 @@ void ResourceFactory::init(std::shared_ptr<GraphicsBackend>& backend)
 
 void ResourceFactory::destroy()
 {
+	flushUploadBatches(true);
 	vkDestroyCommandPool(m_backend->getDevice(), m_instantCommandPool, nullptr);
 }
 
-void ResourceFactory::createVertexBuffer(uint32_t bufferSize, void* verticesData, VmaBuffer& vertexBuffer)
+void ResourceFactory::createVertexBuffer(UploadBatch& uploadBatch, uint32_t bufferSize, void* verticesData, VmaBuffer& vertexBuffer)
 {
-	VmaBuffer stagingBuffer;
-	createBuffer(bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VMA_MEMORY_USAGE_CPU_ONLY,
-		stagingBuffer);
-
-	// Vertex Buffer Memory
-	// mapGPUڴӳ䵽CPUϣCPU޸ģunmap֮
-	// ڴ濽ȷһvkQueueCommitǰһ
-	void* data;
-	vmaMapMemory(m_backend->getAllocator(), stagingBuffer.allocation, &data);
-	memcpy(data, verticesData, static_cast<size_t>(bufferSize));
-	vmaUnmapMemory(m_backend->getAllocator(), stagingBuffer.allocation);
-
-	createBuffer(bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-		VMA_MEMORY_USAGE_GPU_ONLY,
-		vertexBuffer);
-
-	copyBuffer(stagingBuffer.buffer, vertexBuffer.buffer, bufferSize);
-
-	vmaDestroyBuffer(m_backend->getAllocator(), stagingBuffer.buffer, stagingBuffer.allocation);
+	uploadBatch.uploadBuffer(verticesData, bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer);
 }
 
-void ResourceFactory::createIndexBuffer(const std::vector<uint32_t>& indices, VmaBuffer& indexBuffer)
+void ResourceFactory::createIndexBuffer(UploadBatch& uploadBatch, const std::vector<uint32_t>& indices, EIndexType indexType, VmaBuffer& indexBuffer)
 {
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-	VmaBuffer stagingBuffer;
-	createBuffer(bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VMA_MEMORY_USAGE_CPU_ONLY,
-		stagingBuffer);
-
-	// Vertex Buffer Memory
-	// mapGPUڴӳ䵽CPUϣCPU޸ģunmap֮
-	// ڴ濽ȷһvkQueueCommitǰһ
-	void* data;
-	vmaMapMemory(m_backend->getAllocator(), stagingBuffer.allocation, &data);
-	memcpy(data, indices.data(), static_cast<size_t>(bufferSize));
-	vmaUnmapMemory(m_backend->getAllocator(), stagingBuffer.allocation);
-
-	createBuffer(bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-		VMA_MEMORY_USAGE_GPU_ONLY,
-		indexBuffer);
-
-	copyBuffer(stagingBuffer.buffer, indexBuffer.buffer, bufferSize);
-
-	vmaDestroyBuffer(m_backend->getAllocator(), stagingBuffer.buffer, stagingBuffer.allocation);
+	if (indexType == EIndexType::Uint32)
+	{
+		VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+		uploadBatch.uploadBuffer(indices.data(), bufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer);
+		return;
+	}
+
+	// narrowed here, the staging copy is the only 16 bit copy on the CPU
+	std::vector<uint16_t> shortIndices(indices.size());
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		shortIndices[i] = static_cast<uint16_t>(indices[i]);
+	}
+	VkDeviceSize bufferSize = sizeof(shortIndices[0]) * shortIndices.size();
+	uploadBatch.uploadBuffer(shortIndices.data(), bufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer);
 }
 
-void ResourceFactory::createTextureImage(std::shared_ptr<Texture>& texture, VmaImage& image)
+VkIndexType ResourceFactory::getIndexType(EIndexType indexType)
 {
-	int width = texture->width;
-	int height = texture->height;
+	return indexType == EIndexType::Uint16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
 
-	VkDeviceSize imageSize = width * height * 4;
-	uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
-	image.mipLevels = mipLevels;
+void ResourceFactory::createTextureImage(UploadBatch& uploadBatch, std::shared_ptr<Texture>& texture, VmaImage& image)
+{
+	// mip levels are precomputed at cook time, the GPU only copies them
+	if (texture->levels.empty())
+	{
+		throw std::runtime_error((boost::format("texture has no precomputed levels: %s") % texture->filename).str());
+	}
 
-	// staging buffer
-	VmaBuffer stagingBuffer;
-	createBuffer(imageSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VMA_MEMORY_USAGE_CPU_ONLY,
-		stagingBuffer);
+	uploadBatch.uploadTexture(*texture, getTextureFormat(texture->format, texture->srgb), image);
+}
 
-	// ͼƬݿstaging buffer
-	void* data;
-	vmaMapMemory(m_backend->getAllocator(), stagingBuffer.allocation, &data);
-	memcpy(data, texture->data, static_cast<size_t>(imageSize));
-	vmaUnmapMemory(m_backend->getAllocator(), stagingBuffer.allocation);
+std::shared_ptr<UploadBatch> ResourceFactory::createUploadBatch()
+{
+	return std::make_shared<UploadBatch>(m_backend);
+}
 
-	// ͼƬ
-	//stbi_image_free(texture.data);
+void ResourceFactory::submitUploadBatch(std::shared_ptr<UploadBatch>& uploadBatch)
+{
+	uploadBatch->submit();
+	m_pendingUploadBatches.push_back(uploadBatch);
+	m_uploadStats.submitCount++;
+}
 
-	// Image
-	createImage(static_cast<uint32_t>(width), static_cast<uint32_t>(height), mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_GPU_ONLY,
-		image);
+void ResourceFactory::flushUploadBatches(bool wait)
+{
+	for (auto iter = m_pendingUploadBatches.begin(); iter != m_pendingUploadBatches.end();)
+	{
+		std::shared_ptr<UploadBatch>& uploadBatch = *iter;
+		if (wait)
+		{
+			uploadBatch->wait();
+		}
 
-	// imageתƵDST_OPT״̬һڴ濽
-	transitionImageLayout(image.image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+		if (!uploadBatch->isComplete())
+		{
+			++iter;
+			continue;
+		}
 
-	// staging bufferimage
-	copyBufferToImage(stagingBuffer.buffer, image.image, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+		m_uploadStats.uploadCount += uploadBatch->getUploadCount();
+		m_uploadStats.bytes += uploadBatch->getByteCount();
+		m_uploadStats.uploadTime += uploadBatch->getElapsedTime();
 
-	// staging bufferԴ
-	vmaDestroyBuffer(m_backend->getAllocator(), stagingBuffer.buffer, stagingBuffer.allocation);
+		iter = m_pendingUploadBatches.erase(iter);
+	}
+}
 
-	// mipmapimageתƵREAD_ONLY_OPT״̬shaderз
-	generateMipmaps(image.image, VK_FORMAT_R8G8B8A8_SRGB, width, height, mipLevels);
+VkFormat ResourceFactory::getTextureFormat(ETextureFormat format, bool srgb)
+{
+	switch (format)
+	{
+	case ETextureFormat::BC1: return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case ETextureFormat::BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+	case ETextureFormat::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+	case ETextureFormat::BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+	case ETextureFormat::RGBA16F: return VK_FORMAT_R16G16B16A16_SFLOAT;
+	default: return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	}
 }
 
 VkImageView ResourceFactory::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels)
@@ -194,6 +188,7 @@ void ResourceFactory::createImage(uint32_t width, uint32_t height, uint32_t mipL
 	allocInfo.usage = memoryUsage;
 
 	vmaCreateImage(m_backend->getAllocator(), &imageInfo, &allocInfo, &image.image, &image.allocation, nullptr);
+	image.format = format;
 }
 
 void ResourceFactory::createBuffer(VkDeviceSize size, VkBufferUsageFlags bufferUsage, VmaMemoryUsage memoryUsage, VmaBuffer& buffer)
@@ -319,117 +314,6 @@ void ResourceFactory::transitionImageLayout(VkImage image, VkFormat format, VkIm
 	endInstantCommands(commandBuffer);
 }
 
-void ResourceFactory::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
-{
-	VkCommandBuffer commandBuffer = beginInstantCommands();
-
-	VkBufferImageCopy  region{};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-
-	region.imageOffset = { 0, 0, 0 };
-	region.imageExtent = { width, height, 1 };
-
-	vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-	endInstantCommands(commandBuffer);
-}
-
-void ResourceFactory::generateMipmaps(VkImage image, VkFormat imageFormat, uint32_t width, uint32_t height, uint32_t mipLevels)
-{
-	// Check if image format supports linear blitting
-	VkFormatProperties formatProperties;
-	vkGetPhysicalDeviceFormatProperties(m_backend->getPhysicalDevice(), imageFormat, &formatProperties);
-	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
-	{
-		throw std::runtime_error("texture image format does not support linear blitting!");
-	}
-
-	VkCommandBuffer commandBuffer = beginInstantCommands();
-
-	VkImageMemoryBarrier barrier{};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.image = image;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-	barrier.subresourceRange.levelCount = 1;
-
-	int32_t mipWidth = width;
-	int32_t mipHeight = height;
-
-	for (uint32_t i = 1; i < mipLevels; ++i)
-	{
-		barrier.subresourceRange.baseMipLevel = i - 1;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-		vkCmdPipelineBarrier(commandBuffer,
-			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier);
-
-		VkImageBlit blit{};
-		blit.srcOffsets[0] = { 0, 0, 0 };
-		blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.srcSubresource.mipLevel = i - 1;
-		blit.srcSubresource.baseArrayLayer = 0;
-		blit.srcSubresource.layerCount = 1;
-		blit.dstOffsets[0] = { 0, 0, 0 };
-		blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth >> 1 : 1, mipHeight > 1 ? mipHeight >> 1 : 1, 1 };
-		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.dstSubresource.mipLevel = i;
-		blit.dstSubresource.baseArrayLayer = 0;
-		blit.dstSubresource.layerCount = 1;
-
-		vkCmdBlitImage(commandBuffer,
-			image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1, &blit,
-			VK_FILTER_LINEAR);
-
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		vkCmdPipelineBarrier(commandBuffer,
-			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier);
-
-		if (mipWidth > 1) mipWidth >>= 1;
-		if (mipHeight > 1) mipHeight >>= 1;
-	}
-
-	barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-	vkCmdPipelineBarrier(commandBuffer,
-		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-		0, nullptr,
-		0, nullptr,
-		1, &barrier);
-
-	endInstantCommands(commandBuffer);
-}
-
 void ResourceFactory::createInstantCommandPool()
 {
 	VkCommandPoolCreateInfo poolInfo{};
@@ -1,7 +1,23 @@
 #pragma once
 
 #include "rendering/batch_resource.h"
+#include "rendering/upload_batch.h"
 #include "component/material.h"
+#include "component/mesh.h"
+
+#include <list>
+
+struct UploadStats
+{
+	uint32_t submitCount = 0;
+	uint32_t uploadCount = 0;
+	VkDeviceSize bytes = 0;
+
+	// summed time from submit until the batch fence was seen signaled
+	float uploadTime = 0.0f;
+
+	float getBytesPerSecond() const { return uploadTime > 0.0f ? bytes / uploadTime : 0.0f; }
+};
 
 class ResourceFactory
 {
@@ -10,9 +26,11 @@ public:
 	void init(std::shared_ptr<class GraphicsBackend>& backend);
 	void destroy();
 
-	void createVertexBuffer(uint32_t bufferSize, void* verticesData, VmaBuffer& vertexBuffer);
-	void createIndexBuffer(const std::vector<uint32_t>& indices, VmaBuffer& indexBuffer);
-	void createTextureImage(std::shared_ptr<Texture>& texture, VmaImage& image);
+	void createVertexBuffer(UploadBatch& uploadBatch, uint32_t bufferSize, void* verticesData, VmaBuffer& vertexBuffer);
+	void createIndexBuffer(UploadBatch& uploadBatch, const std::vector<uint32_t>& indices, EIndexType indexType, VmaBuffer& indexBuffer);
+	void createTextureImage(UploadBatch& uploadBatch, std::shared_ptr<Texture>& texture, VmaImage& image);
+	VkFormat getTextureFormat(ETextureFormat format, bool srgb);
+	VkIndexType getIndexType(EIndexType indexType);
 	
 	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
 	VkSampler createSampler(VkFilter minFilter, VkFilter maxFilter, VkSamplerAddressMode adressMode, uint32_t mipLevels);
@@ -26,9 +44,14 @@ public:
 
 	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
 
+	// resources created through a batch may only be used once the batch has been submitted,
+	// finished batches free their staging memory in flushUploadBatches, which runs once per frame
+	std::shared_ptr<UploadBatch> createUploadBatch();
+	void submitUploadBatch(std::shared_ptr<UploadBatch>& uploadBatch);
+	void flushUploadBatches(bool wait = false);
+	const UploadStats& getUploadStats() { return m_uploadStats; }
+
 private:
-	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-	void generateMipmaps(VkImage image, VkFormat imageFormat, uint32_t width, uint32_t height, uint32_t mipLevels);
 
 	void createInstantCommandPool();
 	VkCommandBuffer beginInstantCommands();
@@ -36,4 +59,7 @@ private:
 
 	std::shared_ptr<class GraphicsBackend> m_backend;
 	VkCommandPool m_instantCommandPool;
+
+	std::list<std::shared_ptr<UploadBatch>> m_pendingUploadBatches;
+	UploadStats m_uploadStats;
 };
\ No newline at end of file
@@ -1,10 +1,22 @@
 #include "skeletal_mesh_pipeline.h"
+#include "resource_factory.h"
+#include "streaming_service.h"
+#include "io/vertex_packer.h"
+#include "component/animation_kernels.h"
+
+#define SKELETAL_INSTANCE_CAPACITY 16
 
 void SkeletalMeshPipeline::pushConstants(VkCommandBuffer commandBuffer, std::shared_ptr<BatchResource> batchResource)
 {
-	BasicBatchResource* batch = (BasicBatchResource*)batchResource.get();
+	SkeletalBatchResource* batch = (SkeletalBatchResource*)batchResource.get();
+
+	SkeletalVPCO vpco{};
+	vpco.viewProjection = batch->viewProjection;
+	vpco.positionScale = batch->vpco.positionScale;
+	vpco.positionOffset = batch->vpco.positionOffset;
+	vpco.paletteStride = batch->paletteStride;
 
-	const void* pcos[] = { &batch->vpco, &batch->fpco };
+	const void* pcos[] = { &vpco, &batch->fpco };
 	for (size_t i = 0; i < m_pushConstantRanges.size(); ++i)
 	{
 		const VkPushConstantRange& pushConstantRange = m_pushConstantRanges[i];
@@ -12,78 +24,139 @@ void SkeletalMeshPipeline::pushConstants(VkCommandBuffer commandBuffer, std::sha
 	}
 }
 
-void SkeletalMeshPipeline::createDescriptorSets(std::shared_ptr<BatchResource> batchResource)
+std::shared_ptr<SkeletalBatchResource> SkeletalMeshPipeline::findBatchResource(const void* mesh)
 {
-	BasicBatchResource* batch = (BasicBatchResource*)batchResource.get();
-	uint32_t sectionCount = static_cast<uint32_t>(batch->indexCounts.size());
-	uint32_t descriptorSetSize = SWAPCHAIN_IMAGE_NUM * sectionCount;
-
-	std::vector<VkDescriptorSetLayout> layouts(descriptorSetSize, m_descriptorSetLayout);
+	for (const std::shared_ptr<BatchResource>& batchResource : getBatchResources())
+	{
+		std::shared_ptr<SkeletalBatchResource> batch = std::static_pointer_cast<SkeletalBatchResource>(batchResource);
+		if (batch->mesh == mesh)
+		{
+			return batch;
+		}
+	}
+	return nullptr;
+}
 
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = m_descriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
-	allocInfo.pSetLayouts = layouts.data();
+void SkeletalMeshPipeline::reserveInstances(SkeletalBatchResource& batch, uint32_t imageIndex, uint32_t instanceNum)
+{
+	batch.instanceBuffers.resize(SWAPCHAIN_IMAGE_NUM);
+	batch.paletteBuffers.resize(SWAPCHAIN_IMAGE_NUM);
+	batch.instanceCapacities.resize(SWAPCHAIN_IMAGE_NUM, 0);
+	uint32_t& capacity = batch.instanceCapacities[imageIndex];
+	if (instanceNum <= capacity)
+	{
+		return;
+	}
 
-	batch->descriptorSets.resize(descriptorSetSize);
-	if (vkAllocateDescriptorSets(m_backend->getDevice(), &allocInfo, batch->descriptorSets.data()) != VK_SUCCESS)
+	// the previous submit of this image has finished, so its buffers are free
+	if (capacity > 0)
 	{
-		throw std::runtime_error("failed to allocate descriptor sets!");
+		batch.instanceBuffers[imageIndex].destroy(m_backend->getAllocator());
+		batch.paletteBuffers[imageIndex].destroy(m_backend->getAllocator());
 	}
 
-	for (size_t i = 0; i < SWAPCHAIN_IMAGE_NUM; ++i)
+	capacity = std::max(std::max(instanceNum, capacity * 2), static_cast<uint32_t>(SKELETAL_INSTANCE_CAPACITY));
+	auto& factory = ResourceFactory::getInstance();
+	factory.createBuffer(capacity * sizeof(glm::mat4), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY, batch.instanceBuffers[imageIndex]);
+	factory.createBuffer(std::max(capacity * batch.paletteStride, 1u) * sizeof(glm::vec4), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY,
+		batch.paletteBuffers[imageIndex]);
+	batch.dirtyDescriptorMask |= 1u << imageIndex;
+}
+
+void SkeletalMeshPipeline::uploadInstances(uint32_t imageIndex)
+{
+	VmaAllocator allocator = m_backend->getAllocator();
+	for (const std::shared_ptr<BatchResource>& batchResource : getBatchResources())
 	{
-		for (size_t j = 0; j < sectionCount; ++j)
+		SkeletalBatchResource& batch = *std::static_pointer_cast<SkeletalBatchResource>(batchResource);
+		batch.instanceCount = static_cast<uint32_t>(batch.instanceMatrices.size());
+		if (batch.instanceCount == 0)
 		{
-			size_t index = sectionCount * i + j;
-
-			std::vector<VkWriteDescriptorSet> descriptorWrites(2, VkWriteDescriptorSet{});
-
-			VkDescriptorBufferInfo bufferInfo{};
-			bufferInfo.buffer = batch->uniformBuffers[i].buffer;
-			bufferInfo.offset = 0;
-			bufferInfo.range = sizeof(SkeletalMeshUBO);
-
-			descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[0].dstSet = batch->descriptorSets[index];
-			descriptorWrites[0].dstBinding = 0;
-			descriptorWrites[0].dstArrayElement = 0;
-			descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descriptorWrites[0].descriptorCount = 1;
-			descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-			VkDescriptorImageInfo imageInfo{};
-			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			imageInfo.imageView = batch->baseIVSs[j].view;
-			imageInfo.sampler = batch->baseIVSs[j].sampler;
-
-			descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[1].dstSet = batch->descriptorSets[index];
-			descriptorWrites[1].dstBinding = 1;
-			descriptorWrites[1].dstArrayElement = 0;
-			descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[1].descriptorCount = 1;
-			descriptorWrites[1].pImageInfo = &imageInfo;
-
-			vkUpdateDescriptorSets(m_backend->getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+			continue;
 		}
+		reserveInstances(batch, imageIndex, batch.instanceCount);
+
+		void* data;
+		vmaMapMemory(allocator, batch.instanceBuffers[imageIndex].allocation, &data);
+		memcpy(data, batch.instanceMatrices.data(), batch.instanceMatrices.size() * sizeof(glm::mat4));
+		vmaUnmapMemory(allocator, batch.instanceBuffers[imageIndex].allocation);
+
+		vmaMapMemory(allocator, batch.paletteBuffers[imageIndex].allocation, &data);
+		memcpy(data, batch.instancePalettes.data(), batch.instancePalettes.size() * sizeof(glm::vec4));
+		vmaUnmapMemory(allocator, batch.paletteBuffers[imageIndex].allocation);
+	}
+}
+
+void SkeletalMeshPipeline::writeDescriptorSets(std::shared_ptr<BatchResource> batchResource, uint32_t imageIndex)
+{
+	SkeletalBatchResource* batch = (SkeletalBatchResource*)batchResource.get();
+	uint32_t sectionCount = static_cast<uint32_t>(batch->indexCounts.size());
+
+	for (size_t j = 0; j < sectionCount; ++j)
+	{
+		size_t index = sectionCount * imageIndex + j;
+
+		std::vector<VkWriteDescriptorSet> descriptorWrites(3, VkWriteDescriptorSet{});
+
+		VkDescriptorBufferInfo instanceBufferInfo{};
+		instanceBufferInfo.buffer = batch->instanceBuffers[imageIndex].buffer;
+		instanceBufferInfo.offset = 0;
+		instanceBufferInfo.range = VK_WHOLE_SIZE;
+
+		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[0].dstSet = batch->descriptorSets[index];
+		descriptorWrites[0].dstBinding = 0;
+		descriptorWrites[0].dstArrayElement = 0;
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].pBufferInfo = &instanceBufferInfo;
+
+		// textures still streaming in are replaced by the placeholder
+		const VmaImageViewSampler& baseIVS = batch->texturesResident ? batch->baseIVSs[j] : StreamingService::getInstance().getPlaceholderIVS();
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = baseIVS.view;
+		imageInfo.sampler = baseIVS.sampler;
+
+		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[1].dstSet = batch->descriptorSets[index];
+		descriptorWrites[1].dstBinding = 1;
+		descriptorWrites[1].dstArrayElement = 0;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].pImageInfo = &imageInfo;
+
+		VkDescriptorBufferInfo paletteBufferInfo{};
+		paletteBufferInfo.buffer = batch->paletteBuffers[imageIndex].buffer;
+		paletteBufferInfo.offset = 0;
+		paletteBufferInfo.range = VK_WHOLE_SIZE;
+
+		descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[2].dstSet = batch->descriptorSets[index];
+		descriptorWrites[2].dstBinding = 2;
+		descriptorWrites[2].dstArrayElement = 0;
+		descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[2].descriptorCount = 1;
+		descriptorWrites[2].pBufferInfo = &paletteBufferInfo;
+
+		vkUpdateDescriptorSets(m_backend->getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 	}
 }
 
 uint32_t SkeletalMeshPipeline::getMaxBatchNum()
 {
+	// one batch per skeletal mesh, however many instances draw it
 	return 8;
 }
 
 void SkeletalMeshPipeline::createDescriptorSetLayout()
 {
-	VkDescriptorSetLayoutBinding uboLayoutBinding{};
-	uboLayoutBinding.binding = 0;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboLayoutBinding.descriptorCount = 1;
-	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	uboLayoutBinding.pImmutableSamplers = nullptr;
+	VkDescriptorSetLayoutBinding instanceLayoutBinding{};
+	instanceLayoutBinding.binding = 0;
+	instanceLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	instanceLayoutBinding.descriptorCount = 1;
+	instanceLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	instanceLayoutBinding.pImmutableSamplers = nullptr;
 
 	VkDescriptorSetLayoutBinding samplerLayoutBinding{};
 	samplerLayoutBinding.binding = 1;
@@ -92,7 +165,14 @@ void SkeletalMeshPipeline::createDescriptorSetLayout()
 	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 	samplerLayoutBinding.pImmutableSamplers = nullptr;
 
-	std::vector<VkDescriptorSetLayoutBinding> bindings = { uboLayoutBinding, samplerLayoutBinding };
+	VkDescriptorSetLayoutBinding paletteLayoutBinding{};
+	paletteLayoutBinding.binding = 2;
+	paletteLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	paletteLayoutBinding.descriptorCount = 1;
+	paletteLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	paletteLayoutBinding.pImmutableSamplers = nullptr;
+
+	std::vector<VkDescriptorSetLayoutBinding> bindings = { instanceLayoutBinding, samplerLayoutBinding, paletteLayoutBinding };
 
 	VkDescriptorSetLayoutCreateInfo layoutInfo{};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -110,8 +190,8 @@ void SkeletalMeshPipeline::createDescriptorPool()
 	uint32_t descriptorCount = SWAPCHAIN_IMAGE_NUM * getMaxBatchNum();
 
 	std::vector<VkDescriptorPoolSize> poolSizes(2, VkDescriptorPoolSize{});
-	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = static_cast<uint32_t>(descriptorCount);
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[0].descriptorCount = static_cast<uint32_t>(descriptorCount * 2);
 	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	poolSizes[1].descriptorCount = static_cast<uint32_t>(descriptorCount);
 
@@ -135,12 +215,22 @@ std::vector<VkPipelineShaderStageCreateInfo> SkeletalMeshPipeline::createShaderS
 	VkShaderModule vertShaderModule = ResourceFactory::getInstance().createShaderModule(vertShaderCode);
 	VkShaderModule fragShaderModule = ResourceFactory::getInstance().createShaderModule(fragShaderCode);
 
+	// the palette format is a specialization constant, so the other formats' blends are compiled out
+	m_paletteFormat = static_cast<uint32_t>(AnimationKernels::getInstance().getPaletteFormat());
+	m_specializationEntry.constantID = 0;
+	m_specializationEntry.offset = 0;
+	m_specializationEntry.size = sizeof(uint32_t);
+	m_specializationInfo.mapEntryCount = 1;
+	m_specializationInfo.pMapEntries = &m_specializationEntry;
+	m_specializationInfo.dataSize = sizeof(uint32_t);
+	m_specializationInfo.pData = &m_paletteFormat;
+
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
 	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
 	vertShaderStageInfo.module = vertShaderModule;
 	vertShaderStageInfo.pName = "main";
-	vertShaderStageInfo.pSpecializationInfo = nullptr; // ɫԱŻ
+	vertShaderStageInfo.pSpecializationInfo = &m_specializationInfo; // ɫԱŻ
 
 	VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
 	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -155,14 +245,14 @@ std::vector<VkPipelineShaderStageCreateInfo> SkeletalMeshPipeline::createShaderS
 
 VkPipelineVertexInputStateCreateInfo SkeletalMeshPipeline::createVertexInputState()
 {
-	// SkeletalVertex Input
+	// PackedSkeletalVertex Input
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
 	// 
 	m_bindingDescriptions.resize(1, VkVertexInputBindingDescription{});
 	m_bindingDescriptions[0].binding = 0;
-	m_bindingDescriptions[0].stride = sizeof(SkeletalVertex);
+	m_bindingDescriptions[0].stride = sizeof(PackedSkeletalVertex);
 	m_bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
 	// 
@@ -170,28 +260,29 @@ VkPipelineVertexInputStateCreateInfo SkeletalMeshPipeline::createVertexInputStat
 
 	m_attributeDescriptions[0].binding = 0;
 	m_attributeDescriptions[0].location = 0;
-	m_attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-	m_attributeDescriptions[0].offset = offsetof(SkeletalVertex, position);
+	m_attributeDescriptions[0].format = VertexPacker::getInstance().getPositionFormat() == EVertexPositionFormat::Half ?
+		VK_FORMAT_R16G16B16A16_SFLOAT : VK_FORMAT_R16G16B16A16_UNORM;
+	m_attributeDescriptions[0].offset = offsetof(PackedSkeletalVertex, position);
 
 	m_attributeDescriptions[1].binding = 0;
 	m_attributeDescriptions[1].location = 1;
-	m_attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
-	m_attributeDescriptions[1].offset = offsetof(SkeletalVertex, texCoord);
+	m_attributeDescriptions[1].format = VK_FORMAT_R16G16_SFLOAT;
+	m_attributeDescriptions[1].offset = offsetof(PackedSkeletalVertex, texCoord);
 
 	m_attributeDescriptions[2].binding = 0;
 	m_attributeDescriptions[2].location = 2;
-	m_attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-	m_attributeDescriptions[2].offset = offsetof(SkeletalVertex, normal);
+	m_attributeDescriptions[2].format = VK_FORMAT_R16G16_SNORM;
+	m_attributeDescriptions[2].offset = offsetof(PackedSkeletalVertex, normal);
 
 	m_attributeDescriptions[3].binding = 0;
 	m_attributeDescriptions[3].location = 3;
-	m_attributeDescriptions[3].format = VK_FORMAT_R32G32B32A32_SINT;
-	m_attributeDescriptions[3].offset = offsetof(SkeletalVertex, bones);
+	m_attributeDescriptions[3].format = VK_FORMAT_R16G16B16A16_UINT;
+	m_attributeDescriptions[3].offset = offsetof(PackedSkeletalVertex, bones);
 
 	m_attributeDescriptions[4].binding = 0;
 	m_attributeDescriptions[4].location = 4;
-	m_attributeDescriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-	m_attributeDescriptions[4].offset = offsetof(SkeletalVertex, weights);
+	m_attributeDescriptions[4].format = VK_FORMAT_R8G8B8A8_UNORM;
+	m_attributeDescriptions[4].offset = offsetof(PackedSkeletalVertex, weights);
 
 	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(m_bindingDescriptions.size());
 	vertexInputInfo.pVertexBindingDescriptions = m_bindingDescriptions.data();
@@ -206,7 +297,7 @@ std::vector<VkPushConstantRange> SkeletalMeshPipeline::createPushConstantRanges(
 	std::vector<VkPushConstantRange> pushConstantRanges(2, VkPushConstantRange{});
 
 	pushConstantRanges[0].offset = 0;
-	pushConstantRanges[0].size = sizeof(VPCO);
+	pushConstantRanges[0].size = sizeof(SkeletalVPCO);
 	pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
 	pushConstantRanges[1].offset = pushConstantRanges[0].size;
@@ -7,6 +7,15 @@ class SkeletalMeshPipeline : public Pipeline
 public:
 	virtual void pushConstants(VkCommandBuffer commandBuffer, std::shared_ptr<BatchResource> batchResource);
 
+	// the batch already drawing a skeletal mesh, its instances share the geometry
+	std::shared_ptr<SkeletalBatchResource> findBatchResource(const void* mesh);
+
+	// grows the instance and palette buffers of a swapchain image, its descriptor sets are rewritten before its next use
+	void reserveInstances(SkeletalBatchResource& batch, uint32_t imageIndex, uint32_t instanceNum);
+
+	// copies the instances gathered this frame to the buffers of the swapchain image
+	void uploadInstances(uint32_t imageIndex);
+
 protected:
 	virtual uint32_t getMaxBatchNum();
 	virtual void createDescriptorSetLayout();
@@ -15,8 +24,11 @@ protected:
 	virtual VkPipelineVertexInputStateCreateInfo createVertexInputState();
 	virtual std::vector<VkPushConstantRange> createPushConstantRanges();
 
-	virtual void createDescriptorSets(std::shared_ptr<BatchResource> batchResource);
+	virtual void writeDescriptorSets(std::shared_ptr<BatchResource> batchResource, uint32_t imageIndex);
 
 private:
-
+	// palette format of the vertex shader, it must stay alive until the pipeline is created
+	uint32_t m_paletteFormat;
+	VkSpecializationMapEntry m_specializationEntry;
+	VkSpecializationInfo m_specializationInfo;
 };
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "static_mesh_pipeline.h"
+#include "streaming_service.h"
+#include "io/vertex_packer.h"
 
 void StaticMeshPipeline::pushConstants(VkCommandBuffer commandBuffer, std::shared_ptr<BatchResource> batchResource)
 {
@@ -12,62 +14,46 @@ void StaticMeshPipeline::pushConstants(VkCommandBuffer commandBuffer, std::share
 	}
 }
 
-void StaticMeshPipeline::createDescriptorSets(std::shared_ptr<BatchResource> batchResource)
+void StaticMeshPipeline::writeDescriptorSets(std::shared_ptr<BatchResource> batchResource, uint32_t imageIndex)
 {
 	BasicBatchResource* batch = (BasicBatchResource*)batchResource.get();
 	uint32_t sectionCount = static_cast<uint32_t>(batch->indexCounts.size());
-	uint32_t descriptorSetSize = SWAPCHAIN_IMAGE_NUM * sectionCount;
 
-	std::vector<VkDescriptorSetLayout> layouts(descriptorSetSize, m_descriptorSetLayout);
-
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = m_descriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
-	allocInfo.pSetLayouts = layouts.data();
-
-	batch->descriptorSets.resize(descriptorSetSize);
-	if (vkAllocateDescriptorSets(m_backend->getDevice(), &allocInfo, batch->descriptorSets.data()) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to allocate descriptor sets!");
-	}
-
-	for (size_t i = 0; i < SWAPCHAIN_IMAGE_NUM; ++i)
+	for (size_t j = 0; j < sectionCount; ++j)
 	{
-		for (size_t j = 0; j < sectionCount; ++j)
-		{
-			size_t index = sectionCount * i + j;
-
-			std::vector<VkWriteDescriptorSet> descriptorWrites(2, VkWriteDescriptorSet{});
-
-			VkDescriptorBufferInfo bufferInfo{};
-			bufferInfo.buffer = batch->uniformBuffers[i].buffer;
-			bufferInfo.offset = 0;
-			bufferInfo.range = sizeof(StaticMeshUBO);
-
-			descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[0].dstSet = batch->descriptorSets[index];
-			descriptorWrites[0].dstBinding = 0;
-			descriptorWrites[0].dstArrayElement = 0;
-			descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descriptorWrites[0].descriptorCount = 1;
-			descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-			VkDescriptorImageInfo imageInfo{};
-			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			imageInfo.imageView = batch->baseIVSs[j].view;
-			imageInfo.sampler = batch->baseIVSs[j].sampler;
-
-			descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[1].dstSet = batch->descriptorSets[index];
-			descriptorWrites[1].dstBinding = 1;
-			descriptorWrites[1].dstArrayElement = 0;
-			descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[1].descriptorCount = 1;
-			descriptorWrites[1].pImageInfo = &imageInfo;
-
-			vkUpdateDescriptorSets(m_backend->getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-		}
+		size_t index = sectionCount * imageIndex + j;
+
+		std::vector<VkWriteDescriptorSet> descriptorWrites(2, VkWriteDescriptorSet{});
+
+		VkDescriptorBufferInfo bufferInfo{};
+		bufferInfo.buffer = batch->uniformBuffers[imageIndex].buffer;
+		bufferInfo.offset = 0;
+		bufferInfo.range = sizeof(StaticMeshUBO);
+
+		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[0].dstSet = batch->descriptorSets[index];
+		descriptorWrites[0].dstBinding = 0;
+		descriptorWrites[0].dstArrayElement = 0;
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+		// textures still streaming in are replaced by the placeholder
+		const VmaImageViewSampler& baseIVS = batch->texturesResident ? batch->baseIVSs[j] : StreamingService::getInstance().getPlaceholderIVS();
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = baseIVS.view;
+		imageInfo.sampler = baseIVS.sampler;
+
+		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[1].dstSet = batch->descriptorSets[index];
+		descriptorWrites[1].dstBinding = 1;
+		descriptorWrites[1].dstArrayElement = 0;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(m_backend->getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 	}
 }
 
@@ -155,14 +141,14 @@ std::vector<VkPipelineShaderStageCreateInfo> StaticMeshPipeline::createShaderSta
 
 VkPipelineVertexInputStateCreateInfo StaticMeshPipeline::createVertexInputState()
 {
-	// StaticVertex Input
+	// PackedStaticVertex Input
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
 	// 
 	m_bindingDescriptions.resize(1, VkVertexInputBindingDescription{});
 	m_bindingDescriptions[0].binding = 0;
-	m_bindingDescriptions[0].stride = sizeof(StaticVertex);
+	m_bindingDescriptions[0].stride = sizeof(PackedStaticVertex);
 	m_bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
 	// 
@@ -170,18 +156,19 @@ VkPipelineVertexInputStateCreateInfo StaticMeshPipeline::createVertexInputState(
 
 	m_attributeDescriptions[0].binding = 0;
 	m_attributeDescriptions[0].location = 0;
-	m_attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-	m_attributeDescriptions[0].offset = offsetof(StaticVertex, position);
+	m_attributeDescriptions[0].format = VertexPacker::getInstance().getPositionFormat() == EVertexPositionFormat::Half ?
+		VK_FORMAT_R16G16B16A16_SFLOAT : VK_FORMAT_R16G16B16A16_UNORM;
+	m_attributeDescriptions[0].offset = offsetof(PackedStaticVertex, position);
 
 	m_attributeDescriptions[1].binding = 0;
 	m_attributeDescriptions[1].location = 1;
-	m_attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
-	m_attributeDescriptions[1].offset = offsetof(StaticVertex, texCoord);
+	m_attributeDescriptions[1].format = VK_FORMAT_R16G16_SFLOAT;
+	m_attributeDescriptions[1].offset = offsetof(PackedStaticVertex, texCoord);
 
 	m_attributeDescriptions[2].binding = 0;
 	m_attributeDescriptions[2].location = 2;
-	m_attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-	m_attributeDescriptions[2].offset = offsetof(StaticVertex, normal);
+	m_attributeDescriptions[2].format = VK_FORMAT_R16G16_SNORM;
+	m_attributeDescriptions[2].offset = offsetof(PackedStaticVertex, normal);
 
 	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(m_bindingDescriptions.size());
 	vertexInputInfo.pVertexBindingDescriptions = m_bindingDescriptions.data();
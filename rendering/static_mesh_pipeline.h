@@ -15,7 +15,7 @@ protected:
 	virtual VkPipelineVertexInputStateCreateInfo createVertexInputState();
 	virtual std::vector<VkPushConstantRange> createPushConstantRanges();
 
-	virtual void createDescriptorSets(std::shared_ptr<BatchResource> batchResource);
+	virtual void writeDescriptorSets(std::shared_ptr<BatchResource> batchResource, uint32_t imageIndex);
 
 private:
 
@@ -0,0 +1,169 @@
+#include "streaming_service.h"
+#include "graphics_backend.h"
+#include "resource_factory.h"
+#include "utility/thread_pool.h"
+
+#include <algorithm>
+
+// bytes recorded into one upload batch, a single larger request still gets its own batch
+#define STREAMING_JOB_BUDGET (16ull * 1024 * 1024)
+
+StreamingService& StreamingService::getInstance()
+{
+	static StreamingService service;
+	return service;
+}
+
+void StreamingService::init(std::shared_ptr<GraphicsBackend>& backend)
+{
+	m_backend = backend;
+	createPlaceholder();
+}
+
+void StreamingService::destroy()
+{
+	wait();
+	m_placeholderIVS.destroy(m_backend->getDevice(), m_backend->getAllocator());
+}
+
+void StreamingService::request(std::shared_ptr<BatchResource> batchResource, EStreamStage stage, VkDeviceSize size, std::function<void(UploadBatch&)> record)
+{
+	if (stage == EStreamStage::Geometry)
+	{
+		batchResource->resident = false;
+	}
+	else
+	{
+		batchResource->texturesResident = false;
+	}
+
+	// geometry jumps ahead of the queued textures, so new content shows up before it is fully detailed
+	StreamRequest streamRequest{ batchResource, stage, size, record };
+	auto iter = m_requests.end();
+	if (stage == EStreamStage::Geometry)
+	{
+		iter = std::find_if(m_requests.begin(), m_requests.end(), [](const StreamRequest& queued) { return queued.stage == EStreamStage::Textures; });
+	}
+	m_requests.insert(iter, streamRequest);
+	m_streamingStats.requestCount++;
+}
+
+void StreamingService::update()
+{
+	// queue submission stays on the render thread
+	if (m_recordingJob && m_recordingFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		m_recordingFuture.get();
+		m_recordingJob->uploadBatch->submit();
+		m_submittedJobs.push_back(m_recordingJob);
+		m_recordingJob = nullptr;
+	}
+
+	for (auto iter = m_submittedJobs.begin(); iter != m_submittedJobs.end();)
+	{
+		if (!(*iter)->uploadBatch->isComplete())
+		{
+			++iter;
+			continue;
+		}
+
+		finishJob(**iter);
+		iter = m_submittedJobs.erase(iter);
+	}
+
+	if (!m_recordingJob && !m_requests.empty())
+	{
+		launchJob();
+	}
+}
+
+void StreamingService::wait()
+{
+	while (!isIdle())
+	{
+		if (m_recordingJob)
+		{
+			m_recordingFuture.wait();
+		}
+		for (std::shared_ptr<StreamJob>& job : m_submittedJobs)
+		{
+			job->uploadBatch->wait();
+		}
+		update();
+	}
+}
+
+bool StreamingService::isIdle()
+{
+	return m_requests.empty() && !m_recordingJob && m_submittedJobs.empty();
+}
+
+void StreamingService::createPlaceholder()
+{
+	// a single mid grey texel, so unstreamed materials read as neutral
+	Texture texture;
+	texture.name = "placeholder";
+	texture.width = 1;
+	texture.height = 1;
+	texture.channels = 4;
+	texture.format = ETextureFormat::RGBA8;
+	texture.srgb = false;
+	texture.levels.push_back({ 1, 1, 0, 4 });
+	texture.levelData.assign(4, 128);
+
+	auto& factory = ResourceFactory::getInstance();
+	UploadBatch uploadBatch(m_backend);
+	uploadBatch.uploadTexture(texture, factory.getTextureFormat(texture.format, texture.srgb), m_placeholderIVS.vmaImage);
+	uploadBatch.submit();
+	uploadBatch.wait();
+
+	VmaImage& vmaImage = m_placeholderIVS.vmaImage;
+	m_placeholderIVS.view = factory.createImageView(vmaImage.image, vmaImage.format, VK_IMAGE_ASPECT_COLOR_BIT, vmaImage.mipLevels);
+	m_placeholderIVS.sampler = factory.createSampler(VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, vmaImage.mipLevels);
+}
+
+void StreamingService::launchJob()
+{
+	auto job = std::make_shared<StreamJob>();
+	VkDeviceSize jobSize = 0;
+	while (!m_requests.empty() && (job->requests.empty() || jobSize + m_requests.front().size <= STREAMING_JOB_BUDGET))
+	{
+		jobSize += m_requests.front().size;
+		job->requests.push_back(m_requests.front());
+		m_requests.pop_front();
+	}
+
+	// the batch owns its command pools, so it can be recorded while the render thread keeps drawing
+	std::shared_ptr<GraphicsBackend> backend = m_backend;
+	m_recordingJob = job;
+	m_recordingFuture = ThreadPool::getInstance().enqueue([job, backend]() mutable {
+		job->uploadBatch = std::make_shared<UploadBatch>(backend, true);
+		for (StreamRequest& streamRequest : job->requests)
+		{
+			streamRequest.record(*job->uploadBatch);
+		}
+	});
+}
+
+void StreamingService::finishJob(StreamJob& job)
+{
+	for (StreamRequest& streamRequest : job.requests)
+	{
+		std::shared_ptr<BatchResource>& batchResource = streamRequest.batchResource;
+		if (streamRequest.stage == EStreamStage::Geometry)
+		{
+			batchResource->resident = true;
+		}
+		else
+		{
+			batchResource->texturesResident = true;
+		}
+
+		// each swapchain image picks up the new descriptors once its previous frame has finished
+		batchResource->dirtyDescriptorMask = (1u << SWAPCHAIN_IMAGE_NUM) - 1;
+	}
+
+	UploadBatch& uploadBatch = *job.uploadBatch;
+	m_streamingStats.batchCount++;
+	m_streamingStats.bytes += uploadBatch.getByteCount();
+}
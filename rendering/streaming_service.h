@@ -0,0 +1,76 @@
+#pragma once
+
+#include "rendering/batch_resource.h"
+#include "rendering/upload_batch.h"
+
+#include <deque>
+#include <list>
+#include <future>
+#include <functional>
+
+enum class EStreamStage
+{
+	Geometry, Textures
+};
+
+struct StreamingStats
+{
+	uint32_t requestCount = 0;
+	uint32_t batchCount = 0;
+	VkDeviceSize bytes = 0;
+};
+
+/*
+ * Background GPU streaming
+ * Requests are recorded into upload batches on a worker thread and copied on the transfer queue,
+ * the render thread only submits finished recordings and polls their fences once per frame.
+ * Geometry is streamed before textures: a batch is drawn as soon as its buffers are resident
+ * and samples a shared placeholder texture until its own textures arrive.
+ */
+class StreamingService
+{
+public:
+	static StreamingService& getInstance();
+	void init(std::shared_ptr<class GraphicsBackend>& backend);
+	void destroy();
+
+	// record runs on a worker thread and may only touch the upload batch and the resources it creates
+	void request(std::shared_ptr<BatchResource> batchResource, EStreamStage stage, VkDeviceSize size, std::function<void(UploadBatch&)> record);
+
+	// submits finished recordings, marks completed batches resident and starts the next recording
+	void update();
+	void wait();
+
+	bool isIdle();
+	const VmaImageViewSampler& getPlaceholderIVS() { return m_placeholderIVS; }
+	const StreamingStats& getStreamingStats() { return m_streamingStats; }
+
+private:
+	struct StreamRequest
+	{
+		std::shared_ptr<BatchResource> batchResource;
+		EStreamStage stage;
+		VkDeviceSize size;
+		std::function<void(UploadBatch&)> record;
+	};
+
+	struct StreamJob
+	{
+		std::vector<StreamRequest> requests;
+		std::shared_ptr<UploadBatch> uploadBatch;
+	};
+
+	void createPlaceholder();
+	void launchJob();
+	void finishJob(StreamJob& job);
+
+	std::shared_ptr<class GraphicsBackend> m_backend;
+	VmaImageViewSampler m_placeholderIVS;
+
+	std::deque<StreamRequest> m_requests;
+	std::shared_ptr<StreamJob> m_recordingJob;
+	std::future<void> m_recordingFuture;
+	std::list<std::shared_ptr<StreamJob>> m_submittedJobs;
+
+	StreamingStats m_streamingStats;
+};
@@ -0,0 +1,321 @@
+#include "upload_batch.h"
+#include "graphics_backend.h"
+#include "resource_factory.h"
+
+#define STAGING_CHUNK_SIZE (32ull * 1024 * 1024)
+
+UploadBatch::UploadBatch(std::shared_ptr<GraphicsBackend>& backend, bool useTransferQueue) :
+	m_backend(backend)
+{
+	const QueueFamilyIndices& queueFamilyIndices = m_backend->getQueueFamilyIndices();
+	m_dstQueueFamily = queueFamilyIndices.graphicsFamily.value();
+	m_srcQueueFamily = useTransferQueue ? queueFamilyIndices.transferFamily.value() : m_dstQueueFamily;
+	m_ownershipTransfer = m_srcQueueFamily != m_dstQueueFamily;
+
+	// 16 bytes keeps every offset valid for RGBA8 texels and BC blocks
+	m_alignment = std::max(static_cast<VkDeviceSize>(16), m_backend->getPhysicalDeviceProperties().limits.optimalBufferCopyOffsetAlignment);
+
+	// every batch owns its pools, so recording on a worker thread never races with other batches
+	m_commandPool = createCommandPool(m_srcQueueFamily, m_commandBuffer);
+	if (m_ownershipTransfer)
+	{
+		m_acquireCommandPool = createCommandPool(m_dstQueueFamily, m_acquireCommandBuffer);
+	}
+}
+
+UploadBatch::~UploadBatch()
+{
+	if (m_submitted)
+	{
+		wait();
+	}
+	else
+	{
+		release();
+	}
+}
+
+void UploadBatch::uploadBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VmaBuffer& buffer)
+{
+	ResourceFactory::getInstance().createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VMA_MEMORY_USAGE_GPU_ONLY, buffer);
+
+	VkDeviceSize offset;
+	VkBuffer stagingBuffer = stage(data, size, offset);
+
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = offset;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(m_commandBuffer, stagingBuffer, buffer.buffer, 1, &copyRegion);
+
+	if (m_ownershipTransfer)
+	{
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = m_srcQueueFamily;
+		barrier.dstQueueFamilyIndex = m_dstQueueFamily;
+		barrier.buffer = buffer.buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+
+		// release on the transfer queue
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+		// acquire on the graphics queue
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(m_acquireCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+			0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+}
+
+void UploadBatch::uploadTexture(const Texture& texture, VkFormat format, VmaImage& image)
+{
+	image.mipLevels = static_cast<uint32_t>(texture.levels.size());
+	ResourceFactory::getInstance().createImage(static_cast<uint32_t>(texture.width), static_cast<uint32_t>(texture.height), image.mipLevels,
+		VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_GPU_ONLY,
+		image);
+
+	VkDeviceSize offset;
+	VkBuffer stagingBuffer = stage(texture.levelData.data(), texture.levelData.size(), offset);
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image.image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = image.mipLevels;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	std::vector<VkBufferImageCopy> regions(texture.levels.size());
+	for (size_t i = 0; i < texture.levels.size(); ++i)
+	{
+		VkBufferImageCopy& region = regions[i];
+		region.bufferOffset = offset + texture.levels[i].offset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = static_cast<uint32_t>(i);
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { texture.levels[i].width, texture.levels[i].height, 1 };
+	}
+	vkCmdCopyBufferToImage(m_commandBuffer, stagingBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	if (m_ownershipTransfer)
+	{
+		// the layout transition is part of the release/acquire pair and happens once
+		barrier.srcQueueFamilyIndex = m_srcQueueFamily;
+		barrier.dstQueueFamilyIndex = m_dstQueueFamily;
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(m_acquireCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+	else
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+}
+
+void UploadBatch::submit()
+{
+	if (!m_ownershipTransfer)
+	{
+		// buffer copies become visible to vertex input and shaders of every later submission on this queue
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+	vkEndCommandBuffer(m_commandBuffer);
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	if (vkCreateFence(m_backend->getDevice(), &fenceInfo, nullptr, &m_fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create upload fence!");
+	}
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &m_commandBuffer;
+
+	if (m_ownershipTransfer)
+	{
+		vkEndCommandBuffer(m_acquireCommandBuffer);
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		if (vkCreateSemaphore(m_backend->getDevice(), &semaphoreInfo, nullptr, &m_semaphore) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create upload semaphore!");
+		}
+
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &m_semaphore;
+		if (vkQueueSubmit(m_backend->getTransferQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit upload batch!");
+		}
+
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		VkSubmitInfo acquireInfo{};
+		acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquireInfo.waitSemaphoreCount = 1;
+		acquireInfo.pWaitSemaphores = &m_semaphore;
+		acquireInfo.pWaitDstStageMask = &waitStage;
+		acquireInfo.commandBufferCount = 1;
+		acquireInfo.pCommandBuffers = &m_acquireCommandBuffer;
+		if (vkQueueSubmit(m_backend->getGraphicsQueue(), 1, &acquireInfo, m_fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit upload acquire!");
+		}
+	}
+	else if (vkQueueSubmit(m_backend->getGraphicsQueue(), 1, &submitInfo, m_fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to submit upload batch!");
+	}
+
+	m_submitted = true;
+	m_submitTime = std::chrono::high_resolution_clock::now();
+}
+
+bool UploadBatch::isComplete()
+{
+	if (m_released)
+	{
+		return true;
+	}
+
+	if (!m_submitted || vkGetFenceStatus(m_backend->getDevice(), m_fence) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	release();
+	return true;
+}
+
+void UploadBatch::wait()
+{
+	if (!m_released && m_submitted)
+	{
+		vkWaitForFences(m_backend->getDevice(), 1, &m_fence, VK_TRUE, UINT64_MAX);
+		release();
+	}
+}
+
+VkCommandPool UploadBatch::createCommandPool(uint32_t queueFamily, VkCommandBuffer& commandBuffer)
+{
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = queueFamily;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	VkCommandPool commandPool;
+	if (vkCreateCommandPool(m_backend->getDevice(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create upload command pool!");
+	}
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = commandPool;
+	allocInfo.commandBufferCount = 1;
+	vkAllocateCommandBuffers(m_backend->getDevice(), &allocInfo, &commandBuffer);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	return commandPool;
+}
+
+VkBuffer UploadBatch::stage(const void* data, VkDeviceSize size, VkDeviceSize& offset)
+{
+	// uploads are packed into the last chunk, a new chunk is opened when it runs out of space
+	StagingChunk* chunk = m_stagingChunks.empty() ? nullptr : &m_stagingChunks.back();
+	offset = chunk ? (chunk->used + m_alignment - 1) / m_alignment * m_alignment : 0;
+	if (!chunk || offset + size > chunk->size)
+	{
+		StagingChunk newChunk{};
+		newChunk.size = std::max(size, static_cast<VkDeviceSize>(STAGING_CHUNK_SIZE));
+		ResourceFactory::getInstance().createBuffer(newChunk.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, newChunk.buffer);
+
+		void* mapped;
+		vmaMapMemory(m_backend->getAllocator(), newChunk.buffer.allocation, &mapped);
+		newChunk.mapped = static_cast<uint8_t*>(mapped);
+
+		m_stagingChunks.push_back(newChunk);
+		chunk = &m_stagingChunks.back();
+		offset = 0;
+	}
+
+	memcpy(chunk->mapped + offset, data, static_cast<size_t>(size));
+	chunk->used = offset + size;
+
+	m_uploadCount++;
+	m_byteCount += size;
+	return chunk->buffer.buffer;
+}
+
+void UploadBatch::release()
+{
+	if (m_released)
+	{
+		return;
+	}
+
+	m_elapsedTime = m_submitted ? std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - m_submitTime).count() : 0.0f;
+
+	for (StagingChunk& chunk : m_stagingChunks)
+	{
+		vmaUnmapMemory(m_backend->getAllocator(), chunk.buffer.allocation);
+		chunk.buffer.destroy(m_backend->getAllocator());
+	}
+	m_stagingChunks.clear();
+
+	if (m_fence != VK_NULL_HANDLE)
+	{
+		vkDestroyFence(m_backend->getDevice(), m_fence, nullptr);
+	}
+	if (m_semaphore != VK_NULL_HANDLE)
+	{
+		vkDestroySemaphore(m_backend->getDevice(), m_semaphore, nullptr);
+	}
+
+	// destroying the pools frees their command buffers as well
+	vkDestroyCommandPool(m_backend->getDevice(), m_commandPool, nullptr);
+	if (m_acquireCommandPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(m_backend->getDevice(), m_acquireCommandPool, nullptr);
+	}
+	m_released = true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "rendering/batch_resource.h"
+#include "component/material.h"
+
+#include <chrono>
+
+/*
+ * Batched GPU upload
+ * Buffers and textures recorded into one batch share a staging arena and a single command buffer.
+ * The batch is submitted once with a fence, and the staging memory and command buffers are released
+ * when that fence is seen signaled, so creating resources never stalls the whole queue.
+ * A batch on the transfer queue releases every resource to the graphics family and a second small
+ * command buffer acquires them on the graphics queue after a semaphore wait.
+ * Recording may happen on any thread, one thread per batch; submitting and polling belong to the render thread.
+ */
+class UploadBatch
+{
+public:
+	UploadBatch(std::shared_ptr<class GraphicsBackend>& backend, bool useTransferQueue = false);
+	~UploadBatch();
+
+	void uploadBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VmaBuffer& buffer);
+	void uploadTexture(const Texture& texture, VkFormat format, VmaImage& image);
+
+	void submit();
+
+	// polls the fence and releases the staging memory once the upload has finished
+	bool isComplete();
+	void wait();
+
+	uint32_t getUploadCount() { return m_uploadCount; }
+	VkDeviceSize getByteCount() { return m_byteCount; }
+	float getElapsedTime() { return m_elapsedTime; }
+
+private:
+	struct StagingChunk
+	{
+		VmaBuffer buffer;
+		uint8_t* mapped;
+		VkDeviceSize size;
+		VkDeviceSize used;
+	};
+
+	VkCommandPool createCommandPool(uint32_t queueFamily, VkCommandBuffer& commandBuffer);
+
+	// copies data into the arena, returns the chunk buffer and the offset in it
+	VkBuffer stage(const void* data, VkDeviceSize size, VkDeviceSize& offset);
+	void release();
+
+	std::shared_ptr<class GraphicsBackend> m_backend;
+
+	// the acquire pool and command buffer only exist when the batch moves resources across queue families
+	bool m_ownershipTransfer;
+	uint32_t m_srcQueueFamily;
+	uint32_t m_dstQueueFamily;
+	VkCommandPool m_commandPool;
+	VkCommandBuffer m_commandBuffer;
+	VkCommandPool m_acquireCommandPool = VK_NULL_HANDLE;
+	VkCommandBuffer m_acquireCommandBuffer = VK_NULL_HANDLE;
+	VkSemaphore m_semaphore = VK_NULL_HANDLE;
+	VkFence m_fence = VK_NULL_HANDLE;
+
+	std::vector<StagingChunk> m_stagingChunks;
+	VkDeviceSize m_alignment;
+
+	bool m_submitted = false;
+	bool m_released = false;
+	uint32_t m_uploadCount = 0;
+	VkDeviceSize m_byteCount = 0;
+	float m_elapsedTime = 0.0f;
+	std::chrono::high_resolution_clock::time_point m_submitTime;
+};
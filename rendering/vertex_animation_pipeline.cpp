@@ -0,0 +1,178 @@
+#include "vertex_animation_pipeline.h"
+
+void VertexAnimationPipeline::pushConstants(VkCommandBuffer commandBuffer, std::shared_ptr<BatchResource> batchResource)
+{
+	VertexAnimationBatchResource* batch = (VertexAnimationBatchResource*)batchResource.get();
+
+	VertexAnimationVPCO vpco{};
+	vpco.viewProjection = batch->viewProjection;
+	vpco.textureWidth = batch->textureWidth;
+	vpco.rowsPerFrame = batch->rowsPerFrame;
+
+	const void* pcos[] = { &vpco, &batch->fpco };
+	for (size_t i = 0; i < m_pushConstantRanges.size(); ++i)
+	{
+		const VkPushConstantRange& pushConstantRange = m_pushConstantRanges[i];
+		vkCmdPushConstants(commandBuffer, m_pipelineLayout, pushConstantRange.stageFlags, pushConstantRange.offset, pushConstantRange.size, pcos[i]);
+	}
+}
+
+void VertexAnimationPipeline::writeDescriptorSets(std::shared_ptr<BatchResource> batchResource, uint32_t imageIndex)
+{
+	// the instances, frames and base textures are bound like skinned instances and their palettes
+	SkeletalMeshPipeline::writeDescriptorSets(batchResource, imageIndex);
+
+	VertexAnimationBatchResource* batch = (VertexAnimationBatchResource*)batchResource.get();
+	uint32_t sectionCount = static_cast<uint32_t>(batch->indexCounts.size());
+
+	for (size_t j = 0; j < sectionCount; ++j)
+	{
+		size_t index = sectionCount * imageIndex + j;
+
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = batch->animationIVS.view;
+		imageInfo.sampler = batch->animationIVS.sampler;
+
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = batch->descriptorSets[index];
+		descriptorWrite.dstBinding = 3;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(m_backend->getDevice(), 1, &descriptorWrite, 0, nullptr);
+	}
+}
+
+void VertexAnimationPipeline::createDescriptorSetLayout()
+{
+	VkDescriptorSetLayoutBinding instanceLayoutBinding{};
+	instanceLayoutBinding.binding = 0;
+	instanceLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	instanceLayoutBinding.descriptorCount = 1;
+	instanceLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	instanceLayoutBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding samplerLayoutBinding{};
+	samplerLayoutBinding.binding = 1;
+	samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	samplerLayoutBinding.descriptorCount = 1;
+	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	samplerLayoutBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding frameLayoutBinding{};
+	frameLayoutBinding.binding = 2;
+	frameLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	frameLayoutBinding.descriptorCount = 1;
+	frameLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	frameLayoutBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding animationLayoutBinding{};
+	animationLayoutBinding.binding = 3;
+	animationLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	animationLayoutBinding.descriptorCount = 1;
+	animationLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	animationLayoutBinding.pImmutableSamplers = nullptr;
+
+	std::vector<VkDescriptorSetLayoutBinding> bindings = { instanceLayoutBinding, samplerLayoutBinding, frameLayoutBinding, animationLayoutBinding };
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(m_backend->getDevice(), &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor set layout!");
+	}
+}
+
+void VertexAnimationPipeline::createDescriptorPool()
+{
+	uint32_t descriptorCount = SWAPCHAIN_IMAGE_NUM * getMaxBatchNum();
+
+	std::vector<VkDescriptorPoolSize> poolSizes(2, VkDescriptorPoolSize{});
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[0].descriptorCount = static_cast<uint32_t>(descriptorCount * 2);
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[1].descriptorCount = static_cast<uint32_t>(descriptorCount * 2);
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = static_cast<uint32_t>(descriptorCount);
+
+	if (vkCreateDescriptorPool(m_backend->getDevice(), &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor pool!");
+	}
+}
+
+std::vector<VkPipelineShaderStageCreateInfo> VertexAnimationPipeline::createShaderStages(std::vector<VkShaderModule>& shaderModules)
+{
+	std::vector<char> vertShaderCode = AssetLoader::getInstance().loadBinary("asset/shader/spv/blinn_phong_vertex_animation_vert.spv");
+	std::vector<char> fragShaderCode = AssetLoader::getInstance().loadBinary("asset/shader/spv/blinn_phong_vertex_animation_frag.spv");
+	VkShaderModule vertShaderModule = ResourceFactory::getInstance().createShaderModule(vertShaderCode);
+	VkShaderModule fragShaderModule = ResourceFactory::getInstance().createShaderModule(fragShaderCode);
+
+	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vertShaderStageInfo.module = vertShaderModule;
+	vertShaderStageInfo.pName = "main";
+	vertShaderStageInfo.pSpecializationInfo = nullptr;
+
+	VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	fragShaderStageInfo.module = fragShaderModule;
+	fragShaderStageInfo.pName = "main";
+	fragShaderStageInfo.pSpecializationInfo = nullptr;
+
+	shaderModules = { vertShaderModule, fragShaderModule };
+	return { vertShaderStageInfo, fragShaderStageInfo };
+}
+
+VkPipelineVertexInputStateCreateInfo VertexAnimationPipeline::createVertexInputState()
+{
+	// the packed skeletal vertices of the skinned batch, only their UVs are read
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	m_bindingDescriptions.resize(1, VkVertexInputBindingDescription{});
+	m_bindingDescriptions[0].binding = 0;
+	m_bindingDescriptions[0].stride = sizeof(PackedSkeletalVertex);
+	m_bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	m_attributeDescriptions.resize(1, VkVertexInputAttributeDescription{});
+	m_attributeDescriptions[0].binding = 0;
+	m_attributeDescriptions[0].location = 0;
+	m_attributeDescriptions[0].format = VK_FORMAT_R16G16_SFLOAT;
+	m_attributeDescriptions[0].offset = offsetof(PackedSkeletalVertex, texCoord);
+
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(m_bindingDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = m_bindingDescriptions.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(m_attributeDescriptions.size());
+	vertexInputInfo.pVertexAttributeDescriptions = m_attributeDescriptions.data();
+
+	return vertexInputInfo;
+}
+
+std::vector<VkPushConstantRange> VertexAnimationPipeline::createPushConstantRanges()
+{
+	std::vector<VkPushConstantRange> pushConstantRanges(2, VkPushConstantRange{});
+
+	pushConstantRanges[0].offset = 0;
+	pushConstantRanges[0].size = sizeof(VertexAnimationVPCO);
+	pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	pushConstantRanges[1].offset = pushConstantRanges[0].size;
+	pushConstantRanges[1].size = sizeof(FPCO);
+	pushConstantRanges[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	return pushConstantRanges;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "skeletal_mesh_pipeline.h"
+
+// distant skeletal mesh instances playing baked clips, no skinning: the vertex shader fetches positions and normals
+// from the vertex animation texture, instances and their frames are gathered and uploaded like skinned instances
+class VertexAnimationPipeline : public SkeletalMeshPipeline
+{
+public:
+	virtual void pushConstants(VkCommandBuffer commandBuffer, std::shared_ptr<BatchResource> batchResource);
+
+protected:
+	virtual void createDescriptorSetLayout();
+	virtual void createDescriptorPool();
+	virtual std::vector<VkPipelineShaderStageCreateInfo> createShaderStages(std::vector<VkShaderModule>& shaderModules);
+	virtual VkPipelineVertexInputStateCreateInfo createVertexInputState();
+	virtual std::vector<VkPushConstantRange> createPushConstantRanges();
+
+	virtual void writeDescriptorSets(std::shared_ptr<BatchResource> batchResource, uint32_t imageIndex);
+};
@@ -0,0 +1,106 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& filename)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_file = file;
+	m_mapping = mapping;
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED)
+	{
+		::close(fd);
+		return false;
+	}
+
+	m_fd = fd;
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = static_cast<size_t>(fileStat.st_size);
+#endif
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (!m_data)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle(static_cast<HANDLE>(m_mapping));
+	CloseHandle(static_cast<HANDLE>(m_file));
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	munmap(const_cast<uint8_t*>(m_data), m_size);
+	::close(m_fd);
+	m_fd = -1;
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+/* Read-only memory mapped file */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& filename);
+	void close();
+
+	bool isOpen() const { return m_data != nullptr; }
+	const uint8_t* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#else
+	int m_fd = -1;
+#endif
+
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+};
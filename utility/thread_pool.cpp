@@ -0,0 +1,121 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+ThreadPool& ThreadPool::getInstance()
+{
+	static ThreadPool instance;
+	return instance;
+}
+
+ThreadPool::~ThreadPool()
+{
+	destroy();
+}
+
+void ThreadPool::init(uint32_t threadNum)
+{
+	destroy();
+
+	if (threadNum == 0)
+	{
+		threadNum = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	m_stopped = false;
+	for (uint32_t i = 0; i < threadNum; ++i)
+	{
+		m_workers.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+void ThreadPool::destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopped = true;
+	}
+	m_condition.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+}
+
+void ThreadPool::parallelFor(uint32_t count, std::function<void(uint32_t)> task)
+{
+	struct ParallelForState
+	{
+		std::function<void(uint32_t)> task;
+		uint32_t count;
+		std::atomic<uint32_t> next{ 0 };
+		std::atomic<uint32_t> finished{ 0 };
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		// claims indices until none are left, helpers that start late simply find nothing to do
+		void run()
+		{
+			uint32_t index;
+			while ((index = next.fetch_add(1)) < count)
+			{
+				task(index);
+				if (finished.fetch_add(1) + 1 == count)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					condition.notify_all();
+				}
+			}
+		}
+	};
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	auto state = std::make_shared<ParallelForState>();
+	state->task = std::move(task);
+	state->count = count;
+
+	uint32_t helperNum = std::min(getThreadNum(), count - 1);
+	if (helperNum > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (uint32_t i = 0; i < helperNum; ++i)
+			{
+				m_tasks.emplace([state]() { state->run(); });
+			}
+		}
+		m_condition.notify_all();
+	}
+
+	// the caller only ever waits for indices that are already being executed by another thread
+	state->run();
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->condition.wait(lock, [&state]() { return state->finished.load() == state->count; });
+}
+
+void ThreadPool::work()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_stopped || !m_tasks.empty(); });
+
+			// drain the queue before exiting, pending futures must still be fulfilled
+			if (m_tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+		}
+		task();
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+
+/* Fixed size worker pool, tasks are executed in submission order */
+class ThreadPool
+{
+public:
+	static ThreadPool& getInstance();
+
+	ThreadPool() = default;
+	~ThreadPool();
+
+	// threadNum == 0 means one worker per hardware thread
+	void init(uint32_t threadNum = 0);
+	void destroy();
+
+	uint32_t getThreadNum() { return static_cast<uint32_t>(m_workers.size()); }
+
+	template<typename F>
+	auto enqueue(F&& task) -> std::future<decltype(task())>
+	{
+		using ReturnType = decltype(task());
+		auto packagedTask = std::make_shared<std::packaged_task<ReturnType()>>(std::forward<F>(task));
+		std::future<ReturnType> result = packagedTask->get_future();
+
+		// without workers the task runs inline, so callers never deadlock on an uninitialized pool
+		if (m_workers.empty())
+		{
+			(*packagedTask)();
+			return result;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_tasks.emplace([packagedTask]() { (*packagedTask)(); });
+		}
+		m_condition.notify_one();
+		return result;
+	}
+
+	// runs task(i) for i in [0, count), the calling thread takes part so it is safe to call from a worker
+	void parallelFor(uint32_t count, std::function<void(uint32_t)> task);
+
+private:
+	void work();
+
+	std::vector<std::thread> m_workers;
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stopped = false;
+};
@@ -80,6 +80,19 @@ std::vector<std::string> Utility::traverseFiles(const std::string& directory)
 	return filenames;
 }
 
+uint64_t Utility::hash(const void* data, size_t size, uint64_t seed)
+{
+	// FNV-1a 64
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t result = seed;
+	for (size_t i = 0; i < size; ++i)
+	{
+		result ^= bytes[i];
+		result *= 1099511628211ull;
+	}
+	return result;
+}
+
 void Utility::sleep(float t)
 {
 	std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<long long>(t * 1000)));
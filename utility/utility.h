@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 
 class Utility
 {
@@ -14,6 +15,8 @@ public:
 	static std::string basename(const std::string& filename);
 	static std::vector<std::string> traverseFiles(const std::string& directory);
 
+	static uint64_t hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
 	static void sleep(float t);
 	static void preciseSleep(float t);
 